@@ -0,0 +1,176 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "halloc.h"
+
+#define STRUCTURE_COUNT 128
+#define NODE_COUNT 512 // Nodes of each structure
+#define FILLER_COUNT (2 * STRUCTURE_COUNT * NODE_COUNT)
+#define FILLER_GROUP_SIZE 1024 // First half of each group is freed, which leaves holes of 512 nodes
+#define TRAVERSAL_ROUNDS 32
+
+typedef struct list_node_ {
+    struct list_node_ *next;
+    uint64_t value;
+    char payload[48];
+} list_node;
+
+typedef struct tree_node_ {
+    struct tree_node_ *left;
+    struct tree_node_ *right;
+    uint64_t key;
+    char payload[40];
+} tree_node;
+
+static void *fillers[FILLER_COUNT];
+static uint64_t random_state = 88172645463325252ULL;
+
+static uint64_t next_random() {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+static uint64_t get_time_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/*
+Structures grow in rounds over a heap whose pages are half free after every other run of fillers was
+freed, as in a long running program. With halloc every round appends its nodes to the largest free data
+block, so consecutive nodes of one structure end up far apart. With halloc_near a node fills the closest
+hole next to the node that points to it, the first node is placed next to a filler that owns the structure.
+*/
+#define FRAGMENT_HEAP(struct)                                                       \
+    for (size_t j = 0; j < FILLER_COUNT; j++) fillers[j] = halloc(struct, 1);       \
+    for (size_t j = 0; j < FILLER_COUNT; j++) {                                     \
+        if (j % FILLER_GROUP_SIZE < FILLER_GROUP_SIZE / 2) {                        \
+            hfree(fillers[j]);                                                      \
+            fillers[j] = NULL;                                                      \
+        }                                                                           \
+    }
+
+#define FREE_FILLERS()                                                              \
+    for (size_t j = 0; j < FILLER_COUNT; j++) hfree(fillers[j]);
+
+// Owners of the structures are live fillers spread evenly over the heap
+static void* get_owner_filler(size_t i) {
+    return fillers[(i * FILLER_COUNT / STRUCTURE_COUNT) | (FILLER_GROUP_SIZE / 2)];
+}
+
+static double measure_list_traversal(int use_hint) {
+    list_node *heads[STRUCTURE_COUNT] = {0}, *tails[STRUCTURE_COUNT] = {0};
+
+    FRAGMENT_HEAP(list_node);
+
+    for (size_t round = 0; round < NODE_COUNT; round++) {
+        for (size_t i = 0; i < STRUCTURE_COUNT; i++) {
+            void *hint = (tails[i] != NULL) ? (void *)tails[i] : get_owner_filler(i);
+            list_node *node = use_hint ? halloc_near(hint, list_node, 1) : halloc(list_node, 1);
+
+            node->value = round;
+            if (tails[i] != NULL) tails[i]->next = node; else heads[i] = node;
+            tails[i] = node;
+        }
+    }
+
+    uint64_t sum = 0;
+    uint64_t const start_ns = get_time_ns();
+
+    for (size_t k = 0; k < TRAVERSAL_ROUNDS; k++) {
+        for (size_t i = 0; i < STRUCTURE_COUNT; i++) {
+            for (list_node *node = heads[i]; node != NULL; node = node->next) sum += node->value;
+        }
+    }
+    uint64_t const elapsed_ns = get_time_ns() - start_ns;
+
+    for (size_t i = 0; i < STRUCTURE_COUNT; i++) {
+        for (list_node *node = heads[i], *next = NULL; node != NULL; node = next) {
+            next = node->next;
+            hfree(node);
+        }
+    }
+    FREE_FILLERS();
+
+    if (sum == 0) fprintf(stderr, "empty lists\n");
+
+    return (double)elapsed_ns / ((double)TRAVERSAL_ROUNDS * STRUCTURE_COUNT * NODE_COUNT);
+}
+
+static uint64_t sum_tree_keys(tree_node *node) {
+    return (node == NULL) ? 0 : sum_tree_keys(node->left) + node->key + sum_tree_keys(node->right);
+}
+
+static void free_tree(tree_node *node) {
+    if (node == NULL) return;
+
+    free_tree(node->left);
+    free_tree(node->right);
+    hfree(node);
+}
+
+static double measure_tree_traversal(int use_hint) {
+    tree_node *roots[STRUCTURE_COUNT] = {0};
+
+    FRAGMENT_HEAP(tree_node);
+
+    for (size_t round = 0; round < NODE_COUNT; round++) {
+        for (size_t i = 0; i < STRUCTURE_COUNT; i++) {
+            uint64_t const key = next_random();
+            tree_node *parent = NULL, **link = &roots[i];
+
+            while (*link != NULL) {
+                parent = *link;
+                link = (key < parent->key) ? &parent->left : &parent->right;
+            }
+
+            void *hint = (parent != NULL) ? (void *)parent : get_owner_filler(i);
+            tree_node *node = use_hint ? halloc_near(hint, tree_node, 1) : halloc(tree_node, 1);
+
+            node->key = key;
+            *link = node;
+        }
+    }
+
+    uint64_t sum = 0;
+    uint64_t const start_ns = get_time_ns();
+
+    for (size_t k = 0; k < TRAVERSAL_ROUNDS; k++) {
+        for (size_t i = 0; i < STRUCTURE_COUNT; i++) sum += sum_tree_keys(roots[i]);
+    }
+    uint64_t const elapsed_ns = get_time_ns() - start_ns;
+
+    for (size_t i = 0; i < STRUCTURE_COUNT; i++) free_tree(roots[i]);
+    FREE_FILLERS();
+
+    if (sum == 0) fprintf(stderr, "empty trees\n");
+
+    return (double)elapsed_ns / ((double)TRAVERSAL_ROUNDS * STRUCTURE_COUNT * NODE_COUNT);
+}
+
+int main() {
+    fprintf(stdout, "traversal time of %d structures of %d nodes grown in rounds over a fragmented heap...\n",
+        STRUCTURE_COUNT, NODE_COUNT
+    );
+
+    double const list_ns = measure_list_traversal(0);
+    double const near_list_ns = measure_list_traversal(1);
+
+    fprintf(stdout, "lists  halloc %6.2f ns per node, halloc_near %6.2f ns per node, speedup %5.2fx\n",
+        list_ns, near_list_ns, list_ns / near_list_ns
+    );
+
+    double const tree_ns = measure_tree_traversal(0);
+    double const near_tree_ns = measure_tree_traversal(1);
+
+    fprintf(stdout, "trees  halloc %6.2f ns per node, halloc_near %6.2f ns per node, speedup %5.2fx\n",
+        tree_ns, near_tree_ns, tree_ns / near_tree_ns
+    );
+}
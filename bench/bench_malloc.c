@@ -0,0 +1,84 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#define SLOT_COUNT 65536 // Live allocations of the workload
+#define OPERATION_COUNT 1000000
+#define MAX_SMALL_SIZE 256
+#define MAX_MEDIUM_SIZE 16384
+#define MAX_LARGE_SIZE (1 << 20)
+
+static void *slots[SLOT_COUNT];
+static size_t slot_sizes[SLOT_COUNT];
+static uint64_t random_state = 88172645463325252ULL;
+
+static uint64_t next_random() {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+    return random_state;
+}
+
+static uint64_t get_time_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// Mostly small requests with a tail of medium and rare large ones, as in a typical service
+static size_t next_size() {
+    uint64_t const kind = next_random() % 1000;
+
+    if (kind < 900) return 1 + next_random() % MAX_SMALL_SIZE;
+    if (kind < 998) return 1 + next_random() % MAX_MEDIUM_SIZE;
+    return 1 + next_random() % MAX_LARGE_SIZE;
+}
+
+/*
+Malloc workload for comparing the system allocator with the shim, run through plain malloc, realloc and
+free such that `LD_PRELOAD=./libhalloc.so` swaps the allocator underneath. Every operation replaces or
+grows a random live allocation and touches its first and last byte. Throughput and peak resident memory
+are printed for the allocator named by the first argument.
+*/
+int main(int argc, char **argv) {
+    char const *allocator = (argc > 1) ? argv[1] : "default";
+    uint64_t const start_ns = get_time_ns();
+
+    for (size_t i = 0; i < OPERATION_COUNT; i++) {
+        size_t const slot = next_random() % SLOT_COUNT;
+        size_t const size = next_size();
+        char *data = NULL;
+
+        if (slots[slot] != NULL && next_random() % 8 == 0) {
+            // Growth keeps the old contents
+            data = realloc(slots[slot], slot_sizes[slot] + size);
+            size_t const new_size = slot_sizes[slot] + size;
+
+            if (data == NULL) return 1;
+            data[new_size - 1] = (char)i;
+            slot_sizes[slot] = new_size;
+        } else {
+            free(slots[slot]);
+            data = malloc(size);
+
+            if (data == NULL) return 1;
+            data[0] = data[size - 1] = (char)i;
+            slot_sizes[slot] = size;
+        }
+        slots[slot] = data;
+    }
+
+    uint64_t const elapsed_ns = get_time_ns() - start_ns;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    fprintf(stdout, "allocator %-8s %6.2f M operations/s, peak RSS %7ld KiB\n",
+        allocator, OPERATION_COUNT / (elapsed_ns / 1e3), usage.ru_maxrss
+    );
+
+    for (size_t i = 0; i < SLOT_COUNT; i++) free(slots[i]);
+}
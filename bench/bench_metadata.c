@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "halloc.h"
+
+#define ALLOC_COUNT 10000
+#define MAX_STRIDE 4096
+
+static void* ptrs[ALLOC_COUNT];
+
+/*
+Metadata overhead of a data block is measured as the mean distance between consecutive
+single unit allocations minus the size of the type, i.e. the meta block and padding
+that every allocation pays for. Distances between different vm pages are skipped.
+*/
+static void measure_metadata_overhead(char *struct_name, uint32_t struct_size) {
+    uint64_t stride_sum = 0, stride_count = 0;
+    halloc_mapping_stats_t stats_before, stats_after;
+
+    halloc_get_total_mapping_stats(&stats_before);
+
+    for (size_t j=0; j<ALLOC_COUNT; ++j) ptrs[j] = _halloc(struct_name, struct_size, 1);
+
+    for (size_t j=1; j<ALLOC_COUNT; ++j)
+    {
+        uintptr_t const lhs = (uintptr_t)ptrs[j-1], rhs = (uintptr_t)ptrs[j];
+        uint64_t const stride = lhs < rhs ? rhs - lhs : lhs - rhs;
+
+        if (stride < MAX_STRIDE) {
+            stride_sum += stride;
+            stride_count += 1;
+        }
+    }
+
+    double const overhead = (double)stride_sum / stride_count - struct_size;
+
+    fprintf(stdout, "type %-10s size %4u bytes, metadata %5.1f bytes, %5.2f bytes per live byte\n",
+        struct_name, struct_size, overhead, overhead / struct_size
+    );
+
+    for (size_t j=0; j<ALLOC_COUNT; ++j) hfree(ptrs[j]);
+
+    // Syscalls and faults of the whole round, a rise points at a regression of the page growth
+    halloc_get_total_mapping_stats(&stats_after);
+
+    fprintf(stdout, "%-15s mmaps %4llu, munmaps %4llu, minor faults %6llu\n", "",
+        (unsigned long long)(stats_after.map_count - stats_before.map_count),
+        (unsigned long long)(stats_after.unmap_count - stats_before.unmap_count),
+        (unsigned long long)(stats_after.minor_faults - stats_before.minor_faults)
+    );
+}
+
+int main() {
+    fprintf(stdout, "metadata overhead of single unit allocations...\n");
+
+    measure_metadata_overhead("bench_1", 1);
+    measure_metadata_overhead("bench_4", 4);
+    measure_metadata_overhead("bench_8", 8);
+    measure_metadata_overhead("bench_24", 24);
+    measure_metadata_overhead("bench_64", 64);
+    measure_metadata_overhead("bench_256", 256);
+}
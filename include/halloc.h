@@ -4,13 +4,132 @@
 #include <stdint.h>
 #include <stddef.h>
 
+typedef struct {
+    uint64_t live_bytes;
+    uint64_t live_objects;
+    uint64_t alloc_count;
+    uint64_t free_count;
+} halloc_site_usage_t;
+
+typedef struct {
+    void* (*map)(void *context, size_t length, size_t alignment, int flags);
+    int (*unmap)(void *context, void *addr, size_t length);
+    int (*advise)(void *context, void *addr, size_t length, int advice);
+    size_t (*get_page_size)(void *context);
+    void *context;
+} halloc_page_provider_t;
+
+typedef uint64_t halloc_handle_t;
+
+typedef struct {
+    uint64_t map_count;
+    uint64_t unmap_count;
+    uint64_t release_count;
+    uint64_t mapped_bytes;
+    uint64_t unmapped_bytes;
+    uint64_t released_bytes;
+    uint64_t minor_faults;
+    uint64_t major_faults;
+} halloc_mapping_stats_t;
+
+typedef struct {
+    uint32_t size;
+    uint32_t alignment;
+    size_t units;
+} halloc_child_t;
+
 void* _halloc(char *struct_name, uint32_t struct_size, size_t units);
+void* _halloc_at(char *struct_name, uint32_t struct_size, size_t units, char const *file, uint32_t line);
 void _hfree(void* data);
+void* _halloc_aligned(char *struct_name, uint32_t struct_size, size_t units, size_t alignment);
+void* _halloc_aligned_at(
+    char *struct_name, uint32_t struct_size, size_t units, size_t alignment, char const *file, uint32_t line
+);
+void* _halloc_near(void const *hint, char *struct_name, uint32_t struct_size, size_t units);
+void* _halloc_near_at(
+    void const *hint, char *struct_name, uint32_t struct_size, size_t units, char const *file, uint32_t line
+);
+void* _halloc_with_lifetime(char *struct_name, uint32_t struct_size, size_t units, int lifetime);
+void* _halloc_with_lifetime_at(
+    char *struct_name, uint32_t struct_size, size_t units, int lifetime, char const *file, uint32_t line
+);
+void* _halloc_soa(
+    char *struct_name, uint32_t struct_size, uint32_t const *field_sizes, size_t field_count, size_t units, void **field_arrays
+);
+void* _halloc_soa_at(
+    char *struct_name, uint32_t struct_size, uint32_t const *field_sizes, size_t field_count, size_t units, void **field_arrays,
+    char const *file, uint32_t line
+);
+void* _halloc_composite(
+    char *struct_name, uint32_t struct_size, uint32_t struct_alignment,
+    halloc_child_t const *children, size_t child_count, void **child_arrays
+);
+void* _halloc_composite_at(
+    char *struct_name, uint32_t struct_size, uint32_t struct_alignment,
+    halloc_child_t const *children, size_t child_count, void **child_arrays, char const *file, uint32_t line
+);
+void _set_thread_safety(int enabled);
 
 void _print_saved_page_items();
 void _print_total_memory_usage();
 void _print_type_memory_usage(char *struct_name);
 
+size_t _trim_free_memory();
+void _set_free_memory_trim_threshold(size_t threshold);
+void _set_page_growth(size_t min_pages, size_t max_pages);
+
+void _set_heap_key(int heap_key);
+void _set_shared_area(size_t threshold);
+
+int _reserve(char *struct_name, uint32_t struct_size, size_t units, int flags);
+void _release_reservation(char *struct_name);
+
+int _set_layout(char *struct_name, uint32_t struct_size, int layout);
+
+int _set_numa_policy(char *struct_name, uint32_t struct_size, int policy, int node);
+int _set_thread_numa_policy(int policy, int node);
+
+int _open_file_heap(char const *path, size_t size);
+int _close_file_heap();
+int _open_shared_heap(char const *name, size_t size);
+int _close_shared_heap();
+void _set_heap_root(void *root_object);
+void* _get_heap_root();
+
+void _set_profile_rate(size_t sampling_rate);
+int _dump_heap_profile(char const *path);
+
+int _get_site_memory_usage(char const *file, int line, halloc_site_usage_t *usage);
+void _print_site_memory_usage();
+
+int _set_lifetime_stats_clock(int clock);
+int _get_lifetime_stats(char *struct_name, uint64_t *bucket_counts);
+
+int _set_page_provider_callbacks(halloc_page_provider_t const *provider);
+int _reserve_heap_address_space(size_t size);
+
+size_t _get_usable_size(void const *data);
+int _is_owned(void const *data);
+
+halloc_handle_t _halloc_handle(char *struct_name, uint32_t struct_size, size_t units);
+void* _pin_handle(halloc_handle_t handle);
+void _unpin_handle(halloc_handle_t handle);
+void _hfree_handle(halloc_handle_t handle);
+size_t _compact_handles(char *struct_name, size_t max_moved_bytes);
+
+int _set_type_refill(char *struct_name, uint32_t struct_size, size_t min_free_bytes);
+int _start_refill(unsigned interval_us);
+void _stop_refill();
+
+void _hfree_deferred(void *data);
+size_t _reclaim_deferred();
+int _enter_epoch();
+void _exit_epoch();
+
+int _get_type_mapping_stats(char *struct_name, halloc_mapping_stats_t *stats);
+int _get_total_mapping_stats(halloc_mapping_stats_t *stats);
+void _set_fault_sampling_enabled(int enabled);
+
 /*
 Halloc memory allocator.
 
@@ -29,7 +148,11 @@ Examples:
     4) halloc(struct StructName, 2)
 */
 
+#ifdef HALLOC_SITE_STATS
+#define halloc(struct, units) (_halloc_at(#struct, sizeof(struct), units, __FILE__, __LINE__))
+#else
 #define halloc(struct, units) (_halloc(#struct, sizeof(struct), units))
+#endif
 
 /*
 Hfree deallocates previously allocated memory by halloc.
@@ -47,6 +170,281 @@ Examples:
 
 #define hfree(data) (_hfree(data))
 
+/*
+Query an allocation in constant time.
+
+Halloc_usable_size returns how many bytes of the allocation can be used, which is at least the
+requested size and includes the padding and any residue that was too small to be split off. A growing
+buffer can use the slack without reallocating. Halloc_owns tells whether the address was allocated by
+halloc, such that code mixing allocators can route frees without lookup tables of its own. Addresses
+inside allocations and inside the free memory of halloc are also recognized as memory of halloc.
+
+Params:
+    ptr: address returned by halloc, halloc_aligned or the malloc shim, for halloc_owns any address
+
+Returns:
+    halloc_usable_size: size in bytes, 0 for NULL
+    halloc_owns: 1 if the address belongs to memory of halloc, 0 otherwise
+
+Examples:
+    1) if (length < halloc_usable_size(buffer) / sizeof(double)) buffer[length++] = value
+    2) halloc_owns(ptr) ? hfree(ptr) : free(ptr)
+*/
+
+#define halloc_usable_size(ptr) (_get_usable_size(ptr))
+
+#define halloc_owns(ptr) (_is_owned(ptr))
+
+/*
+Allocate movable objects that are reached through handles, such that the pages of long-lived types
+can be compacted.
+
+Objects of handles have pages of their own, separate from the allocations of halloc. Halloc_pin
+returns the current address of the object and keeps it in place until the matching halloc_unpin.
+Halloc_compact moves unpinned objects of the type out of its sparsest pages into the free memory of
+its other pages, and unmaps every page that it empties, until `max_bytes` have been moved. Objects
+only move during halloc_compact, which can be called repeatedly, e.g. from an idle loop, to compact a
+heap incrementally. A page with a pinned object stops the compaction.
+
+Handles belong to the process, they are not stored in a file or shared heap. A freed handle is never
+resolved again, even when its table entry gets reused.
+
+Params:
+    struct, units: type and allocation count as for halloc
+    handle: handle returned by halloc_handle
+    max_bytes: max count of bytes that are moved by one call of halloc_compact
+
+Returns:
+    halloc_handle: handle of the object, HALLOC_NULL_HANDLE if allocation failed
+    halloc_pin: address of the object, NULL for a freed or an invalid handle
+    halloc_compact: count of moved bytes, 0 when the pages of the type cannot get fewer
+
+Examples:
+    1) halloc_handle_t handle = halloc_handle(myType, 1); myType *obj = halloc_pin(handle);
+       obj->size = 0; halloc_unpin(handle); hfree_handle(handle)
+    2) while (halloc_compact(myType, 1 << 20) > 0) {}
+*/
+
+#define HALLOC_NULL_HANDLE 0
+
+#define halloc_handle(struct, units) (_halloc_handle(#struct, sizeof(struct), units))
+
+#define halloc_pin(handle) (_pin_handle(handle))
+
+#define halloc_unpin(handle) (_unpin_handle(handle))
+
+#define hfree_handle(handle) (_hfree_handle(handle))
+
+#define halloc_compact(struct, max_bytes) (_compact_handles(#struct, max_bytes))
+
+/*
+Map and fault in the pages of growing types in a background thread, such that their allocations
+never wait for mmap and page faults.
+
+Halloc_set_refill marks a type as hot: whenever the largest free block of its heap is smaller than
+`min_free_bytes`, the refill thread maps a new populated page for the heap, as large as the next page
+that an allocation would map. Zero bytes unmarks the type. The thread checks the marked types every
+`interval_us` microseconds, mapping happens outside the heap lock. Starting the thread enables thread
+safety, hence it's started before the threads of the program allocate. No pages are refilled while a
+file heap or a shared heap is open, and single allocations of types with out-of-band layout are not
+refilled.
+
+Params:
+    struct: type of the struct as for halloc
+    min_free_bytes: size of the largest allocation of the type that should never map a page
+    interval_us: time between two checks in microseconds, zero for 1000
+
+Returns:
+    halloc_set_refill: 1 if the refill size was set, 0 otherwise
+    halloc_start_refill_thread: 1 if the thread was started, 0 if it's already running or failed
+
+Examples:
+    1) halloc_set_refill(myType, 64 * sizeof(myType)); halloc_start_refill_thread(500)
+    2) halloc_stop_refill_thread()
+*/
+
+#define halloc_set_refill(struct, min_free_bytes) (_set_type_refill(#struct, sizeof(struct), min_free_bytes))
+
+#define halloc_start_refill_thread(interval_us) (_start_refill(interval_us))
+
+#define halloc_stop_refill_thread() (_stop_refill())
+
+/*
+Halloc memory allocator for over-aligned data.
+
+Every allocation is aligned to 16 bytes. A larger alignment is reached by allocating a data block
+that is larger by `alignment` bytes and returning an aligned address inside it, which is freed with
+hfree as usual.
+
+Params:
+    struct: type of the struct as for halloc
+    units: allocation count
+    alignment: power of two alignment in bytes
+
+Examples:
+    1) halloc_aligned(double, 1024, 64), e.g. for cache line aligned vectors
+    2) halloc_aligned(myType, 1, 4096)
+*/
+
+#ifdef HALLOC_SITE_STATS
+#define halloc_aligned(struct, units, alignment) \
+    (_halloc_aligned_at(#struct, sizeof(struct), units, alignment, __FILE__, __LINE__))
+#else
+#define halloc_aligned(struct, units, alignment) (_halloc_aligned(#struct, sizeof(struct), units, alignment))
+#endif
+
+/*
+Halloc memory allocator placing data next to an existing allocation.
+
+Linked structures are traversed faster when a node lies on the same page as the node that points
+to it. The data block is taken from the closest free data block that fits, searched among the
+neighbouring data blocks of the hint in its vm page and then in the vm pages mapped right before and
+after it. If none fits or the hint belongs to a heap that the type doesn't allocate from, the data
+block is placed as by halloc. Single unit allocations of a type with out-of-band layout ignore the
+hint. The allocation is freed with hfree as usual.
+
+Params:
+    hint: live allocation of halloc, e.g. the parent of a new tree node, or NULL
+    struct: type of the struct as for halloc
+    units: allocation count
+
+Returns:
+    void pointer or NULL: as for halloc
+
+Examples:
+    1) node->left = halloc_near(node, treeNode, 1)
+    2) tail->next = halloc_near(tail, listNode, 1)
+*/
+
+#ifdef HALLOC_SITE_STATS
+#define halloc_near(hint, struct, units) (_halloc_near_at(hint, #struct, sizeof(struct), units, __FILE__, __LINE__))
+#else
+#define halloc_near(hint, struct, units) (_halloc_near(hint, #struct, sizeof(struct), units))
+#endif
+
+/*
+Halloc memory allocator with a hint how long the data will live.
+
+Objects of one type that die at different times keep each other's pages mapped, a single long-lived
+object is enough to keep a page of freed short-lived ones. The hint steers the data block into a set of
+vm pages of its own within the type: HALLOC_LIFETIME_SHORT for transient objects, e.g. of a single
+request, whose pages empty together and are unmapped wholesale, HALLOC_LIFETIME_PERMANENT for objects
+that are never freed, which stay densely packed on pages without holes, and HALLOC_LIFETIME_LONG for
+everything else, which is placed as by halloc. Short-lived and permanent objects are counted by their
+type as usual, their pages are listed as `<short id>` and `<permanent id>` by the memory usage output.
+
+Params:
+    struct: type of the struct as for halloc
+    units: allocation count
+    lifetime: HALLOC_LIFETIME_LONG, HALLOC_LIFETIME_SHORT or HALLOC_LIFETIME_PERMANENT
+
+Returns:
+    void pointer or NULL: as for halloc
+
+Examples:
+    1) halloc_with_lifetime(request, 1, HALLOC_LIFETIME_SHORT)
+    2) halloc_with_lifetime(symbol, 64, HALLOC_LIFETIME_PERMANENT)
+*/
+
+#define HALLOC_LIFETIME_LONG 0
+#define HALLOC_LIFETIME_SHORT 1
+#define HALLOC_LIFETIME_PERMANENT 2
+
+#ifdef HALLOC_SITE_STATS
+#define halloc_with_lifetime(struct, units, lifetime) \
+    (_halloc_with_lifetime_at(#struct, sizeof(struct), units, lifetime, __FILE__, __LINE__))
+#else
+#define halloc_with_lifetime(struct, units, lifetime) (_halloc_with_lifetime(#struct, sizeof(struct), units, lifetime))
+#endif
+
+/*
+Halloc memory allocator for struct-of-arrays layouts.
+
+Instead of an array of structs, one array per field is allocated for `units` elements, all in one
+data block. Every field array starts at a 64 byte cache line, so loops over a field are contiguous
+and can use aligned vector loads. The arrays are freed together with a single hfree of the returned
+pointer, which is also the first field array. The type is registered with the size of the struct, so
+it can still be allocated as an array of structs with halloc.
+
+Params:
+    struct: struct type whose fields are allocated as arrays
+    field_sizes: sizes of the fields in bytes, e.g. by halloc_field_size
+    field_count: count of the fields
+    units: element count of every field array
+    field_arrays: array of `field_count` pointers, written with the start of each field array
+
+Returns:
+    void pointer or NULL: pointer to the first field array if allocation succeeded, NULL-pointer otherwise.
+
+Examples:
+    1) uint32_t sizes[] = {halloc_field_size(particle, x), halloc_field_size(particle, mass)};
+       void *arrays[2]; void *particles = halloc_soa(particle, sizes, 2, 4096, arrays);
+       float *x = arrays[0]; double *mass = arrays[1]; ... hfree(particles)
+*/
+
+#ifdef HALLOC_SITE_STATS
+#define halloc_soa(struct, field_sizes, field_count, units, field_arrays) \
+    (_halloc_soa_at(#struct, sizeof(struct), field_sizes, field_count, units, field_arrays, __FILE__, __LINE__))
+#else
+#define halloc_soa(struct, field_sizes, field_count, units, field_arrays) \
+    (_halloc_soa(#struct, sizeof(struct), field_sizes, field_count, units, field_arrays))
+#endif
+
+#define halloc_field_size(struct, field) ((uint32_t)sizeof(((struct *)0)->field))
+
+/*
+Halloc memory allocator for a struct together with the arrays it owns.
+
+One struct and its trailing child arrays are placed in one data block, so they take one meta
+block and one allocation instead of one per array. The struct is aligned for its type and every
+child array starts at the alignment of its element type past the end of the struct or of the
+previous array. A single hfree of the struct frees the arrays as well, they must not be freed on
+their own. The whole data block is counted as memory of the struct type.
+
+Params:
+    struct: struct type as for halloc
+    children: array of child array descriptions, e.g. by halloc_child(type, units)
+    child_count: count of the child arrays
+    child_arrays: array of `child_count` pointers, written with the start of each child array
+
+Returns:
+    void pointer or NULL: pointer to the struct if allocation succeeded, NULL-pointer otherwise.
+
+Examples:
+    1) halloc_child_t children[] = {halloc_child(double, 25)}; void *arrays[1];
+       myType *ptr = halloc_composite(myType, children, 1, arrays); ptr->data = arrays[0]; ... hfree(ptr)
+    2) halloc_child_t children[] = {halloc_child(edge, edge_count), halloc_child(char, name_length + 1)};
+       void *arrays[2]; graph_node *node = halloc_composite(graph_node, children, 2, arrays)
+*/
+
+#ifdef HALLOC_SITE_STATS
+#define halloc_composite(struct, children, child_count, child_arrays) \
+    (_halloc_composite_at(#struct, sizeof(struct), _Alignof(struct), children, child_count, child_arrays, __FILE__, __LINE__))
+#else
+#define halloc_composite(struct, children, child_count, child_arrays) \
+    (_halloc_composite(#struct, sizeof(struct), _Alignof(struct), children, child_count, child_arrays))
+#endif
+
+#define halloc_child(type, units) ((halloc_child_t){sizeof(type), _Alignof(type), (units)})
+
+/*
+Serialize halloc for multithreaded programs.
+
+By default halloc expects to be used from a single thread at a time. With thread safety enabled,
+allocations, frees and the other entry points that use the heaps hold a process-wide lock. Enable it
+before starting the threads: a call that entered halloc without the lock finishes without it, hence
+it may overlap with calls made after enabling. The same holds for halloc_start_refill_thread, which
+enables thread safety and is meant to be called before other threads allocate.
+
+Params:
+    enabled: 1 to hold the lock, 0 (default) to skip it
+
+Examples:
+    1) halloc_set_thread_safety(1)
+*/
+
+#define halloc_set_thread_safety(enabled) (_set_thread_safety(enabled))
+
 /*
 Virtual memory statistics APIs.
 
@@ -60,5 +458,475 @@ detailed memory footprint for a specific struct type.
 
 #define halloc_print_type_memory_usage(struct) (_print_type_memory_usage(#struct))
 
+/*
+Return unused memory to the operating system.
+
+Whole system pages inside free data blocks are released with madvise, their virtual
+addresses stay reserved for halloc and are faulted back in when reused. Hfree does this
+automatically for free data blocks whose size reaches the trim threshold (128 KiB by default).
+
+Params:
+    threshold: minimum free data block size in bytes for automatic trimming, zero disables it
+
+Returns:
+    halloc_trim: count of released bytes
+
+Examples:
+    1) halloc_trim()
+    2) halloc_set_trim_threshold(1024 * 1024)
+*/
+
+#define halloc_trim() (_trim_free_memory())
+
+#define halloc_set_trim_threshold(threshold) (_set_free_memory_trim_threshold(threshold))
+
+
+/*
+Set bounds for the size of new virtual memory pages.
+
+Each type maps memory in virtual memory pages that consist of system pages. A new page for a type
+is twice as large as the previous one up to the maximum bound. When the type unmaps a page, the size
+is halved for every second that passed since the type last mapped a page, hence a busy type that
+maps and unmaps pages keeps its size. Larger allocations get pages that are large enough for them.
+By default the bounds are 1 and 256 system pages.
+
+Params:
+    min_pages: minimum system page count of a new virtual memory page, at least one
+    max_pages: maximum system page count of a new virtual memory page, at least `min_pages`
+
+Examples:
+    1) halloc_set_page_growth(1, 1), this disables the growth
+    2) halloc_set_page_growth(4, 1024)
+*/
+
+#define halloc_set_page_growth(min_pages, max_pages) (_set_page_growth(min_pages, max_pages))
+
+/*
+Reserve memory capacity for a type in advance.
+
+Maps a new virtual memory page with room for `units` allocations of the type. The page stays
+mapped and resident even when all of its data blocks are free until the reservation is released.
+Several reservations for the same type add up.
+
+Params:
+    struct: type of the struct as for halloc
+    units: reserved allocation count
+    flags: zero or a bitwise OR of the following
+        HALLOC_RESERVE_POPULATE: fault in all system pages of the reservation immediately
+        HALLOC_RESERVE_LOCK: lock the reservation into RAM with mlock
+
+Returns:
+    halloc_reserve: 1 if the reservation succeeded, 0 otherwise
+
+Examples:
+    1) halloc_reserve(myType, 10000, HALLOC_RESERVE_POPULATE)
+    2) halloc_reserve(double, 1000, HALLOC_RESERVE_POPULATE | HALLOC_RESERVE_LOCK)
+    3) halloc_release_reservation(myType)
+*/
+
+#define HALLOC_RESERVE_POPULATE 0x1
+#define HALLOC_RESERVE_LOCK 0x2
+
+#define halloc_reserve(struct, units, flags) (_reserve(#struct, sizeof(struct), units, flags))
+
+#define halloc_release_reservation(struct) (_release_reservation(#struct))
+
+/*
+Select how types are mapped to heaps.
+
+By default every type has a heap of its own, i.e., its own virtual memory pages and free data blocks.
+With HALLOC_HEAP_KEY_SIZE new allocations of types that have the same size, e.g. `int`, `unsigned int`
+and `float`, share one heap and thus its pages and free data blocks. Statistics printed by
+halloc_print_type_memory_usage are still kept per type. The key can be changed at any time,
+already allocated data stays in its heap until freed.
+
+Params:
+    heap_key: HALLOC_HEAP_KEY_NAME (default) or HALLOC_HEAP_KEY_SIZE
+
+Examples:
+    1) halloc_set_heap_key(HALLOC_HEAP_KEY_SIZE)
+*/
+
+#define HALLOC_HEAP_KEY_NAME 0
+#define HALLOC_HEAP_KEY_SIZE 1
+
+#define halloc_set_heap_key(heap_key) (_set_heap_key(heap_key))
+
+/*
+Pack rarely allocated types together into a shared area.
+
+Every type that has a heap of its own needs at least one virtual memory page. When the shared area
+is enabled, allocations of a type are packed together with other small types into the shared area
+as long as the total size of live data of the type stays below the threshold. After exceeding it
+once, the type gets promoted to use its own heap (or its size class heap) for new allocations.
+
+Params:
+    threshold: max total size of live data of a type in the shared area in bytes, zero (default) disables it
+
+Examples:
+    1) halloc_set_shared_area(1024)
+*/
+
+#define halloc_set_shared_area(threshold) (_set_shared_area(threshold))
+
+/*
+Select where the meta data of a type's allocations lives.
+
+By default every data block has a meta block right in front of it. With HALLOC_LAYOUT_OUT_OF_BAND
+single unit allocations of the type become slots of slab pages. A slab page keeps the meta data of
+its slots in a side table in front of them, hence consecutive slots are contiguous objects without
+any padding and hfree finds the slab page of a slot from the address alone. Slots are aligned to the
+largest power of two that divides the type size, at least 16 bytes, which covers the alignment of the
+type. Allocations of several units use data blocks as before.
+
+Params:
+    struct: type of the struct as for halloc, its size can be at most 4096 bytes for out-of-band layout
+    layout: HALLOC_LAYOUT_INLINE (default) or HALLOC_LAYOUT_OUT_OF_BAND
+
+Returns:
+    halloc_set_layout: 1 if the layout was set, 0 otherwise
+
+Examples:
+    1) halloc_set_layout(myType, HALLOC_LAYOUT_OUT_OF_BAND)
+    2) halloc_set_layout(myType, HALLOC_LAYOUT_INLINE)
+*/
+
+#define HALLOC_LAYOUT_INLINE 0
+#define HALLOC_LAYOUT_OUT_OF_BAND 1
+
+#define halloc_set_layout(struct, layout) (_set_layout(#struct, sizeof(struct), layout))
+
+/*
+Select on which NUMA nodes the memory of a type is placed.
+
+Policy applies to virtual memory pages that get mapped for the type after the call. A type without
+a policy of its own follows the policy of the allocating thread, set with halloc_set_thread_numa_policy.
+Usage of resident system pages per node is printed by halloc_print_type_memory_usage. On machines
+with a single node, or without NUMA support, policies have no effect.
+
+Params:
+    struct: type of the struct as for halloc
+    policy: one of the following
+        HALLOC_NUMA_DEFAULT: no policy, i.e. the policy of the allocating thread
+        HALLOC_NUMA_INTERLEAVE: interleave system pages over all available nodes
+        HALLOC_NUMA_BIND: place system pages only on node `node`
+        HALLOC_NUMA_LOCAL: place system pages on the node of the thread that touches them first
+    node: node index for HALLOC_NUMA_BIND, ignored otherwise
+
+Returns:
+    halloc_set_numa_policy, halloc_set_thread_numa_policy: 1 if the policy was set, 0 otherwise
+
+Examples:
+    1) halloc_set_numa_policy(myType, HALLOC_NUMA_BIND, 1)
+    2) halloc_set_numa_policy(double, HALLOC_NUMA_INTERLEAVE, 0)
+    3) halloc_set_thread_numa_policy(HALLOC_NUMA_LOCAL, 0)
+*/
+
+#define HALLOC_NUMA_DEFAULT 0
+#define HALLOC_NUMA_INTERLEAVE 1
+#define HALLOC_NUMA_BIND 2
+#define HALLOC_NUMA_LOCAL 3
+
+#define halloc_set_numa_policy(struct, policy, node) (_set_numa_policy(#struct, sizeof(struct), policy, node))
+
+#define halloc_set_thread_numa_policy(policy, node) (_set_thread_numa_policy(policy, node))
+
+/*
+Keep allocations in a file that can be reopened later, e.g. after a restart of the program.
+
+While a file heap is open, all new allocations of all types are placed in the file and the types
+are registered in the file instead of the process. The file is mapped at the same address every
+time, hence pointers stored in the allocated objects stay valid in the process that reopens it.
+One object, e.g. the root of an index, can be stored as the root of the heap.
+
+Closing writes the file heap to the disk and unmaps it, pointers to its objects are invalid until
+the file is opened again. Memory allocated outside of the file heap can be freed while the file heap
+is open and vice versa, but types account such frees only in their own registry. Contents of the file
+are consistent only after closing, the file heap doesn't survive a crash of the program.
+
+Params:
+    path: path of the file, a new or an empty file gets created as a file heap
+    size: size of a new file heap in bytes, ignored when opening an existing one
+    root: pointer to an object in the file heap
+
+Returns:
+    halloc_open_file_heap, halloc_close_file_heap: 1 if the operation succeeded, 0 otherwise
+    halloc_get_heap_root: the root object of the open file heap or shared heap, NULL if there's none
+
+Examples:
+    1) halloc_open_file_heap("index.heap", 1UL << 30)
+    2) halloc_set_heap_root(index)
+    3) index = halloc_get_heap_root()
+    4) halloc_close_file_heap()
+*/
+
+#define halloc_open_file_heap(path, size) (_open_file_heap(path, size))
+
+#define halloc_close_file_heap() (_close_file_heap())
+
+#define halloc_set_heap_root(root) (_set_heap_root(root))
+
+#define halloc_get_heap_root() (_get_heap_root())
+
+/*
+Share allocations between processes, e.g. lookup tables of prefork workers.
+
+While a shared heap is open, all new allocations of all types are placed in shared memory and the
+types are registered there. Every process that uses the heap maps it at the same address, so pointers
+between objects are valid in all of them, and allocations and frees of the processes are serialized
+with a process-shared lock. A process that dies holding the lock passes it on to the next one.
+
+An unnamed heap is created with anonymous shared memory before forking the workers, which inherit it.
+A named heap is a POSIX shared memory object that an unrelated process can attach to after the first
+process has created it. Closing only unmaps the heap from the calling process, a named heap exists until
+it's removed with shm_unlink. A file heap and a shared heap cannot be open at the same time.
+
+Params:
+    name: name of the shared memory object starting with a slash, or NULL for an unnamed heap
+    size: size of a new shared heap in bytes, ignored when attaching to an existing one
+
+Returns:
+    halloc_open_shared_heap, halloc_close_shared_heap: 1 if the operation succeeded, 0 otherwise
+
+Examples:
+    1) halloc_open_shared_heap(NULL, 1UL << 30), then fork the workers
+    2) halloc_open_shared_heap("/lookup_tables", 1UL << 30)
+    3) halloc_set_heap_root(table) and table = halloc_get_heap_root() in another process
+    4) halloc_close_shared_heap()
+*/
+
+#define halloc_open_shared_heap(name, size) (_open_shared_heap(name, size))
+
+#define halloc_close_shared_heap() (_close_shared_heap())
+
+/*
+Sample allocations with their call stacks to find the code paths that hold memory.
+
+On average one allocation per `sampling_rate` allocated bytes is sampled, the distances between
+samples are random such that large and small allocations are represented fairly. A sampled allocation
+records the call stack of halloc and stays in the profile until it's freed. Without sampling, which
+is the default, halloc and hfree only check a counter.
+
+The profile is written in the heap profile format of pprof and holds both the live data and all
+allocations since sampling was enabled, selected with `pprof -sample_index=inuse_space` or
+`-sample_index=alloc_space` respectively. Pprof scales the samples into estimates of all allocations.
+
+Params:
+    sampling_rate: mean count of allocated bytes between two samples, zero (default) disables sampling
+    path: path of the profile file, overwritten if it exists
+
+Returns:
+    halloc_dump_heap_profile: 1 if the profile was written, 0 otherwise
+
+Examples:
+    1) halloc_set_profile_rate(512 * 1024)
+    2) halloc_dump_heap_profile("program.heap"), then `pprof program program.heap`
+*/
+
+#define halloc_set_profile_rate(sampling_rate) (_set_profile_rate(sampling_rate))
+
+#define halloc_dump_heap_profile(path) (_dump_heap_profile(path))
+
+/*
+Account memory to the lines of code that allocated it.
+
+When both the library and the program are compiled with HALLOC_SITE_STATS defined, e.g. after
+`make HALLOC_OPTIONS=-DHALLOC_SITE_STATS`, every halloc records its file and line, as do
+halloc_near, halloc_aligned, halloc_with_lifetime, halloc_soa and halloc_composite. Live bytes, live
+objects and total allocation and free counts are then kept for each call site. The site of a data
+block is stored in its meta block, which grows by 16 bytes in this build mode. Allocations without a
+call site, e.g. by the malloc shim, are counted together in the site `<unknown>`.
+
+Params:
+    file, line: call site as given by __FILE__ and __LINE__
+    usage: counts of the call site, written if the site has allocated memory
+
+Returns:
+    halloc_get_site_usage: 1 if the site has allocated memory, 0 otherwise or without HALLOC_SITE_STATS
+
+Examples:
+    1) halloc_print_site_usage()
+    2) halloc_site_usage_t usage; halloc_get_site_usage("parser.c", 120, &usage)
+*/
+
+#define halloc_get_site_usage(file, line, usage) (_get_site_memory_usage(file, line, usage))
+
+#define halloc_print_site_usage() (_print_site_memory_usage())
+
+/*
+Measure how long the objects of each type live.
+
+When the library is compiled with HALLOC_LIFETIME_STATS defined, e.g. after
+`make HALLOC_OPTIONS=-DHALLOC_LIFETIME_STATS`, every allocation stores its birth stamp in its meta
+data and hfree adds its lifetime to a histogram of its type. Bucket 0 counts lifetimes of zero and
+bucket i counts lifetimes from 2^(i-1) to 2^i - 1, the last bucket counts also all longer lifetimes.
+The histogram is printed by halloc_print_type_memory_usage. The meta block of every allocation grows
+by 16 bytes in this build mode.
+
+Lifetimes are measured in nanoseconds (HALLOC_LIFETIME_CLOCK_TIME, default) or in allocations made by
+halloc in between (HALLOC_LIFETIME_CLOCK_ALLOCATIONS). Objects allocated before the clock was changed
+are not counted.
+
+Params:
+    struct: type of the struct as for halloc
+    counts: array of HALLOC_LIFETIME_BUCKETS counts, written if the type has been registered
+    clock: HALLOC_LIFETIME_CLOCK_TIME or HALLOC_LIFETIME_CLOCK_ALLOCATIONS
+
+Returns:
+    halloc_get_lifetime_histogram: 1 if the counts were written, 0 otherwise or without HALLOC_LIFETIME_STATS
+    halloc_set_lifetime_clock: 1 if the clock was set, 0 otherwise
+
+Examples:
+    1) uint64_t counts[HALLOC_LIFETIME_BUCKETS]; halloc_get_lifetime_histogram(myType, counts)
+    2) halloc_set_lifetime_clock(HALLOC_LIFETIME_CLOCK_ALLOCATIONS)
+*/
+
+#define HALLOC_LIFETIME_BUCKETS 48
+
+#define HALLOC_LIFETIME_CLOCK_TIME 0
+#define HALLOC_LIFETIME_CLOCK_ALLOCATIONS 1
+
+#define halloc_set_lifetime_clock(clock) (_set_lifetime_stats_clock(clock))
+
+#define halloc_get_lifetime_histogram(struct, counts) (_get_lifetime_stats(#struct, counts))
+
+/*
+Take the memory of halloc from a custom page provider instead of anonymous mmap, e.g. from a
+pre-reserved range, a hugetlbfs file or a memfd, or from a fake provider in benchmarks.
+
+All pages of halloc are mapped, unmapped and advised by the provider, also the pages of its own
+tables. Pages of an open file or shared heap still come from that heap. Mapped pages must be
+readable, writable and zero-filled, and start at a multiple of `alignment`, which is a power of two
+multiple of the page size. Unmapping and advising may cover only a part of a mapping. Advice is
+HALLOC_PAGE_ADVICE_RELEASE to give the physical memory of the pages back, HALLOC_PAGE_ADVICE_LOCK or
+HALLOC_PAGE_ADVICE_UNLOCK to lock or unlock them into memory. Flag HALLOC_PAGE_POPULATE asks to fault
+the pages in.
+
+Pages mapped before the provider was set are later unmapped by it, so a provider that is set after
+the first allocation must be able to unmap them, e.g. by falling back to munmap. Its page size must
+then also equal the page size of the previous provider.
+
+Params:
+    provider: callbacks and their context, which are copied, or NULL for the default mmap provider
+        map: returns the mapped pages, NULL if mapping failed
+        unmap, advise: return 1 if succeeded, 0 otherwise
+        get_page_size: returns the page size in bytes, a power of two of at least 4096
+
+Returns:
+    1 if the provider was set, 0 otherwise
+
+Examples:
+    1) halloc_page_provider_t provider = {map, unmap, advise, get_page_size, &arena};
+       halloc_set_page_provider(&provider)
+    2) halloc_set_page_provider(NULL)
+*/
+
+#define HALLOC_PAGE_POPULATE 0x1
+
+#define HALLOC_PAGE_ADVICE_RELEASE 0
+#define HALLOC_PAGE_ADVICE_LOCK 1
+#define HALLOC_PAGE_ADVICE_UNLOCK 2
+
+#define halloc_set_page_provider(provider) (_set_page_provider_callbacks(provider))
+
+/*
+Reserve one range of address space up front, from which the default page provider takes all later
+pages instead of mapping each page of halloc separately.
+
+The range is mapped without access and without swap space, pages are made accessible with mprotect
+when halloc needs them and made inaccessible again when it frees them. Neighbouring pages then share
+one kernel mapping, which keeps the mapping count of the process far below `vm.max_map_count`, and
+every page of halloc lies in one known range. Once the range is full, pages are mapped separately as
+without the reservation. The reservation is made at most once and is kept until the process exits.
+
+Params:
+    size: size of the reservation in bytes, rounded down to the page size, e.g. 64 GiB
+
+Returns:
+    1 if the address space was reserved, 0 otherwise
+
+Examples:
+    1) halloc_reserve_address_space((size_t)64 << 30)
+*/
+
+#define halloc_reserve_address_space(size) (_reserve_heap_address_space(size))
+
+/*
+Free data that concurrent readers may still be using, without a reclamation library.
+
+Readers wrap every traversal of a shared structure in halloc_epoch_enter and halloc_epoch_exit,
+which only publish the current epoch of the thread and don't take any lock. A writer unlinks an
+object and passes it to hfree_deferred instead of hfree. Deferred frees are collected in batches of
+a page of pointers, when a batch is full it is retired and the global epoch advances. A retired batch
+is freed to the heaps of its types once every reader has left the sections it was in at the time,
+readers that entered later cannot reach the unlinked objects. halloc_reclaim_deferred retires the
+current batch early and frees whatever is safe already, e.g. at the end of a writer's update.
+
+Read sections can be nested. Frees deferred by a thread inside its own read section are freed only
+after it has left the section, neither call ever waits for readers. Up to 256 threads can read at the
+same time, the reader slot of a thread is released when it exits. Writers of a multithreaded program
+enable halloc_set_thread_safety as for any other concurrent use of halloc.
+
+Params:
+    data: pointer to the data returned by halloc, already unreachable for new readers
+
+Returns:
+    halloc_epoch_enter: 1 if the thread has entered a read section, 0 if all reader slots are in use
+    halloc_reclaim_deferred: count of the data blocks that were freed
+
+Examples:
+    1) halloc_epoch_enter(); for (node *n = head; n; n = n->next) sum += n->value; halloc_epoch_exit()
+    2) prev->next = n->next; hfree_deferred(n)
+*/
+
+#define hfree_deferred(data) (_hfree_deferred(data))
+
+#define halloc_epoch_enter() (_enter_epoch())
+
+#define halloc_epoch_exit() (_exit_epoch())
+
+#define halloc_reclaim_deferred() (_reclaim_deferred())
+
+/*
+Count the system calls that map memory and the page faults that touching it costs.
+
+Every mapping and unmapping of pages by the page provider is counted with its bytes, as is every
+release of free pages back to the kernel by trimming. Counts of a type cover its own vm pages and slab
+pages, and the pages of its heap if it shares one with types of the same size or packs into the shared
+area, hence types of one heap report the same calls. Total counts cover the whole process, also the
+internal tables of halloc, together with its minor and major page faults as reported by getrusage.
+Pages taken from an open file or shared heap are not counted since no system call maps them.
+
+Faults of a type are sampled after halloc_set_fault_sampling(1). Halloc itself touches the pages of
+a type first, when it zeroes a new allocation, populates a reservation or refills the heap, and the
+faults of the calling thread during these steps are counted for the type. Each sampled step reads
+the fault counts of the thread twice with getrusage, so sampling is meant for benchmarks and is
+off by default, where the fault counts of a type stay zero.
+
+Comparing the counts before and after a benchmark or a request shows regressions in the syscall
+rate, e.g. after a change of the page growth or the trim threshold.
+
+Params:
+    struct: type of the struct as for halloc
+    stats: counts, written if they are available
+    enabled: 1 to sample the faults of each type, 0 (default) to stop sampling
+
+Returns:
+    halloc_get_mapping_stats: 1 if the type has been registered, 0 otherwise
+    halloc_get_total_mapping_stats: 1 if the page faults were read, 0 otherwise, other counts are
+        written in any case
+
+Examples:
+    1) halloc_mapping_stats_t stats; halloc_get_mapping_stats(myType, &stats)
+    2) halloc_mapping_stats_t stats; halloc_get_total_mapping_stats(&stats)
+    3) halloc_set_fault_sampling(1); run_benchmark(); halloc_get_mapping_stats(myType, &stats)
+*/
+
+#define halloc_get_mapping_stats(struct, stats) (_get_type_mapping_stats(#struct, stats))
+
+#define halloc_get_total_mapping_stats(stats) (_get_total_mapping_stats(stats))
+
+#define halloc_set_fault_sampling(enabled) (_set_fault_sampling_enabled(enabled))
+
 
 #endif /* __HALLOC__ */
@@ -0,0 +1,231 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "memtools.h"
+#include "region.h"
+#include "halloc.h"
+
+/*
+Standard allocation functions on top of halloc for LD_PRELOAD. Every request is rounded up to a size
+class, which is the pseudo-type "<malloc N>" of the registry. Four size classes per power of two keep
+the rounding waste below 25 %. Requests above the largest size class share the heap of "<malloc large>"
+in units of DATA_BLOCK_ALIGNMENT bytes. The page item of every size class is looked up by its name once
+and kept in a table indexed by the size class.
+*/
+
+#define SHIM_MAX_SIZE_CLASS 65536
+#define SHIM_SIZE_CLASSES_PER_POWER_OF_TWO 4
+#define SHIM_MIN_STEPPED_SIZE_CLASS 128 // Size classes up to this are the multiples of DATA_BLOCK_ALIGNMENT
+#define SHIM_SIZE_CLASS_COUNT 44
+#define SHIM_LARGE_STRUCT_NAME "<malloc large>"
+
+#define SHIM_UNINITIALIZED 0
+#define SHIM_INITIALIZING 1
+#define SHIM_INITIALIZED 2
+
+static uint32_t init_state = SHIM_UNINITIALIZED;
+static _Thread_local bool_t is_initializing_thread = false;
+static size_t system_page_size = 0;
+static vm_page_item_t *size_class_items[SHIM_SIZE_CLASS_COUNT];
+static vm_page_item_t *large_item = NULL;
+
+
+static void _init_shim() {
+    if (__atomic_load_n(&init_state, __ATOMIC_ACQUIRE) == SHIM_INITIALIZED || is_initializing_thread) {
+        return;
+    }
+
+    uint32_t expected_state = SHIM_UNINITIALIZED;
+
+    if (!__atomic_compare_exchange_n(
+        &init_state, &expected_state, SHIM_INITIALIZING, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+    {
+        // First allocation of another thread must not run before thread safety is enabled
+        while (__atomic_load_n(&init_state, __ATOMIC_ACQUIRE) != SHIM_INITIALIZED) {
+            sched_yield();
+        }
+        return;
+    }
+
+    // Registering the fork handlers might allocate, which goes on without waiting in this thread
+    is_initializing_thread = true;
+    system_page_size = sysconf(_SC_PAGESIZE);
+    _set_thread_safety(1);
+    is_initializing_thread = false;
+
+    __atomic_store_n(&init_state, SHIM_INITIALIZED, __ATOMIC_RELEASE);
+}
+
+static size_t _get_size_class(size_t size) {
+    if (size <= DATA_BLOCK_ALIGNMENT) {
+        return DATA_BLOCK_ALIGNMENT;
+    }
+
+    // Size is in (power, 2 * power]
+    size_t const power = (size_t)1 << (8 * sizeof(unsigned long) - 1 - __builtin_clzl(size - 1));
+    size_t step = power / SHIM_SIZE_CLASSES_PER_POWER_OF_TWO;
+
+    if (step < DATA_BLOCK_ALIGNMENT) {
+        step = DATA_BLOCK_ALIGNMENT;
+    }
+    return ALIGN_UP(size, step);
+}
+
+static uint32_t _get_size_class_index(size_t size_class) {
+    if (size_class <= SHIM_MIN_STEPPED_SIZE_CLASS) {
+        return size_class / DATA_BLOCK_ALIGNMENT - 1;
+    }
+
+    // Size class is one of the steps in (power, 2 * power]
+    uint32_t const power_log2 = 8 * sizeof(unsigned long) - 1 - __builtin_clzl(size_class - 1);
+    size_t const power = (size_t)1 << power_log2;
+    uint32_t const min_stepped_log2 = __builtin_ctzl(SHIM_MIN_STEPPED_SIZE_CLASS);
+
+    return SHIM_MIN_STEPPED_SIZE_CLASS / DATA_BLOCK_ALIGNMENT +
+        (power_log2 - min_stepped_log2) * SHIM_SIZE_CLASSES_PER_POWER_OF_TWO +
+        (size_class - power) / (power / SHIM_SIZE_CLASSES_PER_POWER_OF_TWO) - 1;
+}
+
+_Static_assert(
+    SHIM_SIZE_CLASS_COUNT == SHIM_MIN_STEPPED_SIZE_CLASS / DATA_BLOCK_ALIGNMENT +
+        (__builtin_ctzl(SHIM_MAX_SIZE_CLASS) - __builtin_ctzl(SHIM_MIN_STEPPED_SIZE_CLASS)) * SHIM_SIZE_CLASSES_PER_POWER_OF_TWO,
+    "size class table must have an entry for every size class"
+);
+
+static vm_page_item_t* _get_size_class_item(vm_page_item_t **cached_item, uint32_t struct_size) {
+    // Types of an open file heap or shared heap are looked up by name in its own registry
+    vm_page_item_t *vm_page_item = _is_region_open() ? NULL : __atomic_load_n(cached_item, __ATOMIC_ACQUIRE);
+
+    if (vm_page_item != NULL) {
+        return vm_page_item;
+    }
+
+    char struct_name[MAX_STRUCT_NAME_SIZE];
+
+    if (cached_item == &large_item) {
+        strcpy(struct_name, SHIM_LARGE_STRUCT_NAME);
+    } else {
+        snprintf(struct_name, sizeof struct_name, "<malloc %u>", struct_size);
+    }
+    return _get_cached_page_item(cached_item, struct_name, struct_size);
+}
+
+static void* _allocate(size_t size, size_t alignment) {
+    _init_shim();
+
+    if (size > MAX_SINGLE_PAGE_SIZE_BYTES) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    vm_page_item_t *vm_page_item = NULL;
+    size_t units = 1;
+
+    if (size > SHIM_MAX_SIZE_CLASS) {
+        vm_page_item = _get_size_class_item(&large_item, DATA_BLOCK_ALIGNMENT);
+        units = ALIGN_UP(size, DATA_BLOCK_ALIGNMENT) / DATA_BLOCK_ALIGNMENT;
+    } else {
+        size_t const size_class = _get_size_class(size);
+        vm_page_item = _get_size_class_item(&size_class_items[_get_size_class_index(size_class)], size_class);
+    }
+
+    void *data = (vm_page_item != NULL) ? _halloc_page_item(vm_page_item, units, alignment) : NULL;
+
+    if (data == NULL) {
+        errno = ENOMEM;
+    }
+    return data;
+}
+
+static bool_t _is_alignment_valid(size_t alignment) {
+    return alignment != 0 && (alignment & (alignment - 1)) == 0;
+}
+
+void* malloc(size_t size) {
+    return _allocate(size, 0);
+}
+
+void free(void *ptr) {
+    _hfree(ptr);
+}
+
+void* calloc(size_t count, size_t size) {
+    size_t total_size;
+
+    if (__builtin_mul_overflow(count, size, &total_size)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    // Halloc hands out zeroed memory
+    return _allocate(total_size, 0);
+}
+
+void* realloc(void *ptr, size_t size) {
+    if (ptr == NULL) {
+        return _allocate(size, 0);
+    }
+    if (size == 0) {
+        _hfree(ptr);
+        return NULL;
+    }
+
+    size_t const usable_size = _get_usable_size(ptr);
+
+    if (size <= usable_size) {
+        return ptr;
+    }
+
+    void *data = _allocate(size, 0);
+
+    if (data != NULL) {
+        memcpy(data, ptr, usable_size);
+        _hfree(ptr);
+    }
+    return data;
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size) {
+    if (!_is_alignment_valid(alignment) || alignment % sizeof(void *) != 0) {
+        return EINVAL;
+    }
+
+    void *data = _allocate(size, alignment);
+
+    if (data == NULL) {
+        return ENOMEM;
+    }
+    *memptr = data;
+    return 0;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    if (!_is_alignment_valid(alignment)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return _allocate(size, alignment);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    return aligned_alloc(alignment, size);
+}
+
+void* valloc(size_t size) {
+    _init_shim();
+    return _allocate(size, system_page_size);
+}
+
+void* pvalloc(size_t size) {
+    _init_shim();
+    // Too large sizes are rejected by the allocation before rounding could overflow
+    return _allocate((size > MAX_SINGLE_PAGE_SIZE_BYTES) ? size : ALIGN_UP(size, system_page_size), system_page_size);
+}
+
+size_t malloc_usable_size(void *ptr) {
+    return _get_usable_size(ptr);
+}
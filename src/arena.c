@@ -0,0 +1,193 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "memtools.h"
+#include "arena.h"
+
+#define GET_ARENA_PAGE_INDEX(addr) ((size_t)((char const *)(addr) - arena.base) / arena.page_size)
+#define IS_ARENA_PAGE_COMMITTED(index) \
+    ((arena.page_bits[(index) / ARENA_BITMAP_WORD_BITS] >> ((index) % ARENA_BITMAP_WORD_BITS)) & 1)
+
+static arena_t arena = {0};
+// Tables of the profiler are mapped outside of the heap lock
+static pthread_mutex_t arena_lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+bool_t _reserve_arena(size_t size, size_t page_size) {
+    if (arena.base != NULL) {
+        fprintf(stderr, "%s: error: address space is already reserved.\n", __func__);
+        return false;
+    }
+
+    size_t const page_count = size / page_size;
+
+    if (page_count == 0) {
+        fprintf(stderr, "%s: error: reservation of %zu bytes is smaller than a page.\n", __func__, size);
+        return false;
+    }
+
+    // Bitmap pages are faulted in only when the pages they describe get committed
+    size_t const bitmap_size = ALIGN_UP(
+        ALIGN_UP(page_count, ARENA_BITMAP_WORD_BITS) / 8, page_size
+    );
+    uint64_t *page_bits = mmap(
+        NULL, bitmap_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0
+    );
+
+    if (page_bits == MAP_FAILED) {
+        fprintf(stderr, "%s: error: page bitmap of the reservation cannot be mapped.\n", __func__);
+        perror("mmap: ");
+        return false;
+    }
+
+    char *base = mmap(
+        NULL, page_count * page_size, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0
+    );
+
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "%s: error: reservation of %zu bytes of address space failed.\n", __func__, size);
+        perror("mmap: ");
+        munmap(page_bits, bitmap_size);
+        return false;
+    }
+
+    arena.base = base;
+    arena.page_size = page_size;
+    arena.page_count = page_count;
+    arena.first_free_page_index = 0;
+    arena.committed_page_count = 0;
+    arena.page_bits = page_bits;
+    return true;
+}
+
+bool_t _is_arena_reserved() {
+    return arena.base != NULL;
+}
+
+bool_t _is_arena_address(void const *addr) {
+    return (
+        arena.base != NULL &&
+        (char const *)addr >= arena.base &&
+        (size_t)((char const *)addr - arena.base) < arena.page_count * arena.page_size
+    );
+}
+
+static void _mark_arena_pages(size_t first_index, size_t count, bool_t is_committed) {
+    for (size_t index = first_index; index < first_index + count; index++) {
+        uint64_t const bit = 1ULL << (index % ARENA_BITMAP_WORD_BITS);
+
+        if (is_committed) {
+            arena.page_bits[index / ARENA_BITMAP_WORD_BITS] |= bit;
+        } else {
+            arena.page_bits[index / ARENA_BITMAP_WORD_BITS] &= ~bit;
+        }
+    }
+}
+
+// Index of the last committed page of the range, or the end of the range if all of its pages are free
+static size_t _find_last_committed_arena_page(size_t first_index, size_t count) {
+    size_t index = first_index + count;
+
+    while (index > first_index) {
+        index--;
+
+        // Whole words of free pages are skipped at once
+        if (index % ARENA_BITMAP_WORD_BITS == ARENA_BITMAP_WORD_BITS - 1 &&
+            index + 1 - first_index >= ARENA_BITMAP_WORD_BITS &&
+            arena.page_bits[index / ARENA_BITMAP_WORD_BITS] == 0) {
+            index -= ARENA_BITMAP_WORD_BITS - 1;
+            continue;
+        }
+        if (IS_ARENA_PAGE_COMMITTED(index)) {
+            return index;
+        }
+    }
+    return first_index + count;
+}
+
+static size_t _align_arena_page_index(size_t index, size_t alignment) {
+    uintptr_t const addr = (uintptr_t)arena.base + index * arena.page_size;
+    return GET_ARENA_PAGE_INDEX(ALIGN_UP(addr, alignment));
+}
+
+static size_t _find_free_arena_pages(size_t count, size_t alignment) {
+    size_t index = _align_arena_page_index(arena.first_free_page_index, alignment);
+
+    // First fit, a committed page inside of the candidate range moves the search past it
+    while (index + count <= arena.page_count) {
+        size_t const committed_index = _find_last_committed_arena_page(index, count);
+
+        if (committed_index == index + count) {
+            return index;
+        }
+        index = _align_arena_page_index(committed_index + 1, alignment);
+    }
+    return arena.page_count;
+}
+
+void* _commit_arena_pages(size_t length, size_t alignment) {
+    size_t const count = ALIGN_UP(length, arena.page_size) / arena.page_size;
+
+    pthread_mutex_lock(&arena_lock);
+
+    // Freed pages at low addresses are reused before new address space is touched
+    size_t const index = _find_free_arena_pages(count, alignment);
+
+    if (index == arena.page_count) {
+        pthread_mutex_unlock(&arena_lock);
+        return NULL;
+    }
+
+    char *pages = arena.base + index * arena.page_size;
+
+    if (mprotect(pages, count * arena.page_size, PROT_READ|PROT_WRITE) == -1) {
+        pthread_mutex_unlock(&arena_lock);
+        fprintf(stderr, "%s: error: committing of reserved pages failed.\n", __func__);
+        perror("mprotect: ");
+        return NULL;
+    }
+
+    _mark_arena_pages(index, count, true);
+    arena.committed_page_count += count;
+
+    if (index == arena.first_free_page_index) {
+        arena.first_free_page_index = index + count;
+    }
+    pthread_mutex_unlock(&arena_lock);
+
+    // Decommitted pages were dropped, committed pages are zero-filled as fresh anonymous ones
+    return pages;
+}
+
+bool_t _decommit_arena_pages(void *addr, size_t length) {
+    size_t const index = GET_ARENA_PAGE_INDEX(addr);
+    size_t const count = ALIGN_UP(length, arena.page_size) / arena.page_size;
+
+    if (madvise(addr, count * arena.page_size, MADV_DONTNEED) == -1 ||
+        mprotect(addr, count * arena.page_size, PROT_NONE) == -1) {
+        fprintf(stderr, "%s: error: decommitting of reserved pages failed.\n", __func__);
+        perror("mprotect: ");
+        return false;
+    }
+
+    pthread_mutex_lock(&arena_lock);
+    _mark_arena_pages(index, count, false);
+    arena.committed_page_count -= count;
+
+    if (index < arena.first_free_page_index) {
+        arena.first_free_page_index = index;
+    }
+    pthread_mutex_unlock(&arena_lock);
+
+    return true;
+}
+
+void _get_arena_usage(size_t *reserved_bytes, size_t *committed_bytes) {
+    pthread_mutex_lock(&arena_lock);
+    *reserved_bytes = arena.page_count * arena.page_size;
+    *committed_bytes = arena.committed_page_count * arena.page_size;
+    pthread_mutex_unlock(&arena_lock);
+}
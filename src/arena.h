@@ -0,0 +1,35 @@
+#ifndef __ARENA__
+#define __ARENA__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "memtools.h"
+
+#define ARENA_BITMAP_WORD_BITS 64
+
+/*
+Address space reserved up front with PROT_NONE, from which the default page provider commits pages
+with mprotect. Neighbouring committed pages share one kernel mapping, and pointers of halloc are
+recognized by a range check. Committed pages are marked in the bitmap, all pages below the first free
+page index are committed.
+*/
+typedef struct arena_ {
+    char *base;
+    size_t page_size;
+    size_t page_count;
+    size_t first_free_page_index;
+    size_t committed_page_count;
+    uint64_t *page_bits;
+} arena_t;
+
+bool_t _reserve_arena(size_t size, size_t page_size);
+bool_t _is_arena_reserved();
+bool_t _is_arena_address(void const *addr);
+
+void* _commit_arena_pages(size_t length, size_t alignment);
+bool_t _decommit_arena_pages(void *addr, size_t length);
+void _get_arena_usage(size_t *reserved_bytes, size_t *committed_bytes);
+
+#endif /* __ARENA__ */
@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <pthread.h>
+
+#include "memtools.h"
+#include "epoch.h"
+
+static _Alignas(CACHE_LINE_SIZE) epoch_reader_t readers[EPOCH_READER_COUNT];
+static uint64_t global_epoch = INACTIVE_EPOCH + 1;
+// Readers above this index have never been claimed and are not scanned
+static uint32_t reader_count = 0;
+static pthread_once_t reader_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t reader_key;
+static bool_t is_reader_key_created = false;
+static _Thread_local int32_t thread_reader_index = -1;
+static _Thread_local uint32_t thread_read_depth = 0;
+
+static epoch_batch_t *open_batch = NULL;
+static epoch_batch_t *first_retired_batch = NULL;
+static epoch_batch_t *last_retired_batch = NULL;
+static epoch_batch_t *spare_batches = NULL;
+static size_t deferred_free_count = 0;
+
+
+static void _release_reader(void *value) {
+    epoch_reader_t *reader = value;
+
+    // Thread has exited, possibly inside a read section
+    __atomic_store_n(&reader->epoch, INACTIVE_EPOCH, __ATOMIC_RELEASE);
+    __atomic_store_n(&reader->is_claimed, false, __ATOMIC_RELEASE);
+}
+
+static void _forget_readers_after_fork() {
+    // Only the forking thread lives on in the child, readers of the other threads would block reclamation
+    for (int32_t i = 0; i < EPOCH_READER_COUNT; i++) {
+        if (i == thread_reader_index) continue;
+
+        readers[i].epoch = INACTIVE_EPOCH;
+        readers[i].is_claimed = false;
+    }
+}
+
+static void _init_reader_key() {
+    is_reader_key_created = pthread_key_create(&reader_key, _release_reader) == 0;
+    pthread_atfork(NULL, NULL, _forget_readers_after_fork);
+}
+
+static bool_t _claim_reader() {
+    pthread_once(&reader_key_once, _init_reader_key);
+
+    for (uint32_t i = 0; i < EPOCH_READER_COUNT; i++) {
+        uint32_t is_claimed = false;
+
+        if (!__atomic_compare_exchange_n(&readers[i].is_claimed, &is_claimed, true, false,
+                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            continue;
+        }
+
+        uint32_t count = __atomic_load_n(&reader_count, __ATOMIC_RELAXED);
+
+        while (count < i + 1 && !__atomic_compare_exchange_n(&reader_count, &count, i + 1, false,
+                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+        if (is_reader_key_created) {
+            pthread_setspecific(reader_key, &readers[i]);
+        }
+        thread_reader_index = i;
+        return true;
+    }
+
+    fprintf(stderr, "%s: error: more than %u threads read at the same time.\n", __func__, EPOCH_READER_COUNT);
+    return false;
+}
+
+bool_t _enter_read_epoch() {
+    if (thread_read_depth > 0) {
+        // Nested section is covered by the outermost one
+        thread_read_depth++;
+        return true;
+    }
+    if (thread_reader_index < 0 && !_claim_reader()) {
+        return false;
+    }
+
+    epoch_reader_t *reader = &readers[thread_reader_index];
+    __atomic_store_n(&reader->epoch, __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST), __ATOMIC_RELAXED);
+
+    // Epoch must be visible to writers before the section reads anything they might unlink
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    thread_read_depth = 1;
+    return true;
+}
+
+void _exit_read_epoch() {
+    if (thread_read_depth == 0) {
+        fprintf(stderr, "%s: error: thread is not inside a read section.\n", __func__);
+        return;
+    }
+    if (--thread_read_depth > 0) {
+        return;
+    }
+    __atomic_store_n(&readers[thread_reader_index].epoch, INACTIVE_EPOCH, __ATOMIC_RELEASE);
+}
+
+static epoch_batch_t* _take_batch() {
+    epoch_batch_t *batch = spare_batches;
+
+    if (batch != NULL) {
+        spare_batches = batch->next;
+    } else {
+        batch = _create_anonymous_memory_mapping(1);
+
+        if (batch == NULL) {
+            return NULL;
+        }
+        batch->capacity = (_get_system_page_size() - sizeof(epoch_batch_t)) / sizeof(void *);
+    }
+
+    batch->next = NULL;
+    batch->epoch = INACTIVE_EPOCH;
+    batch->count = 0;
+
+    return batch;
+}
+
+static void _retire_open_batch() {
+    // Readers that enter from now on cannot reach the data blocks, they were unlinked before
+    open_batch->epoch = __atomic_fetch_add(&global_epoch, 1, __ATOMIC_SEQ_CST);
+
+    if (last_retired_batch != NULL) {
+        last_retired_batch->next = open_batch;
+    } else {
+        first_retired_batch = open_batch;
+    }
+    last_retired_batch = open_batch;
+    open_batch = NULL;
+}
+
+static uint64_t _get_oldest_reader_epoch() {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    uint32_t const count = __atomic_load_n(&reader_count, __ATOMIC_ACQUIRE);
+    uint64_t oldest_epoch = UINT64_MAX;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t const epoch = __atomic_load_n(&readers[i].epoch, __ATOMIC_ACQUIRE);
+
+        if (epoch != INACTIVE_EPOCH && epoch < oldest_epoch) {
+            oldest_epoch = epoch;
+        }
+    }
+    return oldest_epoch;
+}
+
+size_t _reclaim_deferred_frees(bool_t retire_open_batch, epoch_free_func free_func) {
+    if (retire_open_batch && open_batch != NULL && open_batch->count > 0) {
+        _retire_open_batch();
+    }
+    if (first_retired_batch == NULL) {
+        return 0;
+    }
+
+    uint64_t const oldest_epoch = _get_oldest_reader_epoch();
+    size_t freed_count = 0;
+
+    // Batches are retired in epoch order, the first one that a reader may still use ends reclamation
+    while (first_retired_batch != NULL && first_retired_batch->epoch < oldest_epoch) {
+        epoch_batch_t *batch = first_retired_batch;
+        first_retired_batch = batch->next;
+
+        for (uint32_t i = 0; i < batch->count; i++) {
+            free_func(batch->data[i]);
+        }
+        freed_count += batch->count;
+
+        batch->next = spare_batches;
+        spare_batches = batch;
+    }
+
+    if (first_retired_batch == NULL) {
+        last_retired_batch = NULL;
+    }
+    deferred_free_count -= freed_count;
+
+    return freed_count;
+}
+
+bool_t _defer_free(void *data, epoch_free_func free_func) {
+    if (open_batch == NULL) {
+        open_batch = _take_batch();
+
+        if (open_batch == NULL) {
+            fprintf(stderr, "%s: error: batch of deferred frees cannot be mapped.\n", __func__);
+            return false;
+        }
+    }
+
+    open_batch->data[open_batch->count++] = data;
+    deferred_free_count++;
+
+    if (open_batch->count == open_batch->capacity) {
+        _reclaim_deferred_frees(true, free_func);
+    }
+    return true;
+}
+
+size_t _get_deferred_free_count() {
+    return deferred_free_count;
+}
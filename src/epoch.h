@@ -0,0 +1,47 @@
+#ifndef __EPOCH__
+#define __EPOCH__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "memtools.h"
+
+#define EPOCH_READER_COUNT 256 // Threads that can be inside a read section at the same time
+#define INACTIVE_EPOCH 0
+
+typedef void (*epoch_free_func)(void *data);
+
+// Epoch of a reading thread, padded to a cache line of its own since readers write it on every enter
+typedef struct epoch_reader_ {
+    uint64_t epoch; // Global epoch when the read section was entered, zero outside of it
+    uint32_t is_claimed;
+    uint32_t : 32;
+    char padding[CACHE_LINE_SIZE - 16];
+} epoch_reader_t;
+
+_Static_assert(sizeof(epoch_reader_t) == CACHE_LINE_SIZE, "reader must fill exactly one cache line");
+
+/*
+Batch of data blocks freed by writers while readers may still use them. The open batch collects the
+data blocks, once full it is retired with the global epoch, which then advances. A retired batch is
+freed when every reader has entered its read section after the batch was retired. Batches are mapped
+pages of their own and are reused.
+*/
+typedef struct epoch_batch_ {
+    struct epoch_batch_ *next;
+    uint64_t epoch;
+    uint32_t count;
+    uint32_t capacity;
+    void *data[];
+} epoch_batch_t;
+
+bool_t _enter_read_epoch();
+void _exit_read_epoch();
+
+// Following are called under the heap lock
+bool_t _defer_free(void *data, epoch_free_func free_func);
+size_t _reclaim_deferred_frees(bool_t retire_open_batch, epoch_free_func free_func);
+size_t _get_deferred_free_count();
+
+#endif /* __EPOCH__ */
@@ -1,15 +1,32 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
+#include <sys/resource.h>
 
 #include "memtools.h"
+#include "slab.h"
+#include "numa.h"
+#include "region.h"
+#include "profile.h"
+#include "site.h"
+#include "lifetime.h"
+#include "provider.h"
+#include "arena.h"
+#include "handle.h"
+#include "refill.h"
+#include "epoch.h"
 #include "halloc.h"
 
+static bool_t IS_THREAD_SAFE = false;
+static pthread_mutex_t heap_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Thread_local bool_t is_heap_lock_held = false; // Unlocking follows the flag as read by the locking
 
-void* _halloc(char *struct_name, uint32_t struct_size, size_t units) {
+
+static bool_t _is_allocation_request_valid(char *struct_name, uint32_t struct_size, size_t units) {
     if (units < 1) {
         fprintf(stderr, "%s: error: min allocation units is one.\n", __func__);
-        return NULL;
+        return false;
     }
     if (strlen(struct_name) >= MAX_STRUCT_NAME_SIZE) {
         uint32_t const max_size = MAX_STRUCT_NAME_SIZE;
@@ -18,7 +35,7 @@ void* _halloc(char *struct_name, uint32_t struct_size, size_t units) {
             "%s: error: struct name is not allowed to be larger than %u characters.\n",
             __func__, max_size-1
         );
-        return NULL;
+        return false;
     }
 
     _set_system_page_size();
@@ -27,16 +44,19 @@ void* _halloc(char *struct_name, uint32_t struct_size, size_t units) {
 
     if (max_mem == 0) {
         fprintf(stderr, "%s: error: new page max available memory is zero.\n", __func__);
-        return NULL;
+        return false;
     }
     if (struct_size > max_mem / units) {
         fprintf(stderr,
             "%s: error: requested alloc size %u * %zu exceeds implementation limit of %u bytes.\n",
             __func__, struct_size, units, max_mem
         );
-        return NULL;
+        return false;
     }
+    return true;
+}
 
+static vm_page_item_t* _get_or_register_page_item(char *struct_name, uint32_t struct_size) {
     vm_page_item_t *vm_page_item = _lookup_page_item(struct_name);
 
     if (vm_page_item == NULL) {
@@ -51,38 +71,1206 @@ void* _halloc(char *struct_name, uint32_t struct_size, size_t units) {
             return NULL;
         }
     }
+    return vm_page_item;
+}
 
-    meta_block_t *free_meta_block = _allocate_free_data_block(
-        vm_page_item,
-        units * vm_page_item->struct_size
-    );
+// Region lock comes and goes with the region, swapping the page item registry takes the heap lock alone
+static void _lock_heap_registry() {
+    is_heap_lock_held = __atomic_load_n(&IS_THREAD_SAFE, __ATOMIC_ACQUIRE);
+    if (is_heap_lock_held) pthread_mutex_lock(&heap_lock);
+}
+
+static void _unlock_heap_registry() {
+    if (is_heap_lock_held) pthread_mutex_unlock(&heap_lock);
+    is_heap_lock_held = false;
+}
+
+static void _lock_heap() {
+    _lock_heap_registry();
+    _lock_region();
+}
+
+static void _unlock_heap() {
+    _unlock_region();
+    _unlock_heap_registry();
+}
+
+static void* _allocate_data_block_near(vm_page_item_t *vm_page_item, void const *hint, uint32_t alloc_size) {
+    vm_page_item_t *heap_page_item = _get_allocation_page_item(vm_page_item, alloc_size);
+
+    if (heap_page_item == NULL) {
+        return NULL;
+    }
+
+    // Splitting and zeroing the data block is the first touch of its pages
+    fault_sample_t fault_sample;
+    _start_fault_sample(&fault_sample);
+
+    meta_block_t *free_meta_block = _allocate_free_data_block_near(heap_page_item, hint, alloc_size);
+
+    if (free_meta_block == NULL) {
+        // Nothing fits next to the hint, the data block is placed as without one
+        free_meta_block = _allocate_free_data_block(heap_page_item, alloc_size);
+    }
 
     if (free_meta_block != NULL) {
         memset(free_meta_block + 1, 0, free_meta_block->block_size);
+        _account_fault_sample(vm_page_item, &fault_sample);
+        _account_data_block_allocation(vm_page_item, free_meta_block);
         // Return starting address of the free data block
         return free_meta_block + 1;
     }
     return NULL;
 }
 
+static void* _allocate_data_block(vm_page_item_t *vm_page_item, uint32_t alloc_size) {
+    return _allocate_data_block_near(vm_page_item, NULL, alloc_size);
+}
+
+static void* _allocate_from_page_item(vm_page_item_t *vm_page_item, void const *hint, size_t units) {
+    if (units == 1 && (vm_page_item->item_flags & PAGE_ITEM_OUT_OF_BAND)) {
+        fault_sample_t fault_sample;
+        _start_fault_sample(&fault_sample);
+
+        void *slot = _allocate_slab_slot(vm_page_item);
+
+        if (slot != NULL) {
+            memset(slot, 0, vm_page_item->struct_size);
+            _account_fault_sample(vm_page_item, &fault_sample);
+        }
+        return slot;
+    }
+
+    // Slot of a slab page has no meta block that would lead to its neighbours
+    if (hint != NULL && _is_slab_slot(hint)) {
+        hint = NULL;
+    }
+    return _allocate_data_block_near(vm_page_item, hint, units * vm_page_item->struct_size);
+}
+
+static void* _allocate_near(void const *hint, char *struct_name, uint32_t struct_size, size_t units) {
+    if (!_is_allocation_request_valid(struct_name, struct_size, units)) {
+        return NULL;
+    }
+
+    vm_page_item_t *vm_page_item = _get_or_register_page_item(struct_name, struct_size);
+
+    if (vm_page_item == NULL) {
+        return NULL;
+    }
+    return _allocate_from_page_item(vm_page_item, hint, units);
+}
+
+static void* _allocate(char *struct_name, uint32_t struct_size, size_t units) {
+    return _allocate_near(NULL, struct_name, struct_size, units);
+}
+
+static void* _allocate_with_lifetime(char *struct_name, uint32_t struct_size, size_t units, int lifetime) {
+    if (lifetime < LIFETIME_CLASS_LONG || lifetime >= LIFETIME_CLASS_COUNT) {
+        fprintf(stderr, "%s: error: unknown lifetime class %d.\n", __func__, lifetime);
+        return NULL;
+    }
+    if (lifetime == LIFETIME_CLASS_LONG) {
+        return _allocate(struct_name, struct_size, units);
+    }
+    if (!_is_allocation_request_valid(struct_name, struct_size, units)) {
+        return NULL;
+    }
+
+    vm_page_item_t *vm_page_item = _get_or_register_page_item(struct_name, struct_size);
+    vm_page_item_t *class_page_item = (vm_page_item != NULL)
+        ? _get_lifetime_class_page_item(vm_page_item, lifetime)
+        : NULL;
+
+    if (class_page_item == NULL) {
+        return NULL;
+    }
+
+    fault_sample_t fault_sample;
+    _start_fault_sample(&fault_sample);
+
+    meta_block_t *free_meta_block = _allocate_free_data_block(class_page_item, units * vm_page_item->struct_size);
+
+    if (free_meta_block == NULL) {
+        return NULL;
+    }
+    memset(free_meta_block + 1, 0, free_meta_block->block_size);
+    _account_fault_sample(vm_page_item, &fault_sample);
+    // Data block is counted by its type, the class item only lends its pages
+    _account_data_block_allocation(vm_page_item, free_meta_block);
+
+    return free_meta_block + 1;
+}
+
+static void* _allocate_aligned_data_block(vm_page_item_t *vm_page_item, uint32_t alloc_size, size_t alignment) {
+    // Aligned address is past the room for its alias meta block and at most alignment bytes in
+    char *data = _allocate_data_block(vm_page_item, alloc_size + alignment);
+
+    if (data == NULL) {
+        return NULL;
+    }
+
+    char *aligned_data = (char *)ALIGN_UP((uintptr_t)data + sizeof(meta_block_t), alignment);
+    meta_block_t *alias_meta_block = (meta_block_t *)aligned_data - 1;
+
+    alias_meta_block->is_alias = true;
+    alias_meta_block->offset = aligned_data - data;
+
+    return aligned_data;
+}
+
+static void* _allocate_aligned(char *struct_name, uint32_t struct_size, size_t units, size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        fprintf(stderr, "%s: error: alignment %zu is not a power of two.\n", __func__, alignment);
+        return NULL;
+    }
+    if (alignment <= DATA_BLOCK_ALIGNMENT) {
+        // Every data block is aligned to this already
+        return _allocate(struct_name, struct_size, units);
+    }
+    if (!_is_allocation_request_valid(struct_name, struct_size, units)) {
+        return NULL;
+    }
+
+    uint32_t const alloc_size = units * struct_size;
+
+    if (alignment > _get_page_max_available_memory(_get_max_page_units()) - alloc_size) {
+        fprintf(stderr,
+            "%s: error: alignment %zu of %s exceeds implementation limit.\n",
+            __func__, alignment, struct_name
+        );
+        return NULL;
+    }
+
+    vm_page_item_t *vm_page_item = _get_or_register_page_item(struct_name, struct_size);
+
+    if (vm_page_item == NULL) {
+        return NULL;
+    }
+    return _allocate_aligned_data_block(vm_page_item, alloc_size, alignment);
+}
+
+static void* _allocate_soa(
+    char *struct_name,
+    uint32_t struct_size,
+    uint32_t const *field_sizes,
+    size_t field_count,
+    size_t units,
+    void **field_arrays)
+{
+    if (field_count < 1 || field_sizes == NULL || field_arrays == NULL) {
+        fprintf(stderr, "%s: error: min field count is one.\n", __func__);
+        return NULL;
+    }
+
+    uint64_t row_size = 0;
+
+    for (size_t i = 0; i < field_count; i++) {
+        if (field_sizes[i] == 0) {
+            fprintf(stderr, "%s: error: field %zu of %s has size zero.\n", __func__, i, struct_name);
+            return NULL;
+        }
+        row_size += field_sizes[i];
+    }
+    if (row_size > UINT32_MAX || !_is_allocation_request_valid(struct_name, row_size, units)) {
+        return NULL;
+    }
+
+    // Every field array starts at a cache line, hence the padding of all arrays but the last
+    uint64_t alloc_size = 0;
+
+    for (size_t i = 0; i < field_count; i++) {
+        alloc_size = ALIGN_UP(alloc_size, CACHE_LINE_SIZE) + (uint64_t)field_sizes[i] * units;
+    }
+
+    if (alloc_size + CACHE_LINE_SIZE > _get_page_max_available_memory(_get_max_page_units())) {
+        fprintf(stderr,
+            "%s: error: %zu field arrays of %s exceed implementation limit.\n",
+            __func__, field_count, struct_name
+        );
+        return NULL;
+    }
+
+    // Type keeps the size of the struct, later halloc calls of it allocate whole structs
+    vm_page_item_t *vm_page_item = _get_or_register_page_item(struct_name, struct_size);
+
+    if (vm_page_item == NULL) {
+        return NULL;
+    }
+
+    char *data = _allocate_aligned_data_block(vm_page_item, alloc_size, CACHE_LINE_SIZE);
+
+    if (data == NULL) {
+        return NULL;
+    }
+
+    size_t offset = 0;
+
+    for (size_t i = 0; i < field_count; i++) {
+        offset = ALIGN_UP(offset, CACHE_LINE_SIZE);
+        field_arrays[i] = data + offset;
+        offset += (size_t)field_sizes[i] * units;
+    }
+    return data;
+}
+
+static void* _allocate_composite(
+    char *struct_name,
+    uint32_t struct_size,
+    uint32_t struct_alignment,
+    halloc_child_t const *children,
+    size_t child_count,
+    void **child_arrays)
+{
+    if (child_count < 1 || children == NULL || child_arrays == NULL) {
+        fprintf(stderr, "%s: error: min child array count is one.\n", __func__);
+        return NULL;
+    }
+    if (!_is_allocation_request_valid(struct_name, struct_size, 1)) {
+        return NULL;
+    }
+    if (struct_alignment == 0 || (struct_alignment & (struct_alignment - 1)) != 0) {
+        fprintf(stderr, "%s: error: alignment %u of %s is not a power of two.\n", __func__, struct_alignment, struct_name);
+        return NULL;
+    }
+
+    // Child arrays follow the struct, each at the alignment of its elements
+    uint64_t alloc_size = struct_size;
+    size_t alignment = (struct_alignment > DATA_BLOCK_ALIGNMENT) ? struct_alignment : DATA_BLOCK_ALIGNMENT;
+
+    for (size_t i = 0; i < child_count; i++) {
+        halloc_child_t const *child = &children[i];
+
+        if (child->size == 0 || child->units < 1) {
+            fprintf(stderr, "%s: error: child array %zu of %s is empty.\n", __func__, i, struct_name);
+            return NULL;
+        }
+        if (child->alignment == 0 || (child->alignment & (child->alignment - 1)) != 0) {
+            fprintf(stderr,
+                "%s: error: alignment %u of child array %zu of %s is not a power of two.\n",
+                __func__, child->alignment, i, struct_name
+            );
+            return NULL;
+        }
+        if (child->units > UINT32_MAX / child->size) {
+            alloc_size = UINT64_MAX;
+            break;
+        }
+        alloc_size = ALIGN_UP(alloc_size, child->alignment) + (uint64_t)child->size * child->units;
+
+        if (child->alignment > alignment) {
+            alignment = child->alignment;
+        }
+    }
+
+    // Data blocks of other alignments need room for the alias meta block
+    uint64_t const padding = (alignment > DATA_BLOCK_ALIGNMENT) ? alignment : 0;
+
+    if (alloc_size + padding > _get_page_max_available_memory(_get_max_page_units())) {
+        fprintf(stderr,
+            "%s: error: %s with %zu child arrays exceeds implementation limit.\n",
+            __func__, struct_name, child_count
+        );
+        return NULL;
+    }
+
+    vm_page_item_t *vm_page_item = _get_or_register_page_item(struct_name, struct_size);
+
+    if (vm_page_item == NULL) {
+        return NULL;
+    }
+
+    char *data = (padding > 0)
+        ? _allocate_aligned_data_block(vm_page_item, alloc_size, alignment)
+        : _allocate_data_block(vm_page_item, alloc_size);
+
+    if (data == NULL) {
+        return NULL;
+    }
+
+    size_t offset = struct_size;
+
+    for (size_t i = 0; i < child_count; i++) {
+        offset = ALIGN_UP(offset, children[i].alignment);
+        child_arrays[i] = data + offset;
+        offset += (size_t)children[i].size * children[i].units;
+    }
+    return data;
+}
+
+static int _reserve_capacity(char *struct_name, uint32_t struct_size, size_t units, int flags) {
+    if (!_is_allocation_request_valid(struct_name, struct_size, units)) {
+        return 0;
+    }
+
+    vm_page_item_t *vm_page_item = _get_or_register_page_item(struct_name, struct_size);
+
+    if (vm_page_item == NULL) {
+        return 0;
+    }
+
+    // Reserved capacity is meant for a type with a heap of its own
+    _promote_page_item(vm_page_item);
+    vm_page_item_t *heap_page_item = _get_heap_page_item(vm_page_item);
+
+    if (heap_page_item == NULL) {
+        return 0;
+    }
+
+    // Every allocation takes a meta block and padding up to the data block alignment besides its struct
+    uint64_t const reserve_size =
+        (uint64_t)units * (sizeof(meta_block_t) + ALIGN_UP(vm_page_item->struct_size, DATA_BLOCK_ALIGNMENT));
+
+    if (reserve_size > _get_page_max_available_memory(_get_max_page_units())) {
+        fprintf(stderr,
+            "%s: error: reservation of %zu units of %s exceeds implementation limit.\n",
+            __func__, units, struct_name
+        );
+        return 0;
+    }
+
+    fault_sample_t fault_sample;
+    _start_fault_sample(&fault_sample);
+
+    vm_page_t *vm_page = _reserve_vm_page(
+        heap_page_item,
+        reserve_size,
+        (flags & HALLOC_RESERVE_POPULATE) != 0,
+        (flags & HALLOC_RESERVE_LOCK) != 0
+    );
+    _account_fault_sample(vm_page_item, &fault_sample);
+
+    return vm_page != NULL;
+}
+
+static void _release_reserved_capacity(char *struct_name) {
+    vm_page_item_t *vm_page_item = _lookup_page_item(struct_name);
+
+    if (vm_page_item == NULL) {
+        fprintf(stderr,
+            "%s: error: struct `%s` hasn't been registered yet.\n",
+            __func__, struct_name
+        );
+        return;
+    }
+    _release_reserved_vm_pages(vm_page_item);
+
+    if (vm_page_item->heap_item != NULL) {
+        // Reservations of a shared heap are released for all of its types
+        _release_reserved_vm_pages(vm_page_item->heap_item);
+    }
+}
+
+#ifdef HALLOC_SITE_STATS
+// Site id of an allocated data block is kept next to its meta data, block size is the one counted by its type
+static uint32_t* _get_data_block_site_id(void *data, uint32_t *block_size) {
+    if (_is_slab_slot(data)) {
+        slab_page_t *slab_page = GET_SLAB_PAGE(data);
+        uint32_t const slot_index = GET_SLAB_SLOT_INDEX(slab_page, data);
+
+        if (slot_index >= slab_page->untouched_slot || slab_page->slot_table[slot_index] != SLAB_SLOT_ALLOCATED) {
+            return NULL;
+        }
+        *block_size = slab_page->slot_size;
+        return &GET_SLAB_SLOT_SITE_ID(slab_page, slot_index);
+    }
+
+    meta_block_t *meta_block = (meta_block_t *)data - 1;
+
+    if (meta_block->is_alias) {
+        meta_block = GET_ALIASED_META_BLOCK(meta_block);
+    }
+    if (meta_block->is_free) {
+        return NULL;
+    }
+    *block_size = meta_block->block_size;
+    return &meta_block->site_id;
+}
+#endif
+
+static void _record_allocation_site(void *data, char const *file, uint32_t line, char const *struct_name) {
+#ifdef HALLOC_SITE_STATS
+    uint32_t block_size = 0;
+    uint32_t *site_id = _get_data_block_site_id(data, &block_size);
+
+    // Called under the heap lock right after the allocation, a free data block has no site to record
+    if (site_id == NULL) {
+        return;
+    }
+    *site_id = _get_site_id(file, line, struct_name);
+    _account_site_allocation(*site_id, block_size);
+#else
+    (void)data;
+    (void)file;
+    (void)line;
+    (void)struct_name;
+#endif
+}
+
+static void _forget_allocation_site(void *data) {
+#ifdef HALLOC_SITE_STATS
+    uint32_t block_size = 0;
+    uint32_t *site_id = _get_data_block_site_id(data, &block_size);
+
+    if (site_id != NULL) {
+        _account_site_free(*site_id, block_size);
+    }
+#else
+    (void)data;
+#endif
+}
+
+static void _free(void *data) {
+    _forget_allocation_site(data);
+
+    if (_is_slab_slot(data)) {
+        // Slot has no meta block, its slab page is found from the address alone
+        _free_slab_slot(data);
+        return;
+    }
 
-void _hfree(void* data) {
-    if (data == NULL) return;
     meta_block_t *meta_block = (meta_block_t *)((char *)data - sizeof(meta_block_t));
+
+    if (meta_block->is_alias) {
+        meta_block = GET_ALIASED_META_BLOCK(meta_block);
+    }
+    _account_data_block_free(meta_block);
     _free_data_blocks(meta_block);
 }
 
+// Entry points that use the registry or the heaps hold the heap lock and the lock of an open shared heap
+
+void* _halloc(char *struct_name, uint32_t struct_size, size_t units) {
+    _lock_heap();
+    void *data = _allocate(struct_name, struct_size, units);
+    if (data != NULL) _record_allocation_site(data, NULL, 0, NULL);
+    _unlock_heap();
+
+    if (data != NULL) {
+        _sample_allocation(data, units * struct_size);
+    }
+    return data;
+}
+
+vm_page_item_t* _get_cached_page_item(vm_page_item_t **cached_item, char *struct_name, uint32_t struct_size) {
+    _lock_heap();
+
+    // Types of an open file heap or shared heap are gone once it's closed, they are never cached
+    bool_t const is_cached = !_is_region_open();
+    vm_page_item_t *vm_page_item = is_cached ? __atomic_load_n(cached_item, __ATOMIC_ACQUIRE) : NULL;
+
+    if (vm_page_item == NULL && _is_allocation_request_valid(struct_name, struct_size, 1)) {
+        vm_page_item = _get_or_register_page_item(struct_name, struct_size);
+
+        if (vm_page_item != NULL && is_cached) {
+            __atomic_store_n(cached_item, vm_page_item, __ATOMIC_RELEASE);
+        }
+    }
+    _unlock_heap();
+
+    return vm_page_item;
+}
+
+void* _halloc_page_item(vm_page_item_t *vm_page_item, size_t units, size_t alignment) {
+    uint32_t const struct_size = vm_page_item->struct_size;
+    size_t const max_alloc_size = _get_page_max_available_memory(_get_max_page_units());
+    bool_t const is_aligned = alignment > DATA_BLOCK_ALIGNMENT;
+
+    if (units < 1 || units > max_alloc_size / struct_size ||
+        (is_aligned && ((alignment & (alignment - 1)) != 0 || alignment > max_alloc_size - units * struct_size))) {
+        fprintf(stderr,
+            "%s: error: %zu units of %s with alignment %zu exceed implementation limit.\n",
+            __func__, units, vm_page_item->struct_name, alignment
+        );
+        return NULL;
+    }
+
+    _lock_heap();
+    void *data = is_aligned
+        ? _allocate_aligned_data_block(vm_page_item, units * struct_size, alignment)
+        : _allocate_from_page_item(vm_page_item, NULL, units);
+    if (data != NULL) _record_allocation_site(data, NULL, 0, NULL);
+    _unlock_heap();
+
+    if (data != NULL) {
+        _sample_allocation(data, units * struct_size);
+    }
+    return data;
+}
+
+void* _halloc_at(char *struct_name, uint32_t struct_size, size_t units, char const *file, uint32_t line) {
+    _lock_heap();
+    void *data = _allocate(struct_name, struct_size, units);
+    if (data != NULL) _record_allocation_site(data, file, line, struct_name);
+    _unlock_heap();
+
+    if (data != NULL) {
+        _sample_allocation(data, units * struct_size);
+    }
+    return data;
+}
+
+void* _halloc_near_at(void const *hint, char *struct_name, uint32_t struct_size, size_t units, char const *file, uint32_t line) {
+    _lock_heap();
+    void *data = _allocate_near(hint, struct_name, struct_size, units);
+    if (data != NULL) _record_allocation_site(data, file, line, struct_name);
+    _unlock_heap();
+
+    if (data != NULL) {
+        _sample_allocation(data, units * struct_size);
+    }
+    return data;
+}
+
+void* _halloc_near(void const *hint, char *struct_name, uint32_t struct_size, size_t units) {
+    return _halloc_near_at(hint, struct_name, struct_size, units, NULL, 0);
+}
+
+void* _halloc_aligned_at(char *struct_name, uint32_t struct_size, size_t units, size_t alignment, char const *file, uint32_t line) {
+    _lock_heap();
+    void *data = _allocate_aligned(struct_name, struct_size, units, alignment);
+    if (data != NULL) _record_allocation_site(data, file, line, struct_name);
+    _unlock_heap();
+
+    if (data != NULL) {
+        _sample_allocation(data, units * struct_size);
+    }
+    return data;
+}
+
+void* _halloc_aligned(char *struct_name, uint32_t struct_size, size_t units, size_t alignment) {
+    return _halloc_aligned_at(struct_name, struct_size, units, alignment, NULL, 0);
+}
+
+void* _halloc_with_lifetime_at(char *struct_name, uint32_t struct_size, size_t units, int lifetime, char const *file, uint32_t line) {
+    _lock_heap();
+    void *data = _allocate_with_lifetime(struct_name, struct_size, units, lifetime);
+    if (data != NULL) _record_allocation_site(data, file, line, struct_name);
+    _unlock_heap();
+
+    if (data != NULL) {
+        _sample_allocation(data, units * struct_size);
+    }
+    return data;
+}
+
+void* _halloc_with_lifetime(char *struct_name, uint32_t struct_size, size_t units, int lifetime) {
+    return _halloc_with_lifetime_at(struct_name, struct_size, units, lifetime, NULL, 0);
+}
+
+void* _halloc_soa_at(
+    char *struct_name,
+    uint32_t struct_size,
+    uint32_t const *field_sizes,
+    size_t field_count,
+    size_t units,
+    void **field_arrays,
+    char const *file,
+    uint32_t line)
+{
+    _lock_heap();
+    void *data = _allocate_soa(struct_name, struct_size, field_sizes, field_count, units, field_arrays);
+    if (data != NULL) _record_allocation_site(data, file, line, struct_name);
+    _unlock_heap();
+
+    if (data != NULL) {
+        // Field arrays span up to the end of the last one
+        _sample_allocation(data, (char *)field_arrays[field_count - 1] - (char *)data + (size_t)field_sizes[field_count - 1] * units);
+    }
+    return data;
+}
+
+void* _halloc_soa(
+    char *struct_name,
+    uint32_t struct_size,
+    uint32_t const *field_sizes,
+    size_t field_count,
+    size_t units,
+    void **field_arrays)
+{
+    return _halloc_soa_at(struct_name, struct_size, field_sizes, field_count, units, field_arrays, NULL, 0);
+}
+
+void* _halloc_composite_at(
+    char *struct_name,
+    uint32_t struct_size,
+    uint32_t struct_alignment,
+    halloc_child_t const *children,
+    size_t child_count,
+    void **child_arrays,
+    char const *file,
+    uint32_t line)
+{
+    _lock_heap();
+    void *data = _allocate_composite(struct_name, struct_size, struct_alignment, children, child_count, child_arrays);
+    if (data != NULL) _record_allocation_site(data, file, line, struct_name);
+    _unlock_heap();
+
+    if (data != NULL) {
+        // Struct and child arrays span up to the end of the last array
+        halloc_child_t const *last_child = &children[child_count - 1];
+        _sample_allocation(data, (char *)child_arrays[child_count - 1] - (char *)data + (size_t)last_child->size * last_child->units);
+    }
+    return data;
+}
+
+void* _halloc_composite(
+    char *struct_name,
+    uint32_t struct_size,
+    uint32_t struct_alignment,
+    halloc_child_t const *children,
+    size_t child_count,
+    void **child_arrays)
+{
+    return _halloc_composite_at(struct_name, struct_size, struct_alignment, children, child_count, child_arrays, NULL, 0);
+}
+
+void _hfree(void* data) {
+    if (data == NULL) return;
+
+    // Sample is forgotten first, the address might be reused as soon as it's free
+    _forget_sampled_allocation(data);
+
+    _lock_heap();
+    _free(data);
+    _unlock_heap();
+}
+
+// Sample of a deferred free stays in the profile until the data block is actually freed
+static void _free_deferred(void *data) {
+    _forget_sampled_allocation(data);
+    _free(data);
+}
+
+void _hfree_deferred(void *data) {
+    if (data == NULL) return;
+
+    _lock_heap();
+    // Without a batch the data block stays allocated, freeing it could pull it from under a reader
+    _defer_free(data, _free_deferred);
+    _unlock_heap();
+}
+
+size_t _reclaim_deferred() {
+    _lock_heap();
+    size_t const freed_count = _reclaim_deferred_frees(true, _free_deferred);
+    _unlock_heap();
+
+    return freed_count;
+}
+
+int _enter_epoch() {
+    return _enter_read_epoch();
+}
+
+void _exit_epoch() {
+    _exit_read_epoch();
+}
+
+int _reserve(char *struct_name, uint32_t struct_size, size_t units, int flags) {
+    _lock_heap();
+    int const reserved = _reserve_capacity(struct_name, struct_size, units, flags);
+    _unlock_heap();
+
+    return reserved;
+}
+
+void _release_reservation(char *struct_name) {
+    _lock_heap();
+    _release_reserved_capacity(struct_name);
+    _unlock_heap();
+}
+
 void _print_saved_page_items() {
     fprintf(stdout, "virtual memory page items (types that have memory allocated)...\n");
+    _lock_heap();
     _walk_vm_page_items();
+    _unlock_heap();
 }
 
 void _print_total_memory_usage() {
     fprintf(stdout, "total memory usage by halloc...\n");
+    _lock_heap();
     _print_memory_usage();
+    size_t const deferred_free_count = _get_deferred_free_count();
+    _unlock_heap();
+
+    if (deferred_free_count > 0) {
+        fprintf(stdout, "deferred frees waiting for readers: %zu\n\n", deferred_free_count);
+    }
+
+    if (_is_arena_reserved()) {
+        size_t reserved_bytes = 0, committed_bytes = 0;
+        _get_arena_usage(&reserved_bytes, &committed_bytes);
+
+        fprintf(stdout,
+            "reserved address space in bytes: %zu   committed bytes: %zu\n\n",
+            reserved_bytes, committed_bytes
+        );
+    }
 }
 
 void _print_type_memory_usage(char *struct_name) {
     fprintf(stdout, "detailed memory usage for type `%s`...\n", struct_name);
+    _lock_heap();
     _walk_vm_pages(struct_name);
+
+    vm_page_item_t *vm_page_item = _lookup_page_item(struct_name);
+
+    if (vm_page_item != NULL) {
+        _walk_slab_pages(vm_page_item);
+        _walk_numa_nodes(vm_page_item);
+        _walk_lifetimes(vm_page_item);
+    }
+    _unlock_heap();
+}
+
+size_t _trim_free_memory() {
+    _set_system_page_size();
+
+    _lock_heap();
+    size_t const released_bytes = _trim_vm_pages();
+    _unlock_heap();
+
+    return released_bytes;
+}
+
+static void _lock_heap_for_fork() {
+    pthread_mutex_lock(&heap_lock);
+}
+
+static void _unlock_heap_after_fork() {
+    pthread_mutex_unlock(&heap_lock);
+}
+
+void _set_thread_safety(int enabled) {
+    static bool_t is_fork_handler_registered = false;
+
+    if (enabled && !__atomic_exchange_n(&is_fork_handler_registered, true, __ATOMIC_ACQ_REL)) {
+        // Child of a multithreaded process must not inherit a lock held by another thread
+        pthread_atfork(_lock_heap_for_fork, _unlock_heap_after_fork, _unlock_heap_after_fork);
+    }
+    __atomic_store_n(&IS_THREAD_SAFE, enabled != 0, __ATOMIC_RELEASE);
+}
+
+void _set_free_memory_trim_threshold(size_t threshold) {
+    _set_trim_threshold(threshold);
+}
+
+void _set_page_growth(size_t min_pages, size_t max_pages) {
+    _set_page_growth_bounds(min_pages, max_pages);
+}
+
+void _set_heap_key(int heap_key) {
+    _set_heaps_keyed_by_size(heap_key == HALLOC_HEAP_KEY_SIZE);
+}
+
+void _set_shared_area(size_t threshold) {
+    _set_shared_area_threshold(threshold);
+}
+
+static int _set_type_layout(char *struct_name, uint32_t struct_size, int layout) {
+    if (!_is_allocation_request_valid(struct_name, struct_size, 1)) {
+        return 0;
+    }
+
+    vm_page_item_t *vm_page_item = _get_or_register_page_item(struct_name, struct_size);
+
+    if (vm_page_item == NULL) {
+        return 0;
+    }
+    return _set_out_of_band_layout(vm_page_item, layout == HALLOC_LAYOUT_OUT_OF_BAND);
+}
+
+int _set_layout(char *struct_name, uint32_t struct_size, int layout) {
+    _lock_heap();
+    int const is_set = _set_type_layout(struct_name, struct_size, layout);
+    _unlock_heap();
+
+    return is_set;
+}
+
+static int _set_type_numa_policy(char *struct_name, uint32_t struct_size, int policy, int node) {
+    if (!_is_allocation_request_valid(struct_name, struct_size, 1)) {
+        return 0;
+    }
+
+    vm_page_item_t *vm_page_item = _get_or_register_page_item(struct_name, struct_size);
+
+    if (vm_page_item == NULL || policy < 0 || node < 0) {
+        return 0;
+    }
+
+    // Placement is decided per vm page, hence the type must not live in the shared area
+    _promote_page_item(vm_page_item);
+    vm_page_item_t *heap_page_item = _get_heap_page_item(vm_page_item);
+
+    if (heap_page_item == NULL || !_set_page_item_numa_policy(vm_page_item, policy, node)) {
+        return 0;
+    }
+    if (heap_page_item != vm_page_item) {
+        // Policy of a size class heap applies to all of its types
+        _set_page_item_numa_policy(heap_page_item, policy, node);
+    }
+    return 1;
+}
+
+int _set_numa_policy(char *struct_name, uint32_t struct_size, int policy, int node) {
+    _lock_heap();
+    int const is_set = _set_type_numa_policy(struct_name, struct_size, policy, node);
+    _unlock_heap();
+
+    return is_set;
+}
+
+int _set_thread_numa_policy(int policy, int node) {
+    if (policy < 0 || node < 0) {
+        return 0;
+    }
+    return _set_thread_default_numa_policy(policy, node);
+}
+
+int _open_file_heap(char const *path, size_t size) {
+    _lock_heap_registry();
+    _set_system_page_size();
+    int const is_opened = _open_file_region(path, size);
+    _unlock_heap_registry();
+
+    return is_opened;
+}
+
+int _close_file_heap() {
+    _lock_heap_registry();
+    int const is_closed = _close_region();
+    _unlock_heap_registry();
+
+    return is_closed;
+}
+
+int _open_shared_heap(char const *name, size_t size) {
+    _lock_heap_registry();
+    _set_system_page_size();
+    int const is_opened = _open_shared_region(name, size);
+    _unlock_heap_registry();
+
+    return is_opened;
+}
+
+int _close_shared_heap() {
+    _lock_heap_registry();
+    int const is_closed = _close_region();
+    _unlock_heap_registry();
+
+    return is_closed;
+}
+
+void _set_heap_root(void *root_object) {
+    _lock_heap();
+    _set_region_root_object(root_object);
+    _unlock_heap();
+}
+
+void* _get_heap_root() {
+    _lock_heap();
+    void *root_object = _get_region_root_object();
+    _unlock_heap();
+
+    return root_object;
+}
+
+void _set_profile_rate(size_t sampling_rate) {
+    _set_profile_sampling_rate(sampling_rate);
+}
+
+int _dump_heap_profile(char const *path) {
+    return _write_heap_profile(path);
+}
+
+int _get_site_memory_usage(char const *file, int line, halloc_site_usage_t *usage) {
+    site_t site;
+
+    _lock_heap();
+    bool_t const is_found = line >= 0 && _get_site_usage(file, line, &site);
+    _unlock_heap();
+
+    if (!is_found) {
+        return 0;
+    }
+    usage->live_bytes = site.live_bytes;
+    usage->live_objects = site.live_count;
+    usage->alloc_count = site.alloc_count;
+    usage->free_count = site.free_count;
+
+    return 1;
+}
+
+void _print_site_memory_usage() {
+    fprintf(stdout, "memory usage by call sites of halloc...\n");
+    _lock_heap();
+    _walk_sites();
+    _unlock_heap();
+}
+
+int _set_lifetime_stats_clock(int clock) {
+    if (clock < 0) {
+        return 0;
+    }
+
+    _lock_heap();
+    bool_t const is_set = _set_lifetime_clock(clock);
+    _unlock_heap();
+
+    return is_set;
+}
+
+int _get_lifetime_stats(char *struct_name, uint64_t *bucket_counts) {
+    _lock_heap();
+
+    vm_page_item_t *vm_page_item = _lookup_page_item(struct_name);
+    bool_t is_found = false;
+
+    if (vm_page_item != NULL) {
+        is_found = _get_lifetime_histogram(vm_page_item, bucket_counts);
+    }
+    _unlock_heap();
+
+    return is_found;
+}
+
+int _set_page_provider_callbacks(halloc_page_provider_t const *provider) {
+    _lock_heap();
+    bool_t is_set;
+
+    if (provider == NULL) {
+        is_set = _set_page_provider(NULL);
+    } else {
+        page_provider_t const page_provider = {
+            provider->map,
+            provider->unmap,
+            provider->advise,
+            provider->get_page_size,
+            provider->context,
+        };
+        is_set = _set_page_provider(&page_provider);
+    }
+    _unlock_heap();
+
+    return is_set;
+}
+
+int _reserve_heap_address_space(size_t size) {
+    _lock_heap();
+    bool_t const is_reserved = _reserve_address_space(size);
+    _unlock_heap();
+
+    return is_reserved;
+}
+
+size_t _get_usable_size(void const *data) {
+    if (data == NULL) {
+        return 0;
+    }
+
+    _lock_heap();
+    size_t const usable_size = _is_slab_slot(data)
+        ? GET_SLAB_PAGE(data)->slot_size
+        : _get_data_block_usable_size(data);
+    _unlock_heap();
+
+    return usable_size;
+}
+
+int _is_owned(void const *data) {
+    if (data == NULL) {
+        return 0;
+    }
+
+    _lock_heap();
+    // Data blocks of vm pages start behind a vm page header, their meta blocks are in the same vm page
+    bool_t const is_owned = _is_slab_slot(data) || (
+        _is_vm_page_address(data) && _is_vm_page_address((meta_block_t const *)data - 1)
+    );
+    _unlock_heap();
+
+    return is_owned;
+}
+
+uint64_t _halloc_handle(char *struct_name, uint32_t struct_size, size_t units) {
+    _lock_heap();
+
+    vm_page_item_t *vm_page_item = _is_allocation_request_valid(struct_name, struct_size, units)
+        ? _get_or_register_page_item(struct_name, struct_size)
+        : NULL;
+    vm_page_item_t *handle_item = (vm_page_item != NULL) ? _get_handle_page_item(vm_page_item) : NULL;
+    meta_block_t *meta_block = NULL;
+    uint64_t handle = NULL_HANDLE;
+    fault_sample_t fault_sample;
+
+    _start_fault_sample(&fault_sample);
+
+    if (handle_item != NULL) {
+        meta_block = _allocate_free_data_block(handle_item, HANDLE_HEADER_SIZE + units * vm_page_item->struct_size);
+    }
+
+    if (meta_block != NULL) {
+        memset(meta_block + 1, 0, meta_block->block_size);
+        _account_fault_sample(vm_page_item, &fault_sample);
+        _account_data_block_allocation(vm_page_item, meta_block);
+
+        handle = _register_handle((char *)(meta_block + 1) + HANDLE_HEADER_SIZE);
+
+        if (handle == NULL_HANDLE) {
+            _account_data_block_free(meta_block);
+            _free_data_blocks(meta_block);
+        }
+    }
+    _unlock_heap();
+
+    return handle;
+}
+
+void* _pin_handle(uint64_t handle) {
+    _lock_heap();
+
+    handle_entry_t *entry = _lookup_handle(handle);
+    void *data = NULL;
+
+    if (entry != NULL) {
+        entry->pin_count += 1;
+        data = entry->data;
+    }
+    _unlock_heap();
+
+    return data;
+}
+
+void _unpin_handle(uint64_t handle) {
+    _lock_heap();
+
+    handle_entry_t *entry = _lookup_handle(handle);
+
+    if (entry != NULL && entry->pin_count > 0) {
+        entry->pin_count -= 1;
+    }
+    _unlock_heap();
+}
+
+void _hfree_handle(uint64_t handle) {
+    _lock_heap();
+
+    handle_entry_t *entry = _lookup_handle(handle);
+
+    if (entry == NULL) {
+        _unlock_heap();
+        fprintf(stderr, "%s: error: handle %llx is not allocated.\n", __func__, (unsigned long long)handle);
+        return;
+    }
+
+    meta_block_t *meta_block = GET_HANDLE_OBJECT_META_BLOCK(entry->data);
+
+    _unregister_handle(entry);
+    _account_data_block_free(meta_block);
+    _free_data_blocks(meta_block);
+
+    _unlock_heap();
+}
+
+size_t _compact_handles(char *struct_name, size_t max_moved_bytes) {
+    _lock_heap();
+
+    vm_page_item_t *vm_page_item = _lookup_page_item(struct_name);
+    size_t moved_bytes = 0;
+
+    if (vm_page_item != NULL && vm_page_item->handle_item != NULL) {
+        moved_bytes = _compact_handle_objects(vm_page_item->handle_item, max_moved_bytes);
+    }
+    _unlock_heap();
+
+    return moved_bytes;
+}
+
+int _set_type_refill(char *struct_name, uint32_t struct_size, size_t min_free_bytes) {
+    _lock_heap();
+
+    vm_page_item_t *vm_page_item = _is_allocation_request_valid(struct_name, struct_size, 1)
+        ? _get_or_register_page_item(struct_name, struct_size)
+        : NULL;
+    vm_page_item_t *heap_page_item = (vm_page_item != NULL) ? _get_heap_page_item(vm_page_item) : NULL;
+    bool_t is_set = false;
+
+    if (heap_page_item != NULL && min_free_bytes <= _get_page_max_available_memory(_get_max_page_units())) {
+        // Refill keeps the heap of the type filled, which is shared with types of the same size class
+        heap_page_item->refill_bytes = min_free_bytes;
+        is_set = true;
+    } else if (heap_page_item != NULL) {
+        fprintf(stderr, "%s: error: refill size %zu exceeds the max vm page size.\n", __func__, min_free_bytes);
+    }
+    _unlock_heap();
+
+    return is_set;
+}
+
+int _start_refill(unsigned interval_us) {
+    // Refill thread takes the heap lock, hence allocations must take it as well
+    _set_thread_safety(1);
+
+    return _start_refill_thread(interval_us > 0 ? interval_us : DEFAULT_REFILL_INTERVAL_US, _lock_heap, _unlock_heap);
+}
+
+void _stop_refill() {
+    _stop_refill_thread();
+}
+
+static void _copy_mapping_stats(halloc_mapping_stats_t *stats, mapping_stats_t const *mapping_stats) {
+    stats->map_count = mapping_stats->map_count;
+    stats->unmap_count = mapping_stats->unmap_count;
+    stats->release_count = mapping_stats->release_count;
+    stats->mapped_bytes = mapping_stats->mapped_bytes;
+    stats->unmapped_bytes = mapping_stats->unmapped_bytes;
+    stats->released_bytes = mapping_stats->released_bytes;
+    stats->minor_faults = mapping_stats->minor_faults;
+    stats->major_faults = mapping_stats->major_faults;
+}
+
+int _get_type_mapping_stats(char *struct_name, halloc_mapping_stats_t *stats) {
+    _lock_heap();
+
+    vm_page_item_t *vm_page_item = _lookup_page_item(struct_name);
+    mapping_stats_t mapping_stats;
+
+    if (vm_page_item != NULL) {
+        _get_page_item_mapping_stats(vm_page_item, &mapping_stats);
+    }
+    _unlock_heap();
+
+    if (vm_page_item == NULL) {
+        return 0;
+    }
+    _copy_mapping_stats(stats, &mapping_stats);
+
+    return 1;
+}
+
+int _get_total_mapping_stats(halloc_mapping_stats_t *stats) {
+    mapping_stats_t mapping_stats;
+    _get_process_mapping_stats(&mapping_stats);
+    _copy_mapping_stats(stats, &mapping_stats);
+
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        fprintf(stderr, "%s: error: page fault counts cannot be read.\n", __func__);
+        perror("getrusage: ");
+        stats->minor_faults = 0;
+        stats->major_faults = 0;
+        return 0;
+    }
+    stats->minor_faults = usage.ru_minflt;
+    stats->major_faults = usage.ru_majflt;
+
+    return 1;
+}
+
+void _set_fault_sampling_enabled(int enabled) {
+    _set_fault_sampling(enabled != 0);
 }
@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "memtools.h"
+#include "handle.h"
+
+#define GET_BLOCK_HANDLE_ENTRY(meta_block) (&handles[*(uint64_t *)((meta_block) + 1)])
+#define GET_BLOCK_HANDLE_OBJECT(meta_block) ((void *)((char *)((meta_block) + 1) + HANDLE_HEADER_SIZE))
+
+static handle_entry_t *handles = NULL;
+static uint32_t first_free_index = 0; // Index zero is never used, hence it also ends the free list
+static uint32_t untouched_index = 1; // Entries from this index on have never been used
+
+
+static bool_t _init_handles() {
+    if (handles != NULL) {
+        return true;
+    }
+
+    size_t const system_page_size = _get_system_page_size();
+    handles = _create_anonymous_memory_mapping(
+        ALIGN_UP(HANDLE_TABLE_SIZE * sizeof(handle_entry_t), system_page_size) / system_page_size
+    );
+
+    if (handles == NULL) {
+        fprintf(stderr, "%s: error: handle table cannot be mapped.\n", __func__);
+        return false;
+    }
+    return true;
+}
+
+uint64_t _register_handle(void *data) {
+    if (!_init_handles()) {
+        return NULL_HANDLE;
+    }
+
+    uint32_t index = first_free_index;
+
+    if (index != 0) {
+        first_free_index = handles[index].next_free_index;
+    } else if (untouched_index < HANDLE_TABLE_SIZE) {
+        index = untouched_index++;
+    } else {
+        fprintf(stderr, "%s: error: all %d handles are in use.\n", __func__, HANDLE_TABLE_SIZE);
+        return NULL_HANDLE;
+    }
+
+    handle_entry_t *entry = &handles[index];
+
+    if (entry->generation == 0) entry->generation = 1;
+    entry->data = data;
+    entry->pin_count = 0;
+
+    // Object knows its handle, such that compaction can update the entry of a moved object
+    *(uint64_t *)((char *)data - HANDLE_HEADER_SIZE) = index;
+
+    return ((uint64_t)entry->generation << 32) | index;
+}
+
+handle_entry_t* _lookup_handle(uint64_t handle) {
+    uint32_t const index = GET_HANDLE_INDEX(handle);
+
+    if (handles == NULL || index == 0 || index >= untouched_index) {
+        return NULL;
+    }
+
+    handle_entry_t *entry = &handles[index];
+
+    if (entry->data == NULL || entry->generation != GET_HANDLE_GENERATION(handle)) {
+        return NULL;
+    }
+    return entry;
+}
+
+void _unregister_handle(handle_entry_t *entry) {
+    entry->data = NULL;
+    entry->pin_count = 0;
+    // Generation zero is skipped, such that no handle equals NULL_HANDLE
+    entry->generation = (entry->generation == UINT32_MAX) ? 1 : entry->generation + 1;
+
+    entry->next_free_index = first_free_index;
+    first_free_index = entry - handles;
+}
+
+static vm_page_t* _find_sparsest_vm_page(vm_page_item_t *handle_item) {
+    vm_page_t *sparsest_page = NULL;
+    size_t sparsest_live_bytes = SIZE_MAX, sparsest_free_bytes = 0, total_free_bytes = 0;
+
+    vm_page_t *vm_page = handle_item->first_page;
+
+    TRAVERSE_PAGES_BEGIN(vm_page)
+    {
+        size_t live_bytes = 0, free_bytes = 0;
+        meta_block_t *meta_block = &vm_page->meta_block;
+
+        TRAVERSE_META_BLOCKS_IN_PAGE_BEGIN(meta_block)
+        {
+            if (meta_block->is_free) {
+                free_bytes += meta_block->block_size;
+            } else {
+                live_bytes += meta_block->block_size;
+            }
+        }
+        TRAVERSE_META_BLOCKS_IN_PAGE_END(meta_block);
+
+        total_free_bytes += free_bytes;
+
+        // Reserved vm pages stay mapped even when they are empty
+        if (!vm_page->reservation_flags && live_bytes < sparsest_live_bytes) {
+            sparsest_page = vm_page;
+            sparsest_live_bytes = live_bytes;
+            sparsest_free_bytes = free_bytes;
+        }
+    }
+    TRAVERSE_PAGES_END(vm_page);
+
+    // Objects of the page must fit into the free data blocks of the other pages
+    if (sparsest_page == NULL || total_free_bytes - sparsest_free_bytes < sparsest_live_bytes) {
+        return NULL;
+    }
+    return sparsest_page;
+}
+
+static meta_block_t* _move_handle_object(vm_page_item_t *handle_item, meta_block_t *meta_block) {
+    meta_block_t *moved_meta_block = _allocate_mapped_free_data_block(handle_item, meta_block->block_size);
+
+    if (moved_meta_block == NULL) {
+        return NULL;
+    }
+    memcpy(moved_meta_block + 1, meta_block + 1, meta_block->block_size);
+
+    // Moved object keeps its owner and its statistics
+    moved_meta_block->owner_id = meta_block->owner_id;
+#if META_BLOCK_EXTENSION_SIZE > 0
+    moved_meta_block->site_id = meta_block->site_id;
+    moved_meta_block->birth_stamp = meta_block->birth_stamp;
+#endif
+
+    vm_page_item_t *owner_item = _lookup_page_item_by_id(meta_block->owner_id);
+
+    if (owner_item != NULL) {
+        // Residue of the new data block may differ from the one of the old data block
+        owner_item->live_bytes += (uint64_t)moved_meta_block->block_size - meta_block->block_size;
+    }
+
+    GET_BLOCK_HANDLE_ENTRY(meta_block)->data = GET_BLOCK_HANDLE_OBJECT(moved_meta_block);
+    return moved_meta_block;
+}
+
+static size_t _evacuate_vm_page(vm_page_t *vm_page, size_t max_moved_bytes, bool_t *is_evacuated) {
+    size_t moved_bytes = 0;
+    uint32_t moved_count = 0;
+    meta_block_t *last_meta_block = NULL;
+    meta_block_t *meta_block = &vm_page->meta_block;
+
+    *is_evacuated = true;
+
+    // Free data blocks of the page are not targets of the moves
+    _detach_free_data_blocks(vm_page);
+
+    TRAVERSE_META_BLOCKS_IN_PAGE_BEGIN(meta_block)
+    {
+        last_meta_block = meta_block;
+
+        if (meta_block->is_free) {
+            continue;
+        }
+        if (GET_BLOCK_HANDLE_ENTRY(meta_block)->pin_count > 0 || moved_bytes >= max_moved_bytes ||
+            _move_handle_object(vm_page->page_item, meta_block) == NULL) {
+            *is_evacuated = false;
+            continue;
+        }
+        moved_bytes += meta_block->block_size;
+        moved_count += 1;
+    }
+    TRAVERSE_META_BLOCKS_IN_PAGE_END(meta_block);
+
+    _attach_free_data_blocks(vm_page);
+
+    // Freeing backwards merges each freed block into the previous one, which stays valid, and the
+    // vm page is unmapped by the last free only when all of its objects were moved
+    meta_block = last_meta_block;
+
+    while (meta_block != NULL && moved_count > 0) {
+        meta_block_t *prev_meta_block = PREV_META_BLOCK(meta_block);
+
+        if (!meta_block->is_free && GET_BLOCK_HANDLE_ENTRY(meta_block)->data != GET_BLOCK_HANDLE_OBJECT(meta_block)) {
+            moved_count -= 1;
+            _free_data_blocks(meta_block);
+        }
+        meta_block = prev_meta_block;
+    }
+    return moved_bytes;
+}
+
+size_t _compact_handle_objects(vm_page_item_t *handle_item, size_t max_moved_bytes) {
+    size_t moved_bytes = 0;
+    bool_t is_evacuated = true;
+
+    // Sparsest vm pages are emptied one by one until one of them keeps objects that cannot be moved
+    while (is_evacuated && moved_bytes < max_moved_bytes) {
+        vm_page_t *vm_page = _find_sparsest_vm_page(handle_item);
+
+        if (vm_page == NULL) {
+            break;
+        }
+        moved_bytes += _evacuate_vm_page(vm_page, max_moved_bytes - moved_bytes, &is_evacuated);
+    }
+    return moved_bytes;
+}
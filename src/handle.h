@@ -0,0 +1,37 @@
+#ifndef __HANDLE__
+#define __HANDLE__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "memtools.h"
+
+#define HANDLE_TABLE_SIZE (1 << 20) // Max count of live handles
+#define HANDLE_HEADER_SIZE DATA_BLOCK_ALIGNMENT // Object of a handle follows the index of the handle
+#define NULL_HANDLE 0 // Equals HALLOC_NULL_HANDLE of the public API
+
+#define GET_HANDLE_INDEX(handle) ((uint32_t)(handle))
+#define GET_HANDLE_GENERATION(handle) ((uint32_t)((handle) >> 32))
+#define GET_HANDLE_OBJECT_META_BLOCK(data) ((meta_block_t *)((char *)(data) - HANDLE_HEADER_SIZE) - 1)
+
+/*
+Entry of the handle table. A handle is the index of its entry and the generation of the entry, which
+changes when the handle is freed, such that a stale handle is never resolved to a reused entry. Objects
+of handles are moved by compaction, except while they are pinned.
+*/
+typedef struct handle_entry_ {
+    void *data; // NULL for a free entry
+    uint32_t generation;
+    uint32_t pin_count;
+    uint32_t next_free_index;
+    uint32_t : 32;
+} handle_entry_t;
+
+uint64_t _register_handle(void *data);
+handle_entry_t* _lookup_handle(uint64_t handle);
+void _unregister_handle(handle_entry_t *entry);
+
+size_t _compact_handle_objects(vm_page_item_t *handle_item, size_t max_moved_bytes);
+
+#endif /* __HANDLE__ */
@@ -0,0 +1,118 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "memtools.h"
+#include "lifetime.h"
+
+static uint32_t LIFETIME_CLOCK = LIFETIME_CLOCK_TIME;
+static uint64_t allocation_clock = 0;
+
+static char const *lifetime_clock_units[] = {"ns", "allocations"};
+
+
+bool_t _set_lifetime_clock(uint32_t clock) {
+    if (clock > LIFETIME_CLOCK_ALLOCATIONS) {
+        fprintf(stderr, "%s: error: unknown lifetime clock %u.\n", __func__, clock);
+        return false;
+    }
+    LIFETIME_CLOCK = clock;
+    return true;
+}
+
+uint32_t _get_lifetime_clock() {
+    return LIFETIME_CLOCK;
+}
+
+static uint64_t _read_lifetime_clock() {
+    if (LIFETIME_CLOCK == LIFETIME_CLOCK_ALLOCATIONS) {
+        return allocation_clock;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+uint64_t _get_birth_stamp() {
+    allocation_clock += 1;
+
+    uint64_t const stamp = _read_lifetime_clock() & ~LIFETIME_STAMP_CLOCK_BIT;
+
+    return (LIFETIME_CLOCK == LIFETIME_CLOCK_ALLOCATIONS) ? stamp | LIFETIME_STAMP_CLOCK_BIT : stamp;
+}
+
+void _record_lifetime(vm_page_item_t *vm_page_item, uint64_t birth_stamp) {
+#ifdef HALLOC_LIFETIME_STATS
+    bool_t const is_allocation_stamp = (birth_stamp & LIFETIME_STAMP_CLOCK_BIT) != 0;
+
+    if (is_allocation_stamp != (LIFETIME_CLOCK == LIFETIME_CLOCK_ALLOCATIONS)) {
+        // Data block was born before the clock changed
+        return;
+    }
+
+    uint64_t const death_stamp = _read_lifetime_clock() & ~LIFETIME_STAMP_CLOCK_BIT;
+    uint64_t const birth = birth_stamp & ~LIFETIME_STAMP_CLOCK_BIT;
+    uint64_t const lifetime = (death_stamp > birth) ? death_stamp - birth : 0;
+
+    // Bucket i > 0 counts lifetimes in [2^(i-1), 2^i), the last one counts all longer lifetimes
+    uint32_t bucket = (lifetime == 0) ? 0 : 64 - __builtin_clzll(lifetime);
+
+    if (bucket >= LIFETIME_BUCKET_COUNT) {
+        bucket = LIFETIME_BUCKET_COUNT - 1;
+    }
+    vm_page_item->lifetime_histogram[bucket] += 1;
+#else
+    (void)vm_page_item;
+    (void)birth_stamp;
+#endif
+}
+
+bool_t _get_lifetime_histogram(vm_page_item_t *vm_page_item, uint64_t *bucket_counts) {
+#ifdef HALLOC_LIFETIME_STATS
+    memcpy(bucket_counts, vm_page_item->lifetime_histogram, sizeof vm_page_item->lifetime_histogram);
+    return true;
+#else
+    (void)vm_page_item;
+    memset(bucket_counts, 0, LIFETIME_BUCKET_COUNT * sizeof(uint64_t));
+    return false;
+#endif
+}
+
+void _walk_lifetimes(vm_page_item_t *vm_page_item) {
+    uint64_t bucket_counts[LIFETIME_BUCKET_COUNT];
+
+    if (!_get_lifetime_histogram(vm_page_item, bucket_counts)) {
+        return;
+    }
+
+    bool_t is_header_printed = false;
+
+    for (uint32_t bucket = 0; bucket < LIFETIME_BUCKET_COUNT; bucket++) {
+        if (bucket_counts[bucket] == 0) continue;
+
+        if (!is_header_printed) {
+            fprintf(stdout, "> lifetimes of freed data blocks in %s:\n", lifetime_clock_units[LIFETIME_CLOCK]);
+            is_header_printed = true;
+        }
+
+        uint64_t const lower_bound = (bucket == 0) ? 0 : (uint64_t)1 << (bucket - 1);
+
+        if (bucket == LIFETIME_BUCKET_COUNT - 1) {
+            fprintf(stdout, ">   %llu or longer: %llu\n",
+                (unsigned long long)lower_bound, (unsigned long long)bucket_counts[bucket]
+            );
+        } else {
+            fprintf(stdout, ">   %llu to %llu: %llu\n",
+                (unsigned long long)lower_bound, (unsigned long long)((uint64_t)1 << bucket) - 1,
+                (unsigned long long)bucket_counts[bucket]
+            );
+        }
+    }
+    if (is_header_printed) {
+        fprintf(stdout, "\n");
+    }
+}
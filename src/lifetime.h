@@ -0,0 +1,26 @@
+#ifndef __LIFETIME__
+#define __LIFETIME__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "memtools.h"
+
+// Clocks equal to HALLOC_LIFETIME_CLOCK_* of the public API
+#define LIFETIME_CLOCK_TIME 0 // Nanoseconds of the monotonic clock
+#define LIFETIME_CLOCK_ALLOCATIONS 1 // Count of allocations by halloc
+
+// Highest bit of a birth stamp tells its clock, lifetimes are only measured with the same clock
+#define LIFETIME_STAMP_CLOCK_BIT ((uint64_t)1 << 63)
+
+bool_t _set_lifetime_clock(uint32_t clock);
+uint32_t _get_lifetime_clock();
+
+uint64_t _get_birth_stamp();
+void _record_lifetime(vm_page_item_t *vm_page_item, uint64_t birth_stamp);
+
+bool_t _get_lifetime_histogram(vm_page_item_t *vm_page_item, uint64_t *bucket_counts);
+void _walk_lifetimes(vm_page_item_t *vm_page_item);
+
+#endif /* __LIFETIME__ */
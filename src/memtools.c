@@ -1,31 +1,48 @@
+#define _GNU_SOURCE
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <errno.h>
 #include <memory.h>
+#include <time.h>
 #include <unistd.h>
-
-#define __USE_MISC
-#include <sys/mman.h>
+#include <sys/resource.h>
 
 #include "dll.h"
 #include "memtools.h"
+#include "numa.h"
+#include "region.h"
+#include "provider.h"
+#include "lifetime.h"
 
 
 static size_t SYSTEM_PAGE_SIZE = 0;
 static size_t MAX_PAGE_UNITS = 0;
+static size_t TRIM_THRESHOLD = DEFAULT_TRIM_THRESHOLD_BYTES;
+static bool_t IS_FAULT_SAMPLING_ENABLED = false;
+static size_t MIN_PAGE_GROWTH_UNITS = DEFAULT_MIN_PAGE_GROWTH_UNITS;
+static size_t MAX_PAGE_GROWTH_UNITS = DEFAULT_MAX_PAGE_GROWTH_UNITS;
+static bool_t HEAPS_KEYED_BY_SIZE = false;
+static size_t SHARED_AREA_THRESHOLD = 0;
+static vm_page_item_t *shared_area_page_item = NULL;
 static vm_page_item_container_t *first_vm_page_item_container = NULL;
+// Registry in use, either the one above or the one of an open file heap
+static vm_page_item_container_t **page_item_registry = &first_vm_page_item_container;
+static uint32_t FIRST_PAGE_ITEM_ID = 0;
+// Map from system pages to a bit telling whether the page belongs to a vm page mapped by this process.
+// Pages of a file heap or a shared heap are recognized by the region instead.
+static uint64_t **vm_page_map = NULL;
+// Mapping calls of the whole process, also of internal tables, updated atomically since pages
+// are mapped also without the heap lock, e.g. by the refill thread
+static mapping_stats_t process_mapping_stats = {0};
 
 void _set_system_page_size() {
-    long page_size = sysconf(_SC_PAGESIZE);
-
-    if (page_size == -1) {
-        fprintf(stderr, "%s: %s\n", __func__, strerror(errno));
-    }
+    // Pages of the default provider are the system pages
+    size_t const page_size = _get_provider_page_size();
 
     if (page_size < SYS_MIN_PAGE_SIZE) {
         fprintf(stderr,
-            "%s: error: system page size %ld doesn't meet the required minimum %d\n",
+            "%s: error: system page size %zu doesn't meet the required minimum %d\n",
             __func__, page_size, SYS_MIN_PAGE_SIZE
         );
         exit(EXIT_FAILURE);
@@ -55,36 +72,279 @@ size_t _get_max_page_units() {
     return MAX_PAGE_UNITS;
 }
 
-static void* _create_memory_mapping(size_t units) {
-    char *vm_page = mmap(
-        NULL,
-        units * SYSTEM_PAGE_SIZE,
-        PROT_READ|PROT_WRITE,
-        MAP_PRIVATE|MAP_ANONYMOUS,
-        -1,
-        0
-    );
+void _set_trim_threshold(size_t threshold) {
+    TRIM_THRESHOLD = threshold;
+}
+
+size_t _get_trim_threshold() {
+    return TRIM_THRESHOLD;
+}
+
+bool_t _set_page_growth_bounds(size_t min_units, size_t max_units) {
+    if (min_units < 1 || min_units > max_units) {
+        fprintf(stderr,
+            "%s: error: invalid page growth bounds %zu and %zu.\n",
+            __func__, min_units, max_units
+        );
+        return false;
+    }
+
+    MIN_PAGE_GROWTH_UNITS = min_units;
+    MAX_PAGE_GROWTH_UNITS = max_units;
+    return true;
+}
+
+size_t _get_required_page_units(uint32_t alloc_size) {
+    // vm page header and the first meta block must fit in front of the data block
+    size_t const required_size = alloc_size + GET_FIELD_OFFSET(vm_page_t, page_memory);
+
+    return ALIGN_UP(required_size, SYSTEM_PAGE_SIZE) / SYSTEM_PAGE_SIZE;
+}
 
-    if (vm_page == MAP_FAILED) {
+static void _count_mapping_call(uint64_t *call_count, uint64_t *byte_count, size_t length) {
+    __atomic_fetch_add(call_count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(byte_count, length, __ATOMIC_RELAXED);
+}
+
+static void* _create_anonymous_memory_mapping_with_flags(size_t units, int flags) {
+    char *vm_page = _map_provider_pages(units * SYSTEM_PAGE_SIZE, SYSTEM_PAGE_SIZE, flags);
+
+    if (vm_page == NULL) {
         fprintf(stderr, "%s: error: virtual memory mapping failed.\n", __func__);
-        perror("mmap: ");
         return NULL;
     }
-
-    memset(vm_page, 0, units * SYSTEM_PAGE_SIZE);
+    _count_mapping_call(&process_mapping_stats.map_count, &process_mapping_stats.mapped_bytes, units * SYSTEM_PAGE_SIZE);
 
     return vm_page;
 }
 
-static void _delete_memory_mapping(void *addr, size_t units) {
-    if (munmap(addr, units * SYSTEM_PAGE_SIZE) == -1) {
+static void* _create_memory_mapping_with_flags(size_t units, int flags) {
+    if (!_is_region_open()) {
+        return _create_anonymous_memory_mapping_with_flags(units, flags);
+    }
+
+    // Pages of an open file heap or shared heap are zero-filled as anonymous ones
+    void *region_pages = _allocate_region_pages(units, 1);
+
+    if (region_pages != NULL && (flags & PAGE_PROVIDER_POPULATE)) {
+        _populate_pages(region_pages, units * SYSTEM_PAGE_SIZE, SYSTEM_PAGE_SIZE);
+    }
+    return region_pages;
+}
+
+void* _create_memory_mapping(size_t units) {
+    return _create_memory_mapping_with_flags(units, 0);
+}
+
+void* _create_anonymous_memory_mapping(size_t units) {
+    return _create_anonymous_memory_mapping_with_flags(units, 0);
+}
+
+void _delete_memory_mapping(void *addr, size_t units) {
+    if (_is_region_address(addr)) {
+        _free_region_pages(addr, units);
+        return;
+    }
+
+    if (!_unmap_provider_pages(addr, units * SYSTEM_PAGE_SIZE)) {
         fprintf(stderr, "%s: error: deletion of virtual memory mapping failed.\n", __func__);
-        perror("munmap: ");
+        return;
+    }
+    _count_mapping_call(&process_mapping_stats.unmap_count, &process_mapping_stats.unmapped_bytes, units * SYSTEM_PAGE_SIZE);
+}
+
+void* _create_aligned_memory_mapping(size_t units) {
+    if (_is_region_open()) {
+        return _allocate_region_pages(units, units);
+    }
+
+    size_t const mapping_size = units * SYSTEM_PAGE_SIZE;
+    char *addr = _map_provider_pages(mapping_size, mapping_size, 0);
+
+    if (addr == NULL) {
+        fprintf(stderr, "%s: error: aligned virtual memory mapping failed.\n", __func__);
+        return NULL;
+    }
+    _count_mapping_call(&process_mapping_stats.map_count, &process_mapping_stats.mapped_bytes, mapping_size);
+
+    return addr;
+}
+
+static size_t _release_memory_mapping_range(void *addr, size_t length) {
+    if (!_advise_provider_pages(addr, length, PAGE_PROVIDER_ADVICE_RELEASE)) {
+        fprintf(stderr, "%s: error: releasing of virtual memory range failed.\n", __func__);
+        return 0;
+    }
+    _count_mapping_call(&process_mapping_stats.release_count, &process_mapping_stats.released_bytes, length);
+
+    return length;
+}
+
+void _account_mapped_pages(vm_page_item_t *vm_page_item, void const *addr, size_t length) {
+    // Pages of an open file heap or shared heap are taken from the region without a mapping call
+    if (_is_region_address(addr)) return;
+
+    vm_page_item->mapping_stats.map_count += 1;
+    vm_page_item->mapping_stats.mapped_bytes += length;
+}
+
+void _account_unmapped_pages(vm_page_item_t *vm_page_item, void const *addr, size_t length) {
+    if (_is_region_address(addr)) return;
+
+    vm_page_item->mapping_stats.unmap_count += 1;
+    vm_page_item->mapping_stats.unmapped_bytes += length;
+}
+
+static void _add_mapping_stats(mapping_stats_t *stats, mapping_stats_t const *added_stats) {
+    stats->map_count += added_stats->map_count;
+    stats->unmap_count += added_stats->unmap_count;
+    stats->release_count += added_stats->release_count;
+    stats->mapped_bytes += added_stats->mapped_bytes;
+    stats->unmapped_bytes += added_stats->unmapped_bytes;
+    stats->released_bytes += added_stats->released_bytes;
+    stats->minor_faults += added_stats->minor_faults;
+    stats->major_faults += added_stats->major_faults;
+}
+
+void _get_page_item_mapping_stats(vm_page_item_t const *vm_page_item, mapping_stats_t *stats) {
+    *stats = vm_page_item->mapping_stats;
+
+    // Pages of a heap shared by types of the same size are mapped for all of them, hence
+    // each type reports the calls of the whole heap
+    if (vm_page_item->heap_item != NULL) {
+        _add_mapping_stats(stats, &vm_page_item->heap_item->mapping_stats);
+    }
+    if (vm_page_item->handle_item != NULL) {
+        _add_mapping_stats(stats, &vm_page_item->handle_item->mapping_stats);
+    }
+    for (uint32_t i = 0; i < LIFETIME_CLASS_COUNT; i++) {
+        if (vm_page_item->lifetime_class_items[i] != NULL) {
+            _add_mapping_stats(stats, &vm_page_item->lifetime_class_items[i]->mapping_stats);
+        }
+    }
+}
+
+void _get_process_mapping_stats(mapping_stats_t *stats) {
+    stats->map_count = __atomic_load_n(&process_mapping_stats.map_count, __ATOMIC_RELAXED);
+    stats->unmap_count = __atomic_load_n(&process_mapping_stats.unmap_count, __ATOMIC_RELAXED);
+    stats->release_count = __atomic_load_n(&process_mapping_stats.release_count, __ATOMIC_RELAXED);
+    stats->mapped_bytes = __atomic_load_n(&process_mapping_stats.mapped_bytes, __ATOMIC_RELAXED);
+    stats->unmapped_bytes = __atomic_load_n(&process_mapping_stats.unmapped_bytes, __ATOMIC_RELAXED);
+    stats->released_bytes = __atomic_load_n(&process_mapping_stats.released_bytes, __ATOMIC_RELAXED);
+    // Faults of the whole process are read from the kernel instead
+    stats->minor_faults = 0;
+    stats->major_faults = 0;
+}
+
+void _set_fault_sampling(bool_t enabled) {
+    __atomic_store_n(&IS_FAULT_SAMPLING_ENABLED, enabled, __ATOMIC_RELAXED);
+}
+
+void _start_fault_sample(fault_sample_t *sample) {
+    sample->is_started = false;
+
+    if (!__atomic_load_n(&IS_FAULT_SAMPLING_ENABLED, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    struct rusage usage;
+
+    // Only faults of the calling thread, other threads keep touching their own memory meanwhile
+    if (getrusage(RUSAGE_THREAD, &usage) != 0) {
+        return;
+    }
+    sample->minor_faults = usage.ru_minflt;
+    sample->major_faults = usage.ru_majflt;
+    sample->is_started = true;
+}
+
+void _account_fault_sample(vm_page_item_t *vm_page_item, fault_sample_t const *sample) {
+    struct rusage usage;
+
+    if (!sample->is_started || vm_page_item == NULL || getrusage(RUSAGE_THREAD, &usage) != 0) {
+        return;
+    }
+    vm_page_item->mapping_stats.minor_faults += usage.ru_minflt - sample->minor_faults;
+    vm_page_item->mapping_stats.major_faults += usage.ru_majflt - sample->major_faults;
+}
+
+static uint64_t* _get_vm_page_map_leaf(uintptr_t page_key, bool_t create) {
+    if (page_key >> (2 * VM_PAGE_MAP_LEVEL_SHIFT)) {
+        // Address beyond the range of the map, such an address is never a vm page
+        return NULL;
+    }
+
+    size_t const level_size = (size_t)1 << VM_PAGE_MAP_LEVEL_SHIFT;
+
+    if (vm_page_map == NULL) {
+        if (!create) return NULL;
+
+        // Zero-filled root gets faulted in only where leafs are stored
+        vm_page_map = _create_anonymous_memory_mapping(
+            ALIGN_UP(level_size * sizeof(uint64_t *), SYSTEM_PAGE_SIZE) / SYSTEM_PAGE_SIZE
+        );
+        if (vm_page_map == NULL) {
+            return NULL;
+        }
+    }
+
+    uint64_t **leaf = &vm_page_map[page_key >> VM_PAGE_MAP_LEVEL_SHIFT];
+
+    if (*leaf == NULL && create) {
+        *leaf = _create_anonymous_memory_mapping(ALIGN_UP(level_size / 8, SYSTEM_PAGE_SIZE) / SYSTEM_PAGE_SIZE);
+    }
+    return *leaf;
+}
+
+static void _mark_vm_page(vm_page_t *vm_page, bool_t is_mapped) {
+    if (_is_region_address(vm_page)) {
+        return;
+    }
+
+    uintptr_t const first_page_key = (uintptr_t)vm_page / SYSTEM_PAGE_SIZE;
+
+    for (uintptr_t page_key = first_page_key; page_key < first_page_key + vm_page->system_page_count; page_key++) {
+        uint64_t *leaf = _get_vm_page_map_leaf(page_key, is_mapped);
+
+        if (leaf == NULL) {
+            if (is_mapped) {
+                fprintf(stderr, "%s: error: vm page %p cannot be added to the map.\n", __func__, (void *)vm_page);
+            }
+            return;
+        }
+
+        uint32_t const bit = page_key & ((1UL << VM_PAGE_MAP_LEVEL_SHIFT) - 1);
+
+        if (is_mapped) {
+            leaf[bit / 64] |= (uint64_t)1 << (bit % 64);
+        } else {
+            leaf[bit / 64] &= ~((uint64_t)1 << (bit % 64));
+        }
+    }
+}
+
+bool_t _is_vm_page_address(void const *addr) {
+    if (_is_region_address(addr)) {
+        return true;
+    }
+    if (vm_page_map == NULL) {
+        return false;
+    }
+
+    uintptr_t const page_key = (uintptr_t)addr / SYSTEM_PAGE_SIZE;
+    uint64_t *leaf = _get_vm_page_map_leaf(page_key, false);
+
+    if (leaf == NULL) {
+        return false;
     }
+
+    uint32_t const bit = page_key & ((1UL << VM_PAGE_MAP_LEVEL_SHIFT) - 1);
+
+    return (leaf[bit / 64] >> (bit % 64)) & 1;
 }
 
 vm_page_item_t* _lookup_page_item(char const *struct_name) {
-    vm_page_item_container_t *vm_page_item_container = first_vm_page_item_container;
+    vm_page_item_container_t *vm_page_item_container = *page_item_registry;
 
     TRAVERSE_PAGE_CONTAINERS_BEGIN(vm_page_item_container)
     {
@@ -103,38 +363,67 @@ vm_page_item_t* _lookup_page_item(char const *struct_name) {
     return NULL;
 }
 
+static void _init_page_item(
+    vm_page_item_t *vm_page_item,
+    char const *struct_name,
+    uint32_t struct_size,
+    uint32_t item_id)
+{
+    // Safety: '\0' fits into dest char array but ensure it anyway in the following
+    strncpy(vm_page_item->struct_name, struct_name, MAX_STRUCT_NAME_SIZE);
+    vm_page_item->struct_name[MAX_STRUCT_NAME_SIZE - 1] = '\0';
+
+    vm_page_item->struct_size = struct_size;
+    vm_page_item->growth_page_count = MIN_PAGE_GROWTH_UNITS;
+    vm_page_item->growth_stamp_ns = 0;
+    vm_page_item->item_id = item_id;
+    vm_page_item->item_flags = 0;
+    vm_page_item->numa_policy = 0;
+    vm_page_item->numa_node = 0;
+    vm_page_item->heap_item = NULL;
+    vm_page_item->handle_item = NULL;
+    memset(vm_page_item->lifetime_class_items, 0, sizeof(vm_page_item->lifetime_class_items));
+    vm_page_item->refill_bytes = 0;
+    vm_page_item->first_page = NULL;
+    vm_page_item->first_slab_page = NULL;
+
+    vm_page_item->live_block_count = 0;
+    vm_page_item->live_bytes = 0;
+    vm_page_item->alloc_count = 0;
+    vm_page_item->free_count = 0;
+    memset(&vm_page_item->mapping_stats, 0, sizeof(mapping_stats_t));
+
+    _init_node(&vm_page_item->heap_root_node);
+}
+
 static void _register_page_item_to_first_container(char const *struct_name, uint32_t struct_size) {
-    first_vm_page_item_container = _create_memory_mapping(1);
+    *page_item_registry = _create_memory_mapping(1);
 
-    if (first_vm_page_item_container == NULL) {
+    if (*page_item_registry == NULL) {
         return;
     }
-    first_vm_page_item_container->next = NULL;
-
-    // Safety: '\0' fits into dest char array but ensure it anyway in the following
-    strncpy(first_vm_page_item_container->vm_page_items->struct_name, struct_name, MAX_STRUCT_NAME_SIZE);
-    first_vm_page_item_container->vm_page_items->struct_name[MAX_STRUCT_NAME_SIZE - 1] = '\0';
+    (*page_item_registry)->next = NULL;
 
-    first_vm_page_item_container->vm_page_items->struct_size = struct_size;
-    first_vm_page_item_container->vm_page_items->first_page = NULL;
-
-    _init_node(&first_vm_page_item_container->vm_page_items->heap_root_node);
+    _init_page_item((*page_item_registry)->vm_page_items, struct_name, struct_size, FIRST_PAGE_ITEM_ID);
 }
 
 void _register_page_item(char const *struct_name, uint32_t struct_size) {
-    if (first_vm_page_item_container == NULL) {
+    if (*page_item_registry == NULL) {
         _register_page_item_to_first_container(struct_name, struct_size);
         return;
     }
 
     uint32_t counter = 0;
-    vm_page_item_t *vm_page_item = first_vm_page_item_container->vm_page_items;
+    vm_page_item_t *vm_page_item = (*page_item_registry)->vm_page_items;
+    // Item ids are consecutive, each container continues from the ids of the previous one
+    uint32_t item_id = vm_page_item->item_id;
 
     TRAVERSE_PAGE_ITEMS_BEGIN(vm_page_item)
     {
         if (strncmp(vm_page_item->struct_name, struct_name, MAX_STRUCT_NAME_SIZE) != 0) {
             ++counter;
         }
+        ++item_id;
     }
     TRAVERSE_PAGE_ITEMS_END(vm_page_item);
 
@@ -143,66 +432,302 @@ void _register_page_item(char const *struct_name, uint32_t struct_size) {
         if (new_vm_page_item_container == NULL) {
             return;
         }
-        new_vm_page_item_container->next = first_vm_page_item_container;
-        first_vm_page_item_container = new_vm_page_item_container;
-        vm_page_item = first_vm_page_item_container->vm_page_items;
+        new_vm_page_item_container->next = *page_item_registry;
+        *page_item_registry = new_vm_page_item_container;
+        vm_page_item = (*page_item_registry)->vm_page_items;
     }
 
-    // Safety: '\0' fits into dest char array but ensure it anyway in the following
-    strncpy(vm_page_item->struct_name, struct_name, MAX_STRUCT_NAME_SIZE);
-    vm_page_item->struct_name[MAX_STRUCT_NAME_SIZE - 1] = '\0';
+    _init_page_item(vm_page_item, struct_name, struct_size, item_id);
+}
 
-    vm_page_item->struct_size = struct_size;
-    vm_page_item->first_page = NULL;
+void _set_page_item_registry(vm_page_item_container_t **registry, uint32_t first_item_id) {
+    page_item_registry = registry ? registry : &first_vm_page_item_container;
+    FIRST_PAGE_ITEM_ID = registry ? first_item_id : 0;
 
-    _init_node(&vm_page_item->heap_root_node);
+    // Cached item belongs to the previous registry
+    shared_area_page_item = NULL;
+}
+
+vm_page_item_t* _lookup_page_item_by_id(uint32_t item_id) {
+    vm_page_item_container_t *vm_page_item_container = *page_item_registry;
+
+    TRAVERSE_PAGE_CONTAINERS_BEGIN(vm_page_item_container)
+    {
+        uint32_t const first_item_id = vm_page_item_container->vm_page_items->item_id;
+
+        if (item_id >= first_item_id && item_id - first_item_id < MAX_PAGE_ITEMS_PER_PAGE_CONTAINER) {
+            vm_page_item_t *vm_page_item = &vm_page_item_container->vm_page_items[item_id - first_item_id];
+            return vm_page_item->struct_size ? vm_page_item : NULL;
+        }
+    }
+    TRAVERSE_PAGE_CONTAINERS_END(vm_page_item_container);
+
+    return NULL;
+}
+
+void _set_heaps_keyed_by_size(bool_t keyed_by_size) {
+    HEAPS_KEYED_BY_SIZE = keyed_by_size;
+}
+
+void _set_shared_area_threshold(size_t threshold) {
+    SHARED_AREA_THRESHOLD = threshold;
+}
+
+static vm_page_item_t* _get_internal_page_item(char const *heap_name, uint32_t struct_size, uint32_t item_flags) {
+    vm_page_item_t *heap_item = _lookup_page_item(heap_name);
+
+    if (heap_item == NULL) {
+        _register_page_item(heap_name, struct_size);
+        heap_item = _lookup_page_item(heap_name);
+
+        if (heap_item == NULL) {
+            return NULL;
+        }
+        heap_item->item_flags |= item_flags;
+    }
+    return heap_item;
+}
+
+vm_page_item_t* _get_heap_page_item(vm_page_item_t *vm_page_item) {
+    if (!HEAPS_KEYED_BY_SIZE || (vm_page_item->item_flags & PAGE_ITEM_INTERNAL)) {
+        return vm_page_item;
+    }
+
+    if (vm_page_item->heap_item == NULL) {
+        // Alignment of a type divides its size, hence a type can share blocks with any other
+        // type of the same size and the heap key needs only the size
+        char heap_name[MAX_STRUCT_NAME_SIZE];
+        snprintf(heap_name, sizeof heap_name, "<size %u>", vm_page_item->struct_size);
+
+        vm_page_item->heap_item = _get_internal_page_item(
+            heap_name,
+            vm_page_item->struct_size,
+            PAGE_ITEM_SIZE_CLASS
+        );
+    }
+    return vm_page_item->heap_item;
+}
+
+vm_page_item_t* _get_handle_page_item(vm_page_item_t *vm_page_item) {
+    if (vm_page_item->handle_item == NULL) {
+        // Objects reached by handles get pages of their own, such that every block of them can be moved
+        char heap_name[MAX_STRUCT_NAME_SIZE];
+        snprintf(heap_name, sizeof heap_name, "<handles %u>", vm_page_item->item_id);
+
+        vm_page_item->handle_item = _get_internal_page_item(
+            heap_name,
+            vm_page_item->struct_size,
+            PAGE_ITEM_HANDLES
+        );
+    }
+    return vm_page_item->handle_item;
+}
+
+vm_page_item_t* _get_lifetime_class_page_item(vm_page_item_t *vm_page_item, uint32_t lifetime_class) {
+    if (lifetime_class == LIFETIME_CLASS_LONG || lifetime_class >= LIFETIME_CLASS_COUNT) {
+        return NULL;
+    }
+
+    if (vm_page_item->lifetime_class_items[lifetime_class] == NULL) {
+        // Pages of short-lived objects empty together and are unmapped wholesale, pages of permanent
+        // ones are never left with holes, as neither shares a page with the other classes
+        char heap_name[MAX_STRUCT_NAME_SIZE];
+        snprintf(heap_name, sizeof heap_name,
+            (lifetime_class == LIFETIME_CLASS_SHORT) ? "<short %u>" : "<permanent %u>",
+            vm_page_item->item_id
+        );
+
+        vm_page_item->lifetime_class_items[lifetime_class] = _get_internal_page_item(
+            heap_name,
+            vm_page_item->struct_size,
+            PAGE_ITEM_LIFETIME_CLASS
+        );
+    }
+    return vm_page_item->lifetime_class_items[lifetime_class];
+}
+
+void _promote_page_item(vm_page_item_t *vm_page_item) {
+    vm_page_item->item_flags |= PAGE_ITEM_PROMOTED;
+}
+
+vm_page_item_t* _get_allocation_page_item(vm_page_item_t *vm_page_item, uint32_t alloc_size) {
+    if (vm_page_item->item_flags & PAGE_ITEM_INTERNAL) {
+        return vm_page_item;
+    }
+
+    bool_t const is_small = (
+        SHARED_AREA_THRESHOLD > 0 && vm_page_item->live_bytes + alloc_size <= SHARED_AREA_THRESHOLD
+    );
+
+    if (!is_small || (vm_page_item->item_flags & PAGE_ITEM_PROMOTED)) {
+        // Type that has once outgrown the shared area keeps using its own heap
+        if (SHARED_AREA_THRESHOLD > 0) _promote_page_item(vm_page_item);
+        return _get_heap_page_item(vm_page_item);
+    }
+
+    if (shared_area_page_item == NULL) {
+        shared_area_page_item = _get_internal_page_item("<shared>", 1, PAGE_ITEM_SHARED_AREA);
+    }
+    return shared_area_page_item;
+}
+
+void _account_data_block_allocation(vm_page_item_t *vm_page_item, meta_block_t *meta_block) {
+    meta_block->owner_id = vm_page_item->item_id;
+
+    vm_page_item->live_block_count += 1;
+    vm_page_item->live_bytes += meta_block->block_size;
+    vm_page_item->alloc_count += 1;
+
+#ifdef HALLOC_LIFETIME_STATS
+    meta_block->birth_stamp = _get_birth_stamp();
+#endif
+}
+
+void _account_data_block_free(meta_block_t *meta_block) {
+    vm_page_item_t *vm_page_item = _lookup_page_item_by_id(meta_block->owner_id);
+
+    if (vm_page_item == NULL || vm_page_item->live_block_count == 0) {
+        return;
+    }
+
+    vm_page_item->live_block_count -= 1;
+    vm_page_item->live_bytes -= meta_block->block_size;
+    vm_page_item->free_count += 1;
+
+#ifdef HALLOC_LIFETIME_STATS
+    _record_lifetime(vm_page_item, meta_block->birth_stamp);
+#endif
+}
+
+meta_block_t* _get_next_meta_block(meta_block_t *meta_block) {
+    vm_page_t *vm_page = GET_META_PAGE(meta_block, meta_block->offset);
+    size_t const next_offset = meta_block->offset + sizeof(meta_block_t) + GET_DATA_BLOCK_SPAN(meta_block);
+
+    // Last data block of a vm page always extends to the end of the page
+    if (next_offset >= vm_page->system_page_count * SYSTEM_PAGE_SIZE) {
+        return NULL;
+    }
+    return NEXT_META_BLOCK_BY_SIZE(meta_block);
+}
+
+size_t _get_data_block_usable_size(void const *data) {
+    meta_block_t const *meta_block = (meta_block_t const *)data - 1;
+
+    if (meta_block->is_alias) {
+        // Usable memory of an aligned address ends with its data block
+        return GET_DATA_BLOCK_SPAN(GET_ALIASED_META_BLOCK(meta_block)) - meta_block->offset;
+    }
+    // Padding and a residue too small for a free block belong to the data block
+    return GET_DATA_BLOCK_SPAN(meta_block);
 }
 
 static bool_t _is_vm_page_empty(vm_page_t *vm_page) {
-    meta_block_t first_meta_block = vm_page->meta_block;
-    return first_meta_block.is_free && (first_meta_block.next == NULL && first_meta_block.prev == NULL);
+    return vm_page->meta_block.is_free && NEXT_META_BLOCK(&vm_page->meta_block) == NULL;
+}
+
+static bool_t _is_free_data_block_released(meta_block_t *meta_block) {
+    // Mark is set once all whole system pages behind it were released and kept while they stay released
+    return meta_block->block_size >= MIN_RELEASABLE_FREE_DATA_BLOCK_SIZE && *GET_FREE_BLOCK_RELEASE_MARK(meta_block);
+}
+
+static void _mark_free_data_block_released(meta_block_t *meta_block, bool_t is_released) {
+    if (meta_block->block_size >= MIN_RELEASABLE_FREE_DATA_BLOCK_SIZE) {
+        *GET_FREE_BLOCK_RELEASE_MARK(meta_block) = is_released;
+    }
 }
 
 static void _mark_vm_page_empty(vm_page_t *vm_page) {
     vm_page->meta_block.is_free = true;
-    vm_page->meta_block.next = NULL;
-    vm_page->meta_block.prev = NULL;
+    vm_page->meta_block.prev_offset = 0;
+}
+
+int16_t _compare_free_block_sizes(void *meta_block_lhs, void *meta_block_rhs) {
+    return (
+        ((meta_block_t *)meta_block_lhs)->block_size > ((meta_block_t *)meta_block_rhs)->block_size
+    ) ? -1 : 1;
 }
 
 static meta_block_t* _get_largest_free_meta_block(vm_page_item_t* vm_page_item) {
     dll_node_t *largest_free_block = vm_page_item->heap_root_node.next;
 
     if (largest_free_block) {
-        return (meta_block_t *)((char *)largest_free_block - (char *)&(((meta_block_t *)0)->heap_node));
+        return GET_FREE_BLOCK_META_BLOCK(largest_free_block);
     }
     return NULL;
 }
 
-static vm_page_t* _allocate_vm_page(vm_page_item_t *vm_page_item, uint32_t alloc_size) {
-    uint32_t const required_page_count = alloc_size/SYSTEM_PAGE_SIZE + 1;
+static void _add_free_meta_block_to_heap(vm_page_item_t *vm_page_item, meta_block_t *meta_block) {
+    _add_to_priority_queue(
+        &vm_page_item->heap_root_node,
+        GET_FREE_BLOCK_NODE(meta_block),
+        FREE_BLOCK_NODE_OFFSET,
+        &_compare_free_block_sizes
+    );
+}
 
-    vm_page_t *vm_page = _create_memory_mapping(required_page_count);
-    if (vm_page == NULL) {
-        return NULL;
+static uint32_t _clamp_vm_page_growth_count(size_t growth_page_count) {
+    if (growth_page_count < MIN_PAGE_GROWTH_UNITS) growth_page_count = MIN_PAGE_GROWTH_UNITS;
+    if (growth_page_count > MAX_PAGE_GROWTH_UNITS) growth_page_count = MAX_PAGE_GROWTH_UNITS;
+    if (growth_page_count > MAX_PAGE_UNITS) growth_page_count = MAX_PAGE_UNITS;
+
+    return growth_page_count;
+}
+
+static uint64_t _get_monotonic_time_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void _grow_vm_page_growth_count(vm_page_item_t *vm_page_item) {
+    // Each new vm page doubles the size of the next one while the type keeps growing
+    vm_page_item->growth_page_count = _clamp_vm_page_growth_count(
+        (size_t)vm_page_item->growth_page_count * 2
+    );
+    vm_page_item->growth_stamp_ns = _get_monotonic_time_ns();
+}
+
+static void _shrink_vm_page_growth_count(vm_page_item_t *vm_page_item) {
+    // Unmaps of a busy type keep the growth, it halves once for every idle interval since its last change
+    uint64_t const now_ns = _get_monotonic_time_ns();
+    uint64_t const idle_intervals = (now_ns - vm_page_item->growth_stamp_ns) / PAGE_GROWTH_IDLE_NS;
+
+    if (idle_intervals == 0) {
+        return;
     }
+    vm_page_item->growth_page_count = _clamp_vm_page_growth_count(
+        (idle_intervals < 32) ? vm_page_item->growth_page_count >> idle_intervals : 0
+    );
+    vm_page_item->growth_stamp_ns = now_ns;
+}
+
+static vm_page_t* _init_vm_page(vm_page_item_t *vm_page_item, vm_page_t *vm_page, uint32_t page_count) {
+    _apply_numa_policy(vm_page_item, vm_page, page_count * SYSTEM_PAGE_SIZE);
 
     _mark_vm_page_empty(vm_page);
-    vm_page->meta_block.block_size = _get_page_max_available_memory(required_page_count);
+    vm_page->meta_block.block_size = _get_page_max_available_memory(page_count);
 
     if (vm_page->meta_block.block_size == 0) {
-        _delete_memory_mapping(vm_page, required_page_count);
+        _delete_memory_mapping(vm_page, page_count);
         return NULL;
     }
 
-    vm_page->system_page_count = required_page_count;
+    vm_page->system_page_count = page_count;
+    vm_page->reservation_flags = 0;
     vm_page->meta_block.offset = GET_FIELD_OFFSET(vm_page_t, meta_block);
+    vm_page->meta_block.owner_id = vm_page_item->item_id;
 
-    _init_node(&vm_page->meta_block.heap_node);
+    _init_node(GET_FREE_BLOCK_NODE(&vm_page->meta_block));
+    _mark_free_data_block_released(&vm_page->meta_block, false);
 
     vm_page->prev = NULL;
     vm_page->next = NULL;
     vm_page->page_item = vm_page_item;
 
+    _mark_vm_page(vm_page, true);
+    _account_mapped_pages(vm_page_item, vm_page, page_count * SYSTEM_PAGE_SIZE);
+
     if (vm_page_item->first_page == NULL) {
         vm_page_item->first_page = vm_page;
     } else {
@@ -213,103 +738,275 @@ static vm_page_t* _allocate_vm_page(vm_page_item_t *vm_page_item, uint32_t alloc
     return vm_page;
 }
 
-int16_t _compare_free_block_sizes(void *meta_block_lhs, void *meta_block_rhs) {
-    return (
-        ((meta_block_t *)meta_block_lhs)->block_size > ((meta_block_t *)meta_block_rhs)->block_size
-    ) ? -1 : 1;
+static vm_page_t* _map_vm_page(vm_page_item_t *vm_page_item, uint32_t page_count, int map_flags) {
+    vm_page_t *vm_page = _create_memory_mapping_with_flags(page_count, map_flags);
+    if (vm_page == NULL) {
+        return NULL;
+    }
+    return _init_vm_page(vm_page_item, vm_page, page_count);
+}
+
+static vm_page_t* _allocate_vm_page(vm_page_item_t *vm_page_item, uint32_t alloc_size) {
+    uint32_t required_page_count = _get_required_page_units(alloc_size);
+    uint32_t const growth_page_count = _clamp_vm_page_growth_count(vm_page_item->growth_page_count);
+
+    if (required_page_count < growth_page_count) {
+        required_page_count = growth_page_count;
+    }
+
+    vm_page_t *vm_page = _map_vm_page(vm_page_item, required_page_count, 0);
+    if (vm_page == NULL) {
+        return NULL;
+    }
+
+    _grow_vm_page_growth_count(vm_page_item);
+
+    return vm_page;
+}
+
+uint32_t _collect_refill_page_items(vm_page_item_t **vm_page_items, uint32_t *page_counts, uint32_t max_count) {
+    vm_page_item_container_t *vm_page_item_container = *page_item_registry;
+    uint32_t refill_count = 0;
+
+    TRAVERSE_PAGE_CONTAINERS_BEGIN(vm_page_item_container)
+    {
+        vm_page_item_t *vm_page_item = vm_page_item_container->vm_page_items;
+
+        TRAVERSE_PAGE_ITEMS_BEGIN(vm_page_item)
+        {
+            if (refill_count == max_count) {
+                return refill_count;
+            }
+            if (vm_page_item->refill_bytes == 0) {
+                continue;
+            }
+
+            meta_block_t *largest_free_meta_block = _get_largest_free_meta_block(vm_page_item);
+
+            // Allocation up to the refill size is served without mapping a vm page
+            if (largest_free_meta_block != NULL && largest_free_meta_block->block_size >= vm_page_item->refill_bytes) {
+                continue;
+            }
+
+            uint32_t page_count = _get_required_page_units(vm_page_item->refill_bytes);
+            uint32_t const growth_page_count = _clamp_vm_page_growth_count(vm_page_item->growth_page_count);
+
+            vm_page_items[refill_count] = vm_page_item;
+            page_counts[refill_count] = (page_count < growth_page_count) ? growth_page_count : page_count;
+            refill_count++;
+        }
+        TRAVERSE_PAGE_ITEMS_END(vm_page_item);
+    }
+    TRAVERSE_PAGE_CONTAINERS_END(vm_page_item_container);
+
+    return refill_count;
+}
+
+void* _create_refill_memory_mapping(uint32_t page_count) {
+    // Pages are faulted in by the refill thread rather than by the first allocations
+    return _create_anonymous_memory_mapping_with_flags(page_count, PAGE_PROVIDER_POPULATE);
 }
 
-static void _update_meta_block_bindings(meta_block_t *alloc_meta_block, meta_block_t *free_meta_block) {
-    free_meta_block->next = alloc_meta_block->next;
-    if (free_meta_block->next != NULL) {
-        free_meta_block->next->prev = free_meta_block;
+bool_t _add_refill_vm_page(vm_page_item_t *vm_page_item, void *addr, uint32_t page_count) {
+    vm_page_t *vm_page = _init_vm_page(vm_page_item, addr, page_count);
+    if (vm_page == NULL) {
+        return false;
+    }
+
+    _add_free_meta_block_to_heap(vm_page_item, &vm_page->meta_block);
+    _grow_vm_page_growth_count(vm_page_item);
+
+    return true;
+}
+
+static void _update_next_meta_block_binding(meta_block_t *meta_block) {
+    meta_block_t *next_meta_block = NEXT_META_BLOCK(meta_block);
+
+    if (next_meta_block != NULL) {
+        next_meta_block->prev_offset = meta_block->offset;
     }
-    free_meta_block->prev = alloc_meta_block;
-    alloc_meta_block->next = free_meta_block;
 }
 
 static bool_t _split_free_data_block_for_allocation(
     vm_page_item_t *vm_page_item,
     meta_block_t *meta_block,
     uint32_t alloc_size)
-{   
-    if (alloc_size > meta_block->block_size) {
+{
+    // Data blocks are padded such that every meta block and data block stays aligned
+    uint32_t const alloc_span = ALIGN_UP(alloc_size, DATA_BLOCK_ALIGNMENT);
+
+    if (alloc_span > meta_block->block_size) {
         return false;
     }
 
-    uint32_t remain_size = meta_block->block_size - alloc_size;
+    uint32_t remain_size = meta_block->block_size - alloc_span;
+    // Remainder lies within the released pages, the allocation writes only in front of them
+    bool_t const is_released = _is_free_data_block_released(meta_block);
 
     meta_block->is_free = false;
-    meta_block->block_size = alloc_size;
+    meta_block->is_alias = false;
     // Safety: node here is never a head node of the priority queue
-    _unlink_node(&meta_block->heap_node);
+    _unlink_node(GET_FREE_BLOCK_NODE(meta_block));
 
-    if (remain_size < sizeof(meta_block_t)) {
-        // Hard internal fragmentation, residual block without a meta block
+    if (remain_size < sizeof(meta_block_t) + MIN_FREE_DATA_BLOCK_SIZE) {
+        // Hard internal fragmentation, residual is too small for a free block and extends the data block
+        meta_block->block_size = alloc_span + remain_size;
         return true;
     }
 
     // If remain_size < (sizeof(meta_block_t) + vm_page_item->struct_size), then
     // it's soft internal fragmentation and meta block has a residual data block
 
+    meta_block->block_size = alloc_size;
+
     meta_block_t *next_meta_block = NEXT_META_BLOCK_BY_SIZE(meta_block);
     next_meta_block->is_free = true;
+    next_meta_block->is_alias = false;
     next_meta_block->block_size = remain_size - sizeof(meta_block_t);
-    next_meta_block->offset = meta_block->offset + sizeof(meta_block_t) + meta_block->block_size;
+    next_meta_block->offset = meta_block->offset + sizeof(meta_block_t) + alloc_span;
+    next_meta_block->prev_offset = meta_block->offset;
+    next_meta_block->owner_id = vm_page_item->item_id;
 
-    _init_node(&next_meta_block->heap_node);
+    _update_next_meta_block_binding(next_meta_block);
 
-    _add_to_priority_queue(
-        &vm_page_item->heap_root_node,
-        &next_meta_block->heap_node,
-        GET_FIELD_OFFSET(meta_block_t, heap_node),
-        &_compare_free_block_sizes
-    );
-
-    _update_meta_block_bindings(meta_block, next_meta_block);
+    _init_node(GET_FREE_BLOCK_NODE(next_meta_block));
+    _mark_free_data_block_released(next_meta_block, is_released);
+    _add_free_meta_block_to_heap(vm_page_item, next_meta_block);
 
     return true;
 }
 
 meta_block_t* _allocate_free_data_block(vm_page_item_t *vm_page_item, uint32_t alloc_size) {
-    meta_block_t *largest_free_meta_block = _get_largest_free_meta_block(vm_page_item);
+    meta_block_t *free_meta_block = _get_largest_free_meta_block(vm_page_item);
 
-    if (largest_free_meta_block == NULL || largest_free_meta_block->block_size < alloc_size) {
+    if (free_meta_block == NULL || free_meta_block->block_size < ALIGN_UP(alloc_size, DATA_BLOCK_ALIGNMENT)) {
         vm_page_t *vm_page = _allocate_vm_page(vm_page_item, alloc_size);
         if (vm_page == NULL) {
             return NULL;
         }
 
-        _add_to_priority_queue(
-            &vm_page_item->heap_root_node,
-            &vm_page->meta_block.heap_node,
-            GET_FIELD_OFFSET(meta_block_t, heap_node),
-            &_compare_free_block_sizes
-        );
-        
-        if (_split_free_data_block_for_allocation(vm_page_item, &vm_page->meta_block, alloc_size)) {
-            return &vm_page->meta_block;
-        }
+        _add_free_meta_block_to_heap(vm_page_item, &vm_page->meta_block);
+        free_meta_block = &vm_page->meta_block;
+    }
+
+    if (!_split_free_data_block_for_allocation(vm_page_item, free_meta_block, alloc_size)) {
         return NULL;
     }
 
-    if (_split_free_data_block_for_allocation(vm_page_item, largest_free_meta_block, alloc_size)) {
-        return largest_free_meta_block;
+    // Owner is the heap item unless the block gets accounted to another type
+    free_meta_block->owner_id = vm_page_item->item_id;
+
+    return free_meta_block;
+}
+
+static meta_block_t* _find_free_meta_block_near(meta_block_t *meta_block, uint32_t alloc_span) {
+    meta_block_t *next_meta_block = meta_block;
+    meta_block_t *prev_meta_block = PREV_META_BLOCK(meta_block);
+
+    // Each step looks one meta block further away on both sides, so the closest fitting one wins
+    for (uint32_t step = 0; step < NEAR_SCAN_BLOCK_COUNT; step++) {
+        if (next_meta_block == NULL && prev_meta_block == NULL) {
+            break;
+        }
+        if (next_meta_block != NULL) {
+            if (next_meta_block->is_free && next_meta_block->block_size >= alloc_span) {
+                return next_meta_block;
+            }
+            next_meta_block = NEXT_META_BLOCK(next_meta_block);
+        }
+        if (prev_meta_block != NULL) {
+            if (prev_meta_block->is_free && prev_meta_block->block_size >= alloc_span) {
+                return prev_meta_block;
+            }
+            prev_meta_block = PREV_META_BLOCK(prev_meta_block);
+        }
     }
     return NULL;
 }
 
+meta_block_t* _allocate_free_data_block_near(vm_page_item_t *vm_page_item, void const *hint, uint32_t alloc_size) {
+    if (hint == NULL || !_is_vm_page_address(hint)) {
+        return NULL;
+    }
 
-static void _merge_free_data_blocks(meta_block_t *meta_block_lhs, meta_block_t *meta_block_rhs) {
-    meta_block_lhs->next = meta_block_rhs->next;
-    meta_block_lhs->block_size += sizeof(meta_block_t) + meta_block_rhs->block_size;
+    meta_block_t *hint_meta_block = (meta_block_t *)hint - 1;
 
-    if (meta_block_rhs->next != NULL) {
-        meta_block_rhs->next->prev = meta_block_lhs;
+    if (hint_meta_block->is_alias) {
+        hint_meta_block = GET_ALIASED_META_BLOCK(hint_meta_block);
+    }
+    vm_page_t *vm_page = GET_META_PAGE(hint_meta_block, hint_meta_block->offset);
+
+    // Hint in a heap of another type or size class cannot share its vm page
+    if (vm_page->page_item != vm_page_item) {
+        return NULL;
+    }
+
+    uint32_t const alloc_span = ALIGN_UP(alloc_size, DATA_BLOCK_ALIGNMENT);
+    meta_block_t *free_meta_block = _find_free_meta_block_near(hint_meta_block, alloc_span);
+
+    // Neighbours in the page list were mapped right after and right before the vm page of the hint
+    if (free_meta_block == NULL && vm_page->prev != NULL) {
+        free_meta_block = _find_free_meta_block_near(&vm_page->prev->meta_block, alloc_span);
+    }
+    if (free_meta_block == NULL && vm_page->next != NULL) {
+        free_meta_block = _find_free_meta_block_near(&vm_page->next->meta_block, alloc_span);
     }
+
+    if (free_meta_block == NULL || !_split_free_data_block_for_allocation(vm_page_item, free_meta_block, alloc_size)) {
+        return NULL;
+    }
+    free_meta_block->owner_id = vm_page_item->item_id;
+
+    return free_meta_block;
 }
 
-static void _free_vm_page(vm_page_t *vm_page) {
+
+meta_block_t* _allocate_mapped_free_data_block(vm_page_item_t *vm_page_item, uint32_t alloc_size) {
+    meta_block_t *free_meta_block = _get_largest_free_meta_block(vm_page_item);
+
+    // Unlike above, no vm page gets mapped when the free data blocks are too small
+    if (free_meta_block == NULL || free_meta_block->block_size < ALIGN_UP(alloc_size, DATA_BLOCK_ALIGNMENT)) {
+        return NULL;
+    }
+    if (!_split_free_data_block_for_allocation(vm_page_item, free_meta_block, alloc_size)) {
+        return NULL;
+    }
+
+    free_meta_block->owner_id = vm_page_item->item_id;
+
+    return free_meta_block;
+}
+
+void _detach_free_data_blocks(vm_page_t *vm_page) {
+    meta_block_t *meta_block = &vm_page->meta_block;
+
+    // Detached free data blocks stay free but are not found by allocations
+    TRAVERSE_META_BLOCKS_IN_PAGE_BEGIN(meta_block)
+    {
+        if (meta_block->is_free) _unlink_node(GET_FREE_BLOCK_NODE(meta_block));
+    }
+    TRAVERSE_META_BLOCKS_IN_PAGE_END(meta_block);
+}
+
+void _attach_free_data_blocks(vm_page_t *vm_page) {
+    meta_block_t *meta_block = &vm_page->meta_block;
+
+    TRAVERSE_META_BLOCKS_IN_PAGE_BEGIN(meta_block)
+    {
+        if (meta_block->is_free) {
+            _init_node(GET_FREE_BLOCK_NODE(meta_block));
+            _add_free_meta_block_to_heap(vm_page->page_item, meta_block);
+        }
+    }
+    TRAVERSE_META_BLOCKS_IN_PAGE_END(meta_block);
+}
+
+static void _merge_free_data_blocks(meta_block_t *meta_block_lhs, meta_block_t *meta_block_rhs) {
+    meta_block_lhs->block_size += sizeof(meta_block_t) + meta_block_rhs->block_size;
+    _update_next_meta_block_binding(meta_block_lhs);
+}
+
+static void _unlink_vm_page(vm_page_t *vm_page) {
     vm_page_item_t *vm_page_item = vm_page->page_item;
 
     if (vm_page_item->first_page == vm_page) {
@@ -326,26 +1023,73 @@ static void _free_vm_page(vm_page_t *vm_page) {
         vm_page_item->heap_root_node.next = NULL;
     }
 
+    _shrink_vm_page_growth_count(vm_page_item);
+}
+
+static void _free_vm_page(vm_page_t *vm_page) {
+    _account_unmapped_pages(vm_page->page_item, vm_page, vm_page->system_page_count * SYSTEM_PAGE_SIZE);
+    _unlink_vm_page(vm_page);
+    _mark_vm_page(vm_page, false);
     _delete_memory_mapping(vm_page, vm_page->system_page_count);
 }
 
+static size_t _release_free_data_block_pages(meta_block_t *meta_block, uintptr_t start_addr, uintptr_t end_addr) {
+    vm_page_t *vm_page = GET_META_PAGE(meta_block, meta_block->offset);
+
+    // Only whole system pages inside the data block can be released, the meta block,
+    // priority queue node, release mark and partial pages at either end stay resident
+    uintptr_t const data_block_start_addr = (uintptr_t)(GET_FREE_BLOCK_RELEASE_MARK(meta_block) + 1);
+    uintptr_t const data_block_end_addr = (uintptr_t)(meta_block + 1) + meta_block->block_size;
+
+    uintptr_t const release_start_addr = ALIGN_UP(
+        (start_addr > data_block_start_addr) ? start_addr : data_block_start_addr, SYSTEM_PAGE_SIZE
+    );
+    uintptr_t const release_end_addr = ALIGN_DOWN(
+        (end_addr < data_block_end_addr) ? end_addr : data_block_end_addr, SYSTEM_PAGE_SIZE
+    );
+    size_t released_bytes = 0;
+
+    if (release_end_addr > release_start_addr) {
+        released_bytes = _release_memory_mapping_range(
+            (void *)release_start_addr,
+            release_end_addr - release_start_addr
+        );
+
+        if (released_bytes == 0) {
+            _mark_free_data_block_released(meta_block, false);
+            return 0;
+        }
+        if (!_is_region_address(vm_page)) {
+            vm_page->page_item->mapping_stats.release_count += 1;
+            vm_page->page_item->mapping_stats.released_bytes += released_bytes;
+        }
+    }
+
+    _mark_free_data_block_released(meta_block, true);
+    return released_bytes;
+}
+
 void _free_data_blocks(meta_block_t *meta_block) {
     meta_block_t *updated_lowest_meta_block = meta_block;
     vm_page_t *vm_page = GET_META_PAGE(meta_block, meta_block->offset);
     meta_block->is_free = true;
+    // Free data block covers the padding up to the next meta block
+    meta_block->block_size = GET_DATA_BLOCK_SPAN(meta_block);
 
-    meta_block_t *next_meta_block = NEXT_META_BLOCK(meta_block);
+    // Released pages of the neighbours stay released, only pages between them are released again
+    uintptr_t release_start_addr = 0;
+    uintptr_t release_end_addr = UINTPTR_MAX;
+    bool_t is_neighbour_released = false;
 
-    if (next_meta_block == NULL) {
-        char *vm_page_end_addr = (char *)vm_page + vm_page->system_page_count * SYSTEM_PAGE_SIZE;
-        char *data_block_end_addr = (char *)(meta_block + 1) + meta_block->block_size;
-        meta_block->block_size += (uint32_t) (vm_page_end_addr - data_block_end_addr);
-    } else {
-        meta_block_t *next_meta_block_by_size = NEXT_META_BLOCK_BY_SIZE(meta_block);
-        meta_block->block_size += (uint32_t) ((char *)next_meta_block - (char *)next_meta_block_by_size);
-    }
+    meta_block_t *next_meta_block = NEXT_META_BLOCK(meta_block);
 
     if (next_meta_block && next_meta_block->is_free == true) {
+        if (_is_free_data_block_released(next_meta_block)) {
+            release_end_addr = ALIGN_UP((uintptr_t)(GET_FREE_BLOCK_RELEASE_MARK(next_meta_block) + 1), SYSTEM_PAGE_SIZE);
+            is_neighbour_released = true;
+        }
+        // Merged block takes the place of its neighbours in the priority queue
+        _unlink_node(GET_FREE_BLOCK_NODE(next_meta_block));
         _merge_free_data_blocks(meta_block, next_meta_block);
         updated_lowest_meta_block = meta_block;
     }
@@ -353,25 +1097,122 @@ void _free_data_blocks(meta_block_t *meta_block) {
     meta_block_t *prev_meta_block = PREV_META_BLOCK(meta_block);
 
     if (prev_meta_block && prev_meta_block->is_free) {
+        if (_is_free_data_block_released(prev_meta_block)) {
+            release_start_addr = ALIGN_DOWN((uintptr_t)(prev_meta_block + 1) + prev_meta_block->block_size, SYSTEM_PAGE_SIZE);
+            is_neighbour_released = true;
+        }
+        _unlink_node(GET_FREE_BLOCK_NODE(prev_meta_block));
         _merge_free_data_blocks(prev_meta_block, meta_block);
         updated_lowest_meta_block = prev_meta_block;
     }
 
-    if (_is_vm_page_empty(vm_page)) {
-        _unlink_node(&vm_page->meta_block.heap_node);
+    if (_is_vm_page_empty(vm_page) && !vm_page->reservation_flags) {
         _free_vm_page(vm_page);
     } else {
-        _add_to_priority_queue(
-            &vm_page->page_item->heap_root_node,
-            &updated_lowest_meta_block->heap_node,
-            GET_FIELD_OFFSET(meta_block_t, heap_node),
-            &_compare_free_block_sizes
-        );
+        _init_node(GET_FREE_BLOCK_NODE(updated_lowest_meta_block));
+        _add_free_meta_block_to_heap(vm_page->page_item, updated_lowest_meta_block);
+
+        // Reserved vm pages keep their memory resident
+        if (!vm_page->reservation_flags && (is_neighbour_released ||
+            (TRIM_THRESHOLD > 0 && updated_lowest_meta_block->block_size >= TRIM_THRESHOLD))) {
+            _release_free_data_block_pages(updated_lowest_meta_block, release_start_addr, release_end_addr);
+        } else {
+            _mark_free_data_block_released(updated_lowest_meta_block, false);
+        }
     }
 }
 
+size_t _trim_free_data_block(meta_block_t *meta_block) {
+    vm_page_t *vm_page = GET_META_PAGE(meta_block, meta_block->offset);
+
+    if (!meta_block->is_free || vm_page->reservation_flags || _is_free_data_block_released(meta_block)) {
+        // Reserved vm pages keep their memory resident, released pages are not released twice
+        return 0;
+    }
+    return _release_free_data_block_pages(meta_block, 0, UINTPTR_MAX);
+}
+
+size_t _trim_vm_pages() {
+    vm_page_item_container_t *vm_page_item_container = *page_item_registry;
+    size_t released_bytes = 0;
+
+    TRAVERSE_PAGE_CONTAINERS_BEGIN(vm_page_item_container)
+    {
+        vm_page_item_t *vm_page_item = vm_page_item_container->vm_page_items;
+
+        TRAVERSE_PAGE_ITEMS_BEGIN(vm_page_item)
+        {
+            vm_page_t *vm_page = vm_page_item->first_page;
+
+            TRAVERSE_PAGES_BEGIN(vm_page)
+            {
+                meta_block_t *meta_block = &vm_page->meta_block;
+
+                TRAVERSE_META_BLOCKS_IN_PAGE_BEGIN(meta_block)
+                {
+                    released_bytes += _trim_free_data_block(meta_block);
+                }
+                TRAVERSE_META_BLOCKS_IN_PAGE_END(meta_block);
+            }
+            TRAVERSE_PAGES_END(vm_page);
+        }
+        TRAVERSE_PAGE_ITEMS_END(vm_page_item);
+    }
+    TRAVERSE_PAGE_CONTAINERS_END(vm_page_item_container);
+
+    return released_bytes;
+}
+
+vm_page_t* _reserve_vm_page(vm_page_item_t *vm_page_item, uint32_t alloc_size, bool_t populate, bool_t lock) {
+    uint32_t const required_page_count = _get_required_page_units(alloc_size);
+    int const map_flags = populate ? PAGE_PROVIDER_POPULATE : 0;
+
+    vm_page_t *vm_page = _map_vm_page(vm_page_item, required_page_count, map_flags);
+    if (vm_page == NULL) {
+        return NULL;
+    }
+
+    if (lock && !_advise_provider_pages(vm_page, required_page_count * SYSTEM_PAGE_SIZE, PAGE_PROVIDER_ADVICE_LOCK)) {
+        fprintf(stderr, "%s: error: locking of virtual memory page failed.\n", __func__);
+        _free_vm_page(vm_page);
+        return NULL;
+    }
+
+    vm_page->reservation_flags = VM_PAGE_RESERVED;
+    if (populate) vm_page->reservation_flags |= VM_PAGE_POPULATED;
+    if (lock) vm_page->reservation_flags |= VM_PAGE_LOCKED;
+
+    _add_free_meta_block_to_heap(vm_page_item, &vm_page->meta_block);
+
+    return vm_page;
+}
+
+uint32_t _release_reserved_vm_pages(vm_page_item_t *vm_page_item) {
+    uint32_t released_page_count = 0;
+    vm_page_t *vm_page = vm_page_item->first_page;
+
+    TRAVERSE_PAGES_BEGIN(vm_page)
+    {
+        if (vm_page->reservation_flags) {
+            if (vm_page->reservation_flags & VM_PAGE_LOCKED) {
+                _advise_provider_pages(vm_page, vm_page->system_page_count * SYSTEM_PAGE_SIZE, PAGE_PROVIDER_ADVICE_UNLOCK);
+            }
+            vm_page->reservation_flags = 0;
+            ++released_page_count;
+
+            if (_is_vm_page_empty(vm_page)) {
+                _unlink_node(GET_FREE_BLOCK_NODE(&vm_page->meta_block));
+                _free_vm_page(vm_page);
+            }
+        }
+    }
+    TRAVERSE_PAGES_END(vm_page);
+
+    return released_page_count;
+}
+
 void _walk_vm_page_items() {
-    vm_page_item_container_t *vm_page_item_container = first_vm_page_item_container;
+    vm_page_item_container_t *vm_page_item_container = *page_item_registry;
     uint32_t page_counter = 0;
 
     TRAVERSE_PAGE_CONTAINERS_BEGIN(vm_page_item_container)
@@ -389,6 +1230,9 @@ void _walk_vm_page_items() {
             fprintf(stdout, "> item name `%s`, size %u bytes \n",
                 vm_page_item->struct_name, vm_page_item->struct_size
             );
+            fprintf(stdout, "> next vm page has at least %u system pages\n",
+                _clamp_vm_page_growth_count(vm_page_item->growth_page_count)
+            );
 
             if (vm_page_item->first_page) {
                 fprintf(stdout, "> allocated memory starts at: %p\n\n",
@@ -407,7 +1251,7 @@ void _walk_vm_page_items() {
 }
 
 void _print_memory_usage() {
-    vm_page_item_container_t *vm_page_item_container = first_vm_page_item_container;
+    vm_page_item_container_t *vm_page_item_container = *page_item_registry;
 
     TRAVERSE_PAGE_CONTAINERS_BEGIN(vm_page_item_container)
     {
@@ -437,8 +1281,11 @@ void _print_memory_usage() {
             }
             TRAVERSE_PAGES_END(vm_page);
 
-            fprintf(stdout, "struct: %-32s    blocks: %-5u    free blocks: %-5u   used memory in bytes: %u\n",
-                vm_page_item->struct_name, total_block_count, free_block_count, memory_usage
+            fprintf(stdout,
+                "struct: %-32s    blocks: %-5u    free blocks: %-5u   used memory in bytes: %-10u"
+                "   live blocks of the type: %-5u   live bytes of the type: %llu\n",
+                vm_page_item->struct_name, total_block_count, free_block_count, memory_usage,
+                vm_page_item->live_block_count, (unsigned long long)vm_page_item->live_bytes
             );
         }
         TRAVERSE_PAGE_ITEMS_END(vm_page_item);
@@ -458,8 +1305,37 @@ void _walk_vm_pages(char const *struct_name) {
         return;
     }
 
+    fprintf(stdout, "> type has %u live data blocks of %llu bytes in total, %llu allocations and %llu frees\n",
+        vm_page_item->live_block_count, (unsigned long long)vm_page_item->live_bytes,
+        (unsigned long long)vm_page_item->alloc_count, (unsigned long long)vm_page_item->free_count
+    );
+
+    mapping_stats_t mapping_stats;
+    _get_page_item_mapping_stats(vm_page_item, &mapping_stats);
+
+    fprintf(stdout, "> pages of the type took %llu mappings of %llu bytes, %llu unmappings of %llu bytes "
+        "and %llu releases of %llu bytes, sampled faults: %llu minor, %llu major\n",
+        (unsigned long long)mapping_stats.map_count, (unsigned long long)mapping_stats.mapped_bytes,
+        (unsigned long long)mapping_stats.unmap_count, (unsigned long long)mapping_stats.unmapped_bytes,
+        (unsigned long long)mapping_stats.release_count, (unsigned long long)mapping_stats.released_bytes,
+        (unsigned long long)mapping_stats.minor_faults, (unsigned long long)mapping_stats.major_faults
+    );
+
     vm_page_t *vm_page = vm_page_item->first_page;
 
+    if (SHARED_AREA_THRESHOLD > 0 && !(vm_page_item->item_flags & PAGE_ITEM_PROMOTED)) {
+        fprintf(stdout, "> type is packed into the shared area `<shared>` until it has more than %zu live bytes\n\n",
+            SHARED_AREA_THRESHOLD
+        );
+    }
+
+    if (vm_page_item->heap_item != NULL) {
+        fprintf(stdout, "> type shares vm pages of heap `%s` with other types of the same size\n\n",
+            vm_page_item->heap_item->struct_name
+        );
+        vm_page = vm_page_item->heap_item->first_page;
+    }
+
     TRAVERSE_PAGES_BEGIN(vm_page)
     {
         meta_block_t *meta_block = &vm_page->meta_block;
@@ -495,14 +1371,19 @@ void _walk_vm_pages(char const *struct_name) {
         fprintf(stdout, "> vm page %p has %u free and %u allocated data blocks\n",
             (void *)vm_page, free_data_blocks, allocated_data_blocks
         );
-        fprintf(stdout, "> largest free data block has address %p and size %u\n",
-            (void *)(meta_block_with_largest_free_data_block + 1),
-            meta_block_with_largest_free_data_block->block_size
-        );
-        fprintf(stdout, "> largest allocated data block has address %p and size %u\n\n",
-            (void *)(meta_block_with_largest_allocated_data_block + 1),
-            meta_block_with_largest_allocated_data_block->block_size
-        );
+        if (meta_block_with_largest_free_data_block != NULL) {
+            fprintf(stdout, "> largest free data block has address %p and size %u\n",
+                (void *)(meta_block_with_largest_free_data_block + 1),
+                meta_block_with_largest_free_data_block->block_size
+            );
+        }
+        if (meta_block_with_largest_allocated_data_block != NULL) {
+            fprintf(stdout, "> largest allocated data block has address %p and size %u\n",
+                (void *)(meta_block_with_largest_allocated_data_block + 1),
+                meta_block_with_largest_allocated_data_block->block_size
+            );
+        }
+        fprintf(stdout, "\n");
     }
     TRAVERSE_PAGES_END(vm_page);
 }
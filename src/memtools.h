@@ -9,37 +9,138 @@
 
 #define MAX_STRUCT_NAME_SIZE 64
 #define SYS_MIN_PAGE_SIZE 4096
-#define MAX_SINGLE_PAGE_SIZE_BYTES 1073741824 // Must be under 2^32 - 1
+#define MAX_SINGLE_PAGE_SIZE_BYTES 1073741824 // Must be at most 2^30, block sizes of meta blocks have 30 bits
+#define DEFAULT_TRIM_THRESHOLD_BYTES 131072 // Zero disables trimming in hfree
+#define DEFAULT_MIN_PAGE_GROWTH_UNITS 1
+#define DEFAULT_MAX_PAGE_GROWTH_UNITS 256
+#define PAGE_GROWTH_IDLE_NS 1000000000ULL // Growth of a type halves for every idle second seen at an unmap
+#define LIFETIME_BUCKET_COUNT 48 // Equals HALLOC_LIFETIME_BUCKETS of the public API
+#define LIFETIME_CLASS_LONG 0 // Lifetime classes equal HALLOC_LIFETIME_* of the public API
+#define LIFETIME_CLASS_SHORT 1
+#define LIFETIME_CLASS_PERMANENT 2
+#define LIFETIME_CLASS_COUNT 3
+#define DATA_BLOCK_ALIGNMENT 16
+#define CACHE_LINE_SIZE 64
+#define VM_PAGE_MAP_LEVEL_SHIFT 18 // Vm page map has two levels indexed by system page numbers
+#define NEAR_SCAN_BLOCK_COUNT 64 // Meta blocks searched for a free one in each direction from a hint
+
+#if defined(HALLOC_SITE_STATS) || defined(HALLOC_LIFETIME_STATS)
+#define META_BLOCK_EXTENSION_SIZE 16 // Meta blocks record the call site and the birth of their allocation
+#else
+#define META_BLOCK_EXTENSION_SIZE 0
+#endif
+
+#ifdef __APPLE__
+#define MADVISE_RELEASE_FLAG MADV_FREE
+#else
+#define MADVISE_RELEASE_FLAG MADV_DONTNEED
+#endif
 
 typedef bool bool_t;
 
+/*
+Meta block in front of every data block. Neighbouring meta blocks of a vm page are found by offsets
+and sizes, and a free data block stores its priority queue node in its first bytes. Data blocks are
+padded to DATA_BLOCK_ALIGNMENT bytes, the padding is not included in the size of an allocated block.
+
+An over-aligned allocation returns an address inside its data block, the alias meta block in front of
+that address has no size and its offset leads back to the start of the data block.
+
+This compact 16-byte layout is the only one, the former 48-byte header with neighbour pointers and an
+embedded queue node is not kept as a build option. Its fields are all derived from the offsets, and a
+second layout would double the code paths that walk and split vm pages. The cost is the 30-bit block
+size: a vm page, and hence a single allocation, is limited to 1 GiB, where the old header allowed
+raising MAX_SINGLE_PAGE_SIZE_BYTES up to 4 GiB.
+*/
 typedef struct meta_block_ {
-  bool_t is_free;
-  uint32_t block_size;
-  uint32_t offset;
-  dll_node_t heap_node;
-  struct meta_block_ *prev;
-  struct meta_block_ *next;
+  uint32_t block_size : 30;
+  uint32_t is_free : 1;
+  uint32_t is_alias : 1;
+  uint32_t offset; // Offset from the start of the vm page, or from the data block of an alias
+  uint32_t prev_offset; // Offset of the previous meta block, zero for the first meta block
+  uint32_t owner_id;
+#if META_BLOCK_EXTENSION_SIZE > 0
+  uint32_t site_id; // Call site that allocated the data block
+  uint32_t : 32;
+  uint64_t birth_stamp; // Lifetime clock at the allocation of the data block
+#endif
 } meta_block_t;
 
 struct vm_page_item_;
+struct slab_page_;
 
 typedef struct vm_page_ {
     struct vm_page_ *prev;
     struct vm_page_ *next;
     struct vm_page_item_ *page_item;
     uint32_t system_page_count;
+    uint32_t reservation_flags;
     meta_block_t meta_block;
     char page_memory[];
 } vm_page_t;
 
+#define VM_PAGE_RESERVED 0x1
+#define VM_PAGE_POPULATED 0x2
+#define VM_PAGE_LOCKED 0x4
+
+#define PAGE_ITEM_SIZE_CLASS 0x1
+#define PAGE_ITEM_SHARED_AREA 0x2
+#define PAGE_ITEM_PROMOTED 0x4
+#define PAGE_ITEM_OUT_OF_BAND 0x8
+#define PAGE_ITEM_HANDLES 0x10
+#define PAGE_ITEM_LIFETIME_CLASS 0x20
+#define PAGE_ITEM_INTERNAL (PAGE_ITEM_SIZE_CLASS | PAGE_ITEM_SHARED_AREA | PAGE_ITEM_HANDLES | PAGE_ITEM_LIFETIME_CLASS)
+
+// Mapping calls of a type or of the whole process and the bytes they covered
+typedef struct mapping_stats_ {
+    uint64_t map_count;
+    uint64_t unmap_count;
+    uint64_t release_count; // Free pages given back to the kernel while staying mapped
+    uint64_t mapped_bytes;
+    uint64_t unmapped_bytes;
+    uint64_t released_bytes;
+    uint64_t minor_faults; // Faults taken while halloc populated or zeroed pages, only with fault sampling
+    uint64_t major_faults;
+} mapping_stats_t;
+
+// Fault counts of the calling thread when a sampled section began
+typedef struct fault_sample_ {
+    uint64_t minor_faults;
+    uint64_t major_faults;
+    bool_t is_started;
+} fault_sample_t;
+
 typedef struct vm_page_item_ {
     char struct_name[MAX_STRUCT_NAME_SIZE];
     uint32_t struct_size;
+    uint32_t growth_page_count; // System page count of the next vm page
+    uint32_t item_id;
+    uint32_t item_flags;
+    uint64_t growth_stamp_ns; // Monotonic time of the last change of the growth page count
+    uint16_t numa_policy; // Placement of new vm pages on numa nodes
+    uint16_t numa_node;
+    struct vm_page_item_ *heap_item; // Size class item whose pages hold allocations of this type
+    struct vm_page_item_ *handle_item; // Item whose pages hold the objects of this type reached by handles
+    // Items whose pages hold the short-lived and the permanent objects of this type, long-lived ones use its heap
+    struct vm_page_item_ *lifetime_class_items[LIFETIME_CLASS_COUNT];
     vm_page_t *first_page;
+    struct slab_page_ *first_slab_page; // Single unit allocations of a type using out-of-band layout
     dll_node_t heap_root_node;
+    uint32_t refill_bytes; // Largest free data block that the refill thread keeps mapped, zero for none
+    uint32_t live_block_count; // Following are counted by the type, regardless of the heap
+    uint64_t live_bytes;
+    uint64_t alloc_count;
+    uint64_t free_count;
+    mapping_stats_t mapping_stats; // Vm pages and slab pages of the item itself
+#ifdef HALLOC_LIFETIME_STATS
+    uint64_t lifetime_histogram[LIFETIME_BUCKET_COUNT]; // Freed data blocks by log2 of their lifetime
+#endif
  } vm_page_item_t;
 
+_Static_assert(sizeof(meta_block_t) % DATA_BLOCK_ALIGNMENT == 0, "meta block must keep data blocks aligned");
+_Static_assert(MAX_SINGLE_PAGE_SIZE_BYTES <= (1UL << 30), "block size of a meta block must hold any data block");
+_Static_assert(offsetof(vm_page_t, page_memory) % DATA_BLOCK_ALIGNMENT == 0, "first data block must be aligned");
+
 typedef struct vm_page_item_container_ {
     struct vm_page_item_container_ *next;
     vm_page_item_t vm_page_items[];
@@ -50,11 +151,34 @@ typedef struct vm_page_item_container_ {
 
 #define GET_META_PAGE(meta_block, offset) ((void *)((char *)meta_block - offset))
 
-#define NEXT_META_BLOCK(meta_block) (meta_block->next)
+#define ALIGN_UP(value, alignment) (((value) + (alignment) - 1) / (alignment) * (alignment))
+
+#define ALIGN_DOWN(value, alignment) ((value) / (alignment) * (alignment))
+
+#define MIN_FREE_DATA_BLOCK_SIZE (sizeof(dll_node_t))
+
+#define GET_DATA_BLOCK_SPAN(meta_block) (ALIGN_UP((uint32_t)meta_block->block_size, DATA_BLOCK_ALIGNMENT))
+
+#define GET_FREE_BLOCK_NODE(meta_block) ((dll_node_t *)(meta_block + 1))
 
-#define PREV_META_BLOCK(meta_block) (meta_block->prev)
+#define GET_FREE_BLOCK_META_BLOCK(node) ((meta_block_t *)(node) - 1)
 
-#define NEXT_META_BLOCK_BY_SIZE(meta_block) ((meta_block_t *)((char *)(meta_block + 1) + meta_block->block_size))
+// Free data blocks of at least this size keep a release mark after their priority queue node
+#define MIN_RELEASABLE_FREE_DATA_BLOCK_SIZE (sizeof(dll_node_t) + sizeof(uint64_t))
+
+#define GET_FREE_BLOCK_RELEASE_MARK(meta_block) ((uint64_t *)(GET_FREE_BLOCK_NODE(meta_block) + 1))
+
+#define FREE_BLOCK_NODE_OFFSET (sizeof(meta_block_t))
+
+#define GET_ALIASED_META_BLOCK(alias_meta_block) \
+    ((meta_block_t *)((char *)((alias_meta_block) + 1) - (alias_meta_block)->offset) - 1)
+
+#define NEXT_META_BLOCK(meta_block) (_get_next_meta_block(meta_block))
+
+#define PREV_META_BLOCK(meta_block) ((meta_block)->prev_offset ?                        \
+    (meta_block_t *)((char *)GET_META_PAGE(meta_block, (meta_block)->offset) + (meta_block)->prev_offset) : NULL)
+
+#define NEXT_META_BLOCK_BY_SIZE(meta_block) ((meta_block_t *)((char *)(meta_block + 1) + GET_DATA_BLOCK_SPAN(meta_block)))
 
 #define MAX_PAGE_ITEMS_PER_PAGE_CONTAINER ((SYSTEM_PAGE_SIZE - sizeof(vm_page_item_container_t *)) / sizeof(vm_page_item_t))
 
@@ -88,7 +212,7 @@ typedef struct vm_page_item_container_ {
 {                                                           \
     meta_block_t *_meta_block = NULL;                       \
     for(; meta_block != NULL; meta_block = _meta_block){    \
-        _meta_block = meta_block->next;
+        _meta_block = NEXT_META_BLOCK(meta_block);
 
 #define TRAVERSE_META_BLOCKS_IN_PAGE_END(meta_block) }}
 
@@ -97,15 +221,65 @@ size_t _get_page_max_available_memory(size_t units);
 size_t _get_max_page_items_per_page_container();
 size_t _get_system_page_size();
 size_t _get_max_page_units();
+void _set_trim_threshold(size_t threshold);
+size_t _get_trim_threshold();
+bool_t _set_page_growth_bounds(size_t min_units, size_t max_units);
+size_t _get_required_page_units(uint32_t alloc_size);
+
+void* _create_memory_mapping(size_t units);
+void* _create_anonymous_memory_mapping(size_t units);
+void* _create_aligned_memory_mapping(size_t units);
+void _delete_memory_mapping(void *addr, size_t units);
+void _account_mapped_pages(vm_page_item_t *vm_page_item, void const *addr, size_t length);
+void _account_unmapped_pages(vm_page_item_t *vm_page_item, void const *addr, size_t length);
+void _get_page_item_mapping_stats(vm_page_item_t const *vm_page_item, mapping_stats_t *stats);
+void _get_process_mapping_stats(mapping_stats_t *stats);
+void _set_fault_sampling(bool_t enabled);
+void _start_fault_sample(fault_sample_t *sample);
+void _account_fault_sample(vm_page_item_t *vm_page_item, fault_sample_t const *sample);
 
 vm_page_item_t* _lookup_page_item(char const *struct_name);
 void _register_page_item(char const *struct_name, uint32_t struct_size);
+vm_page_item_t* _lookup_page_item_by_id(uint32_t item_id);
+void _set_page_item_registry(vm_page_item_container_t **registry, uint32_t first_item_id);
 
+void _set_heaps_keyed_by_size(bool_t keyed_by_size);
+vm_page_item_t* _get_heap_page_item(vm_page_item_t *vm_page_item);
+vm_page_item_t* _get_handle_page_item(vm_page_item_t *vm_page_item);
+vm_page_item_t* _get_lifetime_class_page_item(vm_page_item_t *vm_page_item, uint32_t lifetime_class);
+
+void _set_shared_area_threshold(size_t threshold);
+void _promote_page_item(vm_page_item_t *vm_page_item);
+vm_page_item_t* _get_allocation_page_item(vm_page_item_t *vm_page_item, uint32_t alloc_size);
+
+void _account_data_block_allocation(vm_page_item_t *vm_page_item, meta_block_t *meta_block);
+void _account_data_block_free(meta_block_t *meta_block);
+
+meta_block_t* _get_next_meta_block(meta_block_t *meta_block);
+size_t _get_data_block_usable_size(void const *data);
+bool_t _is_vm_page_address(void const *addr);
 meta_block_t* _allocate_free_data_block(vm_page_item_t *vm_page_item, uint32_t alloc_size);
+meta_block_t* _allocate_free_data_block_near(vm_page_item_t *vm_page_item, void const *hint, uint32_t alloc_size);
+meta_block_t* _allocate_mapped_free_data_block(vm_page_item_t *vm_page_item, uint32_t alloc_size);
+void _detach_free_data_blocks(vm_page_t *vm_page);
+uint32_t _collect_refill_page_items(vm_page_item_t **vm_page_items, uint32_t *page_counts, uint32_t max_count);
+void* _create_refill_memory_mapping(uint32_t page_count);
+bool_t _add_refill_vm_page(vm_page_item_t *vm_page_item, void *addr, uint32_t page_count);
+void _attach_free_data_blocks(vm_page_t *vm_page);
 void _free_data_blocks(meta_block_t *meta_block);
 
+vm_page_t* _reserve_vm_page(vm_page_item_t *vm_page_item, uint32_t alloc_size, bool_t populate, bool_t lock);
+uint32_t _release_reserved_vm_pages(vm_page_item_t *vm_page_item);
+
+size_t _trim_free_data_block(meta_block_t *meta_block);
+size_t _trim_vm_pages();
+
 void _walk_vm_page_items();
 void _print_memory_usage();
 void _walk_vm_pages(char const *struct_name);
 
+// Allocation from a type looked up once, defined in halloc.c for the malloc shim
+vm_page_item_t* _get_cached_page_item(vm_page_item_t **cached_item, char *struct_name, uint32_t struct_size);
+void* _halloc_page_item(vm_page_item_t *vm_page_item, size_t units, size_t alignment);
+
 #endif /* __MEMTOOLS__ */
@@ -0,0 +1,238 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "memtools.h"
+#include "slab.h"
+#include "numa.h"
+
+#define NUMA_NODE_MASK_BITS (8 * sizeof(unsigned long))
+#define NUMA_NODE_MASK_LONGS (NUMA_MAX_NODES / NUMA_NODE_MASK_BITS)
+#define NUMA_PAGE_QUERY_BATCH 64
+
+#define IS_NUMA_NODE_IN_MASK(node_mask, node) \
+    (((node_mask)[(node) / NUMA_NODE_MASK_BITS] >> ((node) % NUMA_NODE_MASK_BITS)) & 1)
+
+static size_t NUMA_NODE_COUNT = 0; // Zero until the allowed nodes have been queried
+static unsigned long allowed_numa_nodes[NUMA_NODE_MASK_LONGS];
+
+// Policy of the allocating thread for types that don't have a policy of their own
+static _Thread_local uint32_t thread_numa_policy = NUMA_POLICY_DEFAULT;
+static _Thread_local uint32_t thread_numa_node = 0;
+
+static char const *numa_policy_names[] = {"default", "interleave", "bind", "local"};
+
+
+static void _query_numa_nodes() {
+    if (NUMA_NODE_COUNT > 0) {
+        return;
+    }
+
+    memset(allowed_numa_nodes, 0, sizeof allowed_numa_nodes);
+
+#ifdef __linux__
+    int mode = 0;
+
+    if (syscall(SYS_get_mempolicy, &mode, allowed_numa_nodes, NUMA_MAX_NODES + 1UL,
+            NULL, MPOL_FLAG_MEMS_ALLOWED) == 0) {
+        for (uint32_t node = 0; node < NUMA_MAX_NODES; node++) {
+            if (IS_NUMA_NODE_IN_MASK(allowed_numa_nodes, node)) ++NUMA_NODE_COUNT;
+        }
+    }
+#endif
+
+    if (NUMA_NODE_COUNT == 0) {
+        // Kernel without numa support or too many nodes, treat as a single node machine
+        memset(allowed_numa_nodes, 0, sizeof allowed_numa_nodes);
+        allowed_numa_nodes[0] = 1;
+        NUMA_NODE_COUNT = 1;
+    }
+}
+
+size_t _get_numa_node_count() {
+    _query_numa_nodes();
+    return NUMA_NODE_COUNT;
+}
+
+bool_t _is_numa_node_allowed(uint32_t node) {
+    _query_numa_nodes();
+
+    if (node >= NUMA_MAX_NODES) {
+        return false;
+    }
+    return IS_NUMA_NODE_IN_MASK(allowed_numa_nodes, node);
+}
+
+static bool_t _is_numa_policy_valid(uint32_t policy, uint32_t node) {
+    _query_numa_nodes();
+
+    if (policy > NUMA_POLICY_LOCAL) {
+        fprintf(stderr, "%s: error: unknown numa policy %u.\n", __func__, policy);
+        return false;
+    }
+    if (policy == NUMA_POLICY_BIND && !_is_numa_node_allowed(node)) {
+        fprintf(stderr, "%s: error: numa node %u isn't available.\n", __func__, node);
+        return false;
+    }
+    return true;
+}
+
+bool_t _set_page_item_numa_policy(vm_page_item_t *vm_page_item, uint32_t policy, uint32_t node) {
+    if (!_is_numa_policy_valid(policy, node)) {
+        return false;
+    }
+
+    vm_page_item->numa_policy = policy;
+    vm_page_item->numa_node = (policy == NUMA_POLICY_BIND) ? node : 0;
+
+    return true;
+}
+
+bool_t _set_thread_default_numa_policy(uint32_t policy, uint32_t node) {
+    if (!_is_numa_policy_valid(policy, node)) {
+        return false;
+    }
+
+    thread_numa_policy = policy;
+    thread_numa_node = (policy == NUMA_POLICY_BIND) ? node : 0;
+
+    return true;
+}
+
+bool_t _apply_numa_policy(vm_page_item_t *vm_page_item, void *addr, size_t length) {
+    uint32_t policy = vm_page_item->numa_policy;
+    uint32_t node = vm_page_item->numa_node;
+
+    if (policy == NUMA_POLICY_DEFAULT) {
+        policy = thread_numa_policy;
+        node = thread_numa_node;
+    }
+
+    if (policy == NUMA_POLICY_DEFAULT || _get_numa_node_count() < 2) {
+        // Nothing to place on a single node machine
+        return true;
+    }
+
+#ifdef __linux__
+    unsigned long node_mask[NUMA_NODE_MASK_LONGS] = {0};
+    int mode;
+
+    switch (policy) {
+    case NUMA_POLICY_INTERLEAVE:
+        mode = MPOL_MODE_INTERLEAVE;
+        memcpy(node_mask, allowed_numa_nodes, sizeof node_mask);
+        break;
+    case NUMA_POLICY_BIND:
+        mode = MPOL_MODE_BIND;
+        node_mask[node / NUMA_NODE_MASK_BITS] = 1UL << (node % NUMA_NODE_MASK_BITS);
+        break;
+    default:
+        // Preferred mode with an empty node mask places pages on the node of the faulting thread
+        mode = MPOL_MODE_PREFERRED;
+        break;
+    }
+
+    // Vm page header might have been faulted in already, move it along with the policy
+    if (syscall(SYS_mbind, addr, length, mode, node_mask, NUMA_MAX_NODES + 1UL, MPOL_FLAG_MOVE) == -1) {
+        fprintf(stderr, "%s: error: setting numa policy %s failed.\n", __func__, numa_policy_names[policy]);
+        perror("mbind: ");
+        return false;
+    }
+#else
+    (void)addr;
+    (void)length;
+    (void)node;
+#endif
+    return true;
+}
+
+size_t _count_numa_node_pages(void *addr, size_t length, uint64_t *node_page_counts) {
+    size_t resident_page_count = 0;
+
+#ifdef __linux__
+    size_t const system_page_size = _get_system_page_size();
+    void *pages[NUMA_PAGE_QUERY_BATCH];
+    int status[NUMA_PAGE_QUERY_BATCH];
+
+    for (size_t offset = 0; offset < length; offset += NUMA_PAGE_QUERY_BATCH * system_page_size) {
+        unsigned long page_count = 0;
+
+        for (; page_count < NUMA_PAGE_QUERY_BATCH && offset + page_count * system_page_size < length; page_count++) {
+            pages[page_count] = (char *)addr + offset + page_count * system_page_size;
+        }
+
+        // Without target nodes move_pages only reports the node of each page
+        if (syscall(SYS_move_pages, 0, page_count, pages, NULL, status, 0) == -1) {
+            return resident_page_count;
+        }
+
+        for (unsigned long i = 0; i < page_count; i++) {
+            // Pages not faulted in yet have a negative status
+            if (status[i] >= 0 && status[i] < NUMA_MAX_NODES) {
+                node_page_counts[status[i]] += 1;
+                resident_page_count += 1;
+            }
+        }
+    }
+#else
+    (void)addr;
+    (void)length;
+    (void)node_page_counts;
+#endif
+    return resident_page_count;
+}
+
+size_t _get_numa_node_page_counts(vm_page_item_t *vm_page_item, uint64_t *node_page_counts) {
+    memset(node_page_counts, 0, NUMA_MAX_NODES * sizeof(uint64_t));
+
+    size_t resident_page_count = 0;
+    vm_page_item_t *heap_page_item = vm_page_item->heap_item ? vm_page_item->heap_item : vm_page_item;
+    vm_page_t *vm_page = heap_page_item->first_page;
+
+    TRAVERSE_PAGES_BEGIN(vm_page)
+    {
+        resident_page_count += _count_numa_node_pages(
+            vm_page, vm_page->system_page_count * _get_system_page_size(), node_page_counts
+        );
+    }
+    TRAVERSE_PAGES_END(vm_page);
+
+    slab_page_t *slab_page = vm_page_item->first_slab_page;
+
+    if (slab_page != NULL) {
+        do {
+            resident_page_count += _count_numa_node_pages(slab_page, SLAB_PAGE_SIZE, node_page_counts);
+            slab_page = slab_page->next;
+        } while (slab_page != vm_page_item->first_slab_page);
+    }
+    return resident_page_count;
+}
+
+void _walk_numa_nodes(vm_page_item_t *vm_page_item) {
+    if (vm_page_item->numa_policy == NUMA_POLICY_BIND) {
+        fprintf(stdout, "> numa policy of the type is bind to node %u\n", vm_page_item->numa_node);
+    } else if (vm_page_item->numa_policy != NUMA_POLICY_DEFAULT) {
+        fprintf(stdout, "> numa policy of the type is %s\n", numa_policy_names[vm_page_item->numa_policy]);
+    }
+
+    uint64_t node_page_counts[NUMA_MAX_NODES];
+
+    if (_get_numa_node_page_counts(vm_page_item, node_page_counts) == 0) {
+        return;
+    }
+
+    fprintf(stdout, "> resident system pages per numa node:");
+
+    for (uint32_t node = 0; node < NUMA_MAX_NODES; node++) {
+        if (node_page_counts[node] > 0) {
+            fprintf(stdout, " node %u: %llu", node, (unsigned long long)node_page_counts[node]);
+        }
+    }
+    fprintf(stdout, "\n\n");
+}
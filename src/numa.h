@@ -0,0 +1,36 @@
+#ifndef __NUMA__
+#define __NUMA__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "memtools.h"
+
+#define NUMA_MAX_NODES 64 // Nodes beyond this are never used by the policies
+
+// Policies equal to HALLOC_NUMA_* of the public API
+#define NUMA_POLICY_DEFAULT 0
+#define NUMA_POLICY_INTERLEAVE 1
+#define NUMA_POLICY_BIND 2
+#define NUMA_POLICY_LOCAL 3
+
+// Linux memory policy modes and flags for mbind and get_mempolicy
+#define MPOL_MODE_PREFERRED 1
+#define MPOL_MODE_BIND 2
+#define MPOL_MODE_INTERLEAVE 3
+#define MPOL_FLAG_MOVE (1 << 1)
+#define MPOL_FLAG_MEMS_ALLOWED (1 << 2)
+
+size_t _get_numa_node_count();
+bool_t _is_numa_node_allowed(uint32_t node);
+
+bool_t _set_page_item_numa_policy(vm_page_item_t *vm_page_item, uint32_t policy, uint32_t node);
+bool_t _set_thread_default_numa_policy(uint32_t policy, uint32_t node);
+bool_t _apply_numa_policy(vm_page_item_t *vm_page_item, void *addr, size_t length);
+
+size_t _count_numa_node_pages(void *addr, size_t length, uint64_t *node_page_counts);
+size_t _get_numa_node_page_counts(vm_page_item_t *vm_page_item, uint64_t *node_page_counts);
+void _walk_numa_nodes(vm_page_item_t *vm_page_item);
+
+#endif /* __NUMA__ */
@@ -0,0 +1,352 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <execinfo.h>
+
+#include "memtools.h"
+#include "profile.h"
+
+#define PROFILE_WRITE_BUFFER_SIZE 4096
+#define GET_PROFILE_SAMPLE_INDEX(data) (((uintptr_t)(data) >> 4) * 0x9e3779b97f4a7c15ULL >> 48)
+
+// Zero disables sampling, otherwise the mean count of allocated bytes between two samples
+static size_t PROFILE_SAMPLING_RATE = 0;
+static size_t live_sample_count = 0;
+static size_t dropped_sample_count = 0;
+
+static profile_bucket_t *profile_buckets = NULL;
+static profile_sample_t *profile_samples = NULL;
+static pthread_mutex_t profile_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Countdown of each thread to its next sample, drawn again when the sampling rate has changed
+static _Thread_local int64_t bytes_until_sample = 0;
+static _Thread_local size_t thread_sampling_rate = 0;
+static _Thread_local uint64_t random_state = 0;
+// Allocations of the profiler itself, e.g. by backtrace or stdio, are never sampled
+static _Thread_local bool_t is_profiler_active = false;
+
+_Static_assert(PROFILE_SAMPLE_COUNT == 1 << 16, "sample index is the top 16 bits of the address hash");
+
+
+static uint64_t _get_random_number() {
+    if (random_state == 0) {
+        random_state = ((uintptr_t)&random_state ^ (uint64_t)getpid()) * 0x9e3779b97f4a7c15ULL | 1;
+    }
+    // Xorshift64
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 7;
+    random_state ^= random_state << 17;
+
+    return random_state;
+}
+
+static double _get_log2(uint64_t value) {
+    int const exponent = 63 - __builtin_clzll(value);
+    double const x = (double)value / (double)(1ULL << exponent) - 1.0;
+
+    // Polynomial approximation of log2(1 + x) on [0, 1), sampling needs no better accuracy
+    return exponent + x * (1.4425449 + x * (-0.7181452 + x * 0.2758002));
+}
+
+static int64_t _get_next_sample_distance(size_t sampling_rate) {
+    // Exponentially distributed distances make the samples a poisson process over allocated bytes
+    uint64_t const random_number = (_get_random_number() >> 11) + 1;
+    double const distance = (53.0 - _get_log2(random_number)) * 0.6931471805599453 * sampling_rate;
+
+    return (int64_t)distance + 1;
+}
+
+void _set_profile_sampling_rate(size_t sampling_rate) {
+    if (sampling_rate > 0) {
+        // Backtrace might allocate when called the first time, which must not happen while sampling
+        void *frames[PROFILE_MAX_FRAMES];
+
+        is_profiler_active = true;
+        backtrace(frames, PROFILE_MAX_FRAMES);
+        is_profiler_active = false;
+    }
+    PROFILE_SAMPLING_RATE = sampling_rate;
+}
+
+size_t _get_profile_sampling_rate() {
+    return PROFILE_SAMPLING_RATE;
+}
+
+static bool_t _init_profile_tables() {
+    if (profile_samples != NULL) {
+        return true;
+    }
+
+    size_t const system_page_size = _get_system_page_size();
+    size_t const bucket_units = ALIGN_UP(PROFILE_BUCKET_COUNT * sizeof(profile_bucket_t), system_page_size) / system_page_size;
+    size_t const sample_units = ALIGN_UP(PROFILE_SAMPLE_COUNT * sizeof(profile_sample_t), system_page_size) / system_page_size;
+
+    // Tables are zero-filled and faulted in only where entries are stored
+    profile_buckets = _create_anonymous_memory_mapping(bucket_units);
+    profile_samples = _create_anonymous_memory_mapping(sample_units);
+
+    if (profile_buckets == NULL || profile_samples == NULL) {
+        fprintf(stderr, "%s: error: profile tables cannot be mapped.\n", __func__);
+        if (profile_buckets != NULL) _delete_memory_mapping(profile_buckets, bucket_units);
+        if (profile_samples != NULL) _delete_memory_mapping(profile_samples, sample_units);
+        profile_buckets = NULL;
+        profile_samples = NULL;
+        return false;
+    }
+    return true;
+}
+
+static profile_bucket_t* _get_profile_bucket(void **frames, uint32_t frame_count) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (uint32_t i = 0; i < frame_count; i++) {
+        hash = (hash ^ (uintptr_t)frames[i]) * 0x100000001b3ULL;
+    }
+    hash |= 1;
+
+    for (uint32_t probe = 0; probe < PROFILE_BUCKET_COUNT; probe++) {
+        profile_bucket_t *bucket = &profile_buckets[(hash + probe) & (PROFILE_BUCKET_COUNT - 1)];
+
+        if (bucket->hash == 0) {
+            bucket->hash = hash;
+            bucket->frame_count = frame_count;
+            memcpy(bucket->frames, frames, frame_count * sizeof(void *));
+            return bucket;
+        }
+        if (bucket->hash == hash && bucket->frame_count == frame_count &&
+            memcmp(bucket->frames, frames, frame_count * sizeof(void *)) == 0) {
+            return bucket;
+        }
+    }
+    return NULL;
+}
+
+static bool_t _add_profile_sample(void const *data, size_t size, profile_bucket_t *bucket) {
+    if (live_sample_count >= PROFILE_SAMPLE_COUNT / 2) {
+        // Keep the load factor low for short probe sequences
+        return false;
+    }
+
+    uint32_t index = GET_PROFILE_SAMPLE_INDEX(data);
+
+    while (profile_samples[index].data != NULL) {
+        index = (index + 1) & (PROFILE_SAMPLE_COUNT - 1);
+    }
+
+    profile_samples[index].data = data;
+    profile_samples[index].size = size;
+    profile_samples[index].bucket = bucket;
+    __atomic_store_n(&live_sample_count, live_sample_count + 1, __ATOMIC_RELAXED);
+
+    return true;
+}
+
+static void _remove_profile_sample(uint32_t index) {
+    profile_samples[index].data = NULL;
+    __atomic_store_n(&live_sample_count, live_sample_count - 1, __ATOMIC_RELAXED);
+
+    // Samples after the removed one move back to keep their probe sequences unbroken
+    uint32_t hole = index;
+
+    for (index = (index + 1) & (PROFILE_SAMPLE_COUNT - 1); profile_samples[index].data != NULL;
+         index = (index + 1) & (PROFILE_SAMPLE_COUNT - 1)) {
+        uint32_t const home = GET_PROFILE_SAMPLE_INDEX(profile_samples[index].data);
+
+        // Sample can fill the hole when its home index is not cyclically in (hole, index]
+        if (((index - home) & (PROFILE_SAMPLE_COUNT - 1)) >= ((index - hole) & (PROFILE_SAMPLE_COUNT - 1))) {
+            profile_samples[hole] = profile_samples[index];
+            profile_samples[index].data = NULL;
+            hole = index;
+        }
+    }
+}
+
+// Kept out of line such that the count of skipped frames holds
+__attribute__((noinline)) static void _record_sample(void const *data, size_t size) {
+    void *frames[PROFILE_MAX_FRAMES + PROFILE_SKIPPED_FRAMES];
+    int frame_count = backtrace(frames, PROFILE_MAX_FRAMES + PROFILE_SKIPPED_FRAMES);
+
+    frame_count = (frame_count > PROFILE_SKIPPED_FRAMES) ? frame_count - PROFILE_SKIPPED_FRAMES : 0;
+
+    pthread_mutex_lock(&profile_lock);
+
+    profile_bucket_t *bucket = NULL;
+
+    if (_init_profile_tables()) {
+        bucket = _get_profile_bucket(frames + PROFILE_SKIPPED_FRAMES, frame_count);
+    }
+
+    if (bucket != NULL && _add_profile_sample(data, size, bucket)) {
+        bucket->alloc_count += 1;
+        bucket->alloc_bytes += size;
+    } else {
+        dropped_sample_count += 1;
+    }
+    pthread_mutex_unlock(&profile_lock);
+}
+
+void _sample_allocation(void const *data, size_t size) {
+    if (PROFILE_SAMPLING_RATE == 0 || is_profiler_active) {
+        return;
+    }
+
+    if (thread_sampling_rate != PROFILE_SAMPLING_RATE) {
+        thread_sampling_rate = PROFILE_SAMPLING_RATE;
+        bytes_until_sample = _get_next_sample_distance(thread_sampling_rate);
+    }
+
+    bytes_until_sample -= (int64_t)size;
+
+    if (bytes_until_sample > 0) {
+        return;
+    }
+
+    bytes_until_sample = _get_next_sample_distance(thread_sampling_rate);
+
+    is_profiler_active = true;
+    _record_sample(data, size);
+    is_profiler_active = false;
+}
+
+void _forget_sampled_allocation(void const *data) {
+    if (__atomic_load_n(&live_sample_count, __ATOMIC_RELAXED) == 0) {
+        // Nothing sampled is alive, which is always the case without profiling
+        return;
+    }
+
+    pthread_mutex_lock(&profile_lock);
+
+    for (uint32_t index = GET_PROFILE_SAMPLE_INDEX(data); profile_samples[index].data != NULL;
+         index = (index + 1) & (PROFILE_SAMPLE_COUNT - 1)) {
+        if (profile_samples[index].data == data) {
+            profile_bucket_t *bucket = profile_samples[index].bucket;
+
+            bucket->free_count += 1;
+            bucket->free_bytes += profile_samples[index].size;
+            _remove_profile_sample(index);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&profile_lock);
+}
+
+size_t _get_live_sample_count() {
+    return __atomic_load_n(&live_sample_count, __ATOMIC_RELAXED);
+}
+
+static bool_t _write_all(int fd, char const *buffer, size_t length) {
+    while (length > 0) {
+        ssize_t const written = write(fd, buffer, length);
+
+        if (written <= 0) {
+            return false;
+        }
+        buffer += written;
+        length -= written;
+    }
+    return true;
+}
+
+static bool_t _write_profile_buckets(int fd) {
+    char line[PROFILE_WRITE_BUFFER_SIZE];
+    uint64_t totals[4] = {0};
+
+    for (uint32_t i = 0; profile_buckets != NULL && i < PROFILE_BUCKET_COUNT; i++) {
+        profile_bucket_t const *bucket = &profile_buckets[i];
+
+        totals[0] += bucket->alloc_count - bucket->free_count;
+        totals[1] += bucket->alloc_bytes - bucket->free_bytes;
+        totals[2] += bucket->alloc_count;
+        totals[3] += bucket->alloc_bytes;
+    }
+
+    // Legacy heap profile of pprof, in-use and cumulative counts are in the same file
+    int length = snprintf(line, sizeof line, "heap profile: %llu: %llu [%llu: %llu] @ heap_v2/%zu\n",
+        (unsigned long long)totals[0], (unsigned long long)totals[1],
+        (unsigned long long)totals[2], (unsigned long long)totals[3], PROFILE_SAMPLING_RATE
+    );
+    if (!_write_all(fd, line, length)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; profile_buckets != NULL && i < PROFILE_BUCKET_COUNT; i++) {
+        profile_bucket_t const *bucket = &profile_buckets[i];
+
+        if (bucket->hash == 0) continue;
+
+        length = snprintf(line, sizeof line, "%llu: %llu [%llu: %llu] @",
+            (unsigned long long)(bucket->alloc_count - bucket->free_count),
+            (unsigned long long)(bucket->alloc_bytes - bucket->free_bytes),
+            (unsigned long long)bucket->alloc_count, (unsigned long long)bucket->alloc_bytes
+        );
+        for (uint32_t frame = 0; frame < bucket->frame_count; frame++) {
+            length += snprintf(line + length, sizeof line - length, " %p", bucket->frames[frame]);
+        }
+        line[length++] = '\n';
+
+        if (!_write_all(fd, line, length)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool_t _write_mapped_libraries(int fd) {
+    static char const header[] = "\nMAPPED_LIBRARIES:\n";
+
+    if (!_write_all(fd, header, sizeof header - 1)) {
+        return false;
+    }
+
+    // Pprof symbolizes the addresses with the mappings of the process
+    int const maps_fd = open("/proc/self/maps", O_RDONLY);
+
+    if (maps_fd == -1) {
+        return true;
+    }
+
+    char buffer[PROFILE_WRITE_BUFFER_SIZE];
+    ssize_t length;
+    bool_t is_written = true;
+
+    while (is_written && (length = read(maps_fd, buffer, sizeof buffer)) > 0) {
+        is_written = _write_all(fd, buffer, length);
+    }
+    close(maps_fd);
+
+    return is_written;
+}
+
+bool_t _write_heap_profile(char const *path) {
+    int const fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (fd == -1) {
+        fprintf(stderr, "%s: error: profile file %s cannot be opened.\n", __func__, path);
+        perror("open: ");
+        return false;
+    }
+
+    is_profiler_active = true;
+    pthread_mutex_lock(&profile_lock);
+
+    bool_t const is_written = _write_profile_buckets(fd) && _write_mapped_libraries(fd);
+
+    pthread_mutex_unlock(&profile_lock);
+    is_profiler_active = false;
+
+    close(fd);
+
+    if (!is_written) {
+        fprintf(stderr, "%s: error: profile file %s cannot be written.\n", __func__, path);
+    }
+    if (dropped_sample_count > 0) {
+        fprintf(stderr, "%s: warning: %zu samples were dropped, profile tables are full.\n",
+            __func__, dropped_sample_count
+        );
+    }
+    return is_written;
+}
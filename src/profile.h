@@ -0,0 +1,46 @@
+#ifndef __PROFILE__
+#define __PROFILE__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "memtools.h"
+
+#define PROFILE_MAX_FRAMES 32
+#define PROFILE_SKIPPED_FRAMES 2 // Frames of the profiler itself
+#define PROFILE_BUCKET_COUNT 4096 // Distinct call stacks, must be a power of two
+#define PROFILE_SAMPLE_COUNT 65536 // Live samples, must be a power of two
+
+/*
+Call stack that allocated sampled data. Counts are of the samples, pprof scales them by the
+sampling rate into estimates of all allocations.
+*/
+typedef struct profile_bucket_ {
+    uint64_t hash; // Zero for an unused bucket
+    uint32_t frame_count;
+    uint32_t : 32;
+    uint64_t alloc_count;
+    uint64_t alloc_bytes;
+    uint64_t free_count;
+    uint64_t free_bytes;
+    void *frames[PROFILE_MAX_FRAMES];
+} profile_bucket_t;
+
+// Live sampled data block, found by its address when freed
+typedef struct profile_sample_ {
+    void const *data; // NULL for an unused sample
+    uint64_t size;
+    profile_bucket_t *bucket;
+} profile_sample_t;
+
+void _set_profile_sampling_rate(size_t sampling_rate);
+size_t _get_profile_sampling_rate();
+
+void _sample_allocation(void const *data, size_t size);
+void _forget_sampled_allocation(void const *data);
+size_t _get_live_sample_count();
+
+bool_t _write_heap_profile(char const *path);
+
+#endif /* __PROFILE__ */
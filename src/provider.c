@@ -0,0 +1,190 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "memtools.h"
+#include "arena.h"
+#include "provider.h"
+
+static void* _map_anonymous_pages(void *context, size_t length, size_t alignment, int flags);
+static int _unmap_anonymous_pages(void *context, void *addr, size_t length);
+static int _advise_anonymous_pages(void *context, void *addr, size_t length, int advice);
+static size_t _get_anonymous_page_size(void *context);
+
+// Static initializers can't copy another object, both providers start from this one list
+#define DEFAULT_PAGE_PROVIDER {     \
+    _map_anonymous_pages,           \
+    _unmap_anonymous_pages,         \
+    _advise_anonymous_pages,        \
+    _get_anonymous_page_size,       \
+    NULL,                           \
+}
+
+static page_provider_t const default_page_provider = DEFAULT_PAGE_PROVIDER;
+static page_provider_t page_provider = DEFAULT_PAGE_PROVIDER;
+// Page size is fixed once memory has been mapped, sizes of vm pages are counted in pages
+static bool_t has_mapped_pages = false;
+
+
+void _populate_pages(void *addr, size_t length, size_t page_size) {
+    // Writing to each page faults in a private page for it
+    for (size_t offset = 0; offset < length; offset += page_size) {
+        volatile char *page = (char *)addr + offset;
+        *page = *page;
+    }
+}
+
+static void* _map_anonymous_pages(void *context, size_t length, size_t alignment, int flags) {
+    (void)context;
+
+    size_t const page_size = _get_anonymous_page_size(NULL);
+
+    if (_is_arena_reserved()) {
+        char *pages = _commit_arena_pages(length, alignment);
+
+        // Exhausted reservation falls back to separate mappings
+        if (pages != NULL) {
+            if (flags & PAGE_PROVIDER_POPULATE) _populate_pages(pages, length, page_size);
+            return pages;
+        }
+    }
+
+    // Map the excess for alignment and cut off the unaligned head and the tail
+    size_t const mapping_length = (alignment > page_size) ? length + alignment : length;
+    bool_t populate_by_touch = (flags & PAGE_PROVIDER_POPULATE) != 0;
+    int mmap_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+
+#ifdef MAP_POPULATE
+    // Populating the excess of an aligned mapping would fault in pages that get unmapped
+    if (populate_by_touch && mapping_length == length) {
+        mmap_flags |= MAP_POPULATE;
+        populate_by_touch = false;
+    }
+#endif
+
+    char *addr = mmap(NULL, mapping_length, PROT_READ | PROT_WRITE, mmap_flags, -1, 0);
+
+    if (addr == MAP_FAILED) {
+        perror("mmap: ");
+        return NULL;
+    }
+
+    if (mapping_length > length) {
+        char *aligned_addr = (char *)ALIGN_UP((uintptr_t)addr, alignment);
+        size_t const head_length = aligned_addr - addr;
+
+        if (head_length > 0) munmap(addr, head_length);
+        munmap(aligned_addr + length, mapping_length - head_length - length);
+        addr = aligned_addr;
+    }
+
+    if (populate_by_touch) {
+        _populate_pages(addr, length, page_size);
+    }
+    // Anonymous mappings are zero-filled, pages get faulted in only when touched
+    return addr;
+}
+
+static int _unmap_anonymous_pages(void *context, void *addr, size_t length) {
+    (void)context;
+
+    if (_is_arena_address(addr)) {
+        return _decommit_arena_pages(addr, length);
+    }
+
+    if (munmap(addr, length) == -1) {
+        perror("munmap: ");
+        return 0;
+    }
+    return 1;
+}
+
+static int _advise_anonymous_pages(void *context, void *addr, size_t length, int advice) {
+    (void)context;
+
+    if (advice == PAGE_PROVIDER_ADVICE_LOCK) {
+        if (mlock(addr, length) == -1) {
+            perror("mlock: ");
+            return 0;
+        }
+        return 1;
+    }
+    if (advice == PAGE_PROVIDER_ADVICE_UNLOCK) {
+        if (munlock(addr, length) == -1) {
+            perror("munlock: ");
+            return 0;
+        }
+        return 1;
+    }
+
+    if (madvise(addr, length, MADVISE_RELEASE_FLAG) == -1) {
+        perror("madvise: ");
+        return 0;
+    }
+    return 1;
+}
+
+static size_t _get_anonymous_page_size(void *context) {
+    (void)context;
+
+    long const page_size = sysconf(_SC_PAGESIZE);
+    return (page_size > 0) ? (size_t)page_size : 0;
+}
+
+bool_t _set_page_provider(page_provider_t const *provider) {
+    if (provider == NULL) {
+        provider = &default_page_provider;
+    }
+
+    if (!provider->map || !provider->unmap || !provider->advise || !provider->get_page_size) {
+        fprintf(stderr, "%s: error: page provider must have all of its callbacks.\n", __func__);
+        return false;
+    }
+
+    size_t const page_size = provider->get_page_size(provider->context);
+
+    if (page_size < SYS_MIN_PAGE_SIZE || (page_size & (page_size - 1)) != 0) {
+        fprintf(stderr,
+            "%s: error: page size %zu of the provider isn't a power of two of at least %d bytes.\n",
+            __func__, page_size, SYS_MIN_PAGE_SIZE
+        );
+        return false;
+    }
+    if (has_mapped_pages && page_size != _get_provider_page_size()) {
+        fprintf(stderr,
+            "%s: error: page size %zu of the provider differs from %zu of already mapped pages.\n",
+            __func__, page_size, _get_provider_page_size()
+        );
+        return false;
+    }
+
+    page_provider = *provider;
+    return true;
+}
+
+page_provider_t const* _get_page_provider() {
+    return &page_provider;
+}
+
+size_t _get_provider_page_size() {
+    return page_provider.get_page_size(page_provider.context);
+}
+
+void* _map_provider_pages(size_t length, size_t alignment, int flags) {
+    has_mapped_pages = true;
+    return page_provider.map(page_provider.context, length, alignment, flags);
+}
+
+bool_t _unmap_provider_pages(void *addr, size_t length) {
+    return page_provider.unmap(page_provider.context, addr, length);
+}
+
+bool_t _advise_provider_pages(void *addr, size_t length, int advice) {
+    return page_provider.advise(page_provider.context, addr, length, advice);
+}
+
+bool_t _reserve_address_space(size_t size) {
+    return _reserve_arena(size, _get_anonymous_page_size(NULL));
+}
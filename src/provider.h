@@ -0,0 +1,41 @@
+#ifndef __PROVIDER__
+#define __PROVIDER__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "memtools.h"
+
+// Flag and advices equal HALLOC_PAGE_* of the public API
+#define PAGE_PROVIDER_POPULATE 0x1
+#define PAGE_PROVIDER_ADVICE_RELEASE 0
+#define PAGE_PROVIDER_ADVICE_LOCK 1
+#define PAGE_PROVIDER_ADVICE_UNLOCK 2
+
+/*
+Source of all memory that halloc maps. Mapped pages must be readable, writable and zero-filled, and
+aligned to the requested alignment, which is a power of two multiple of the page size. Unmapping and
+advising may cover a part of a mapping. The default provider uses anonymous mmap, or commits pages
+from the address space arena once it has been reserved.
+*/
+typedef struct page_provider_ {
+    void* (*map)(void *context, size_t length, size_t alignment, int flags);
+    int (*unmap)(void *context, void *addr, size_t length);
+    int (*advise)(void *context, void *addr, size_t length, int advice);
+    size_t (*get_page_size)(void *context);
+    void *context;
+} page_provider_t;
+
+bool_t _set_page_provider(page_provider_t const *provider);
+page_provider_t const* _get_page_provider();
+size_t _get_provider_page_size();
+
+void* _map_provider_pages(size_t length, size_t alignment, int flags);
+bool_t _unmap_provider_pages(void *addr, size_t length);
+bool_t _advise_provider_pages(void *addr, size_t length, int advice);
+void _populate_pages(void *addr, size_t length, size_t page_size);
+
+bool_t _reserve_address_space(size_t size);
+
+#endif /* __PROVIDER__ */
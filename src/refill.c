@@ -0,0 +1,152 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "memtools.h"
+#include "region.h"
+#include "refill.h"
+
+static pthread_t refill_thread;
+static pthread_mutex_t refill_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t refill_stop_cond = PTHREAD_COND_INITIALIZER;
+static bool_t is_refill_running = false;
+static bool_t is_refill_stopping = false;
+static bool_t is_fork_handler_registered = false;
+static uint32_t refill_interval_us = DEFAULT_REFILL_INTERVAL_US;
+static refill_lock_func lock_heap = NULL;
+static refill_lock_func unlock_heap = NULL;
+
+
+uint32_t _refill_page_items(refill_lock_func lock, refill_lock_func unlock) {
+    vm_page_item_t *vm_page_items[REFILL_BATCH_SIZE];
+    uint32_t page_counts[REFILL_BATCH_SIZE];
+    uint32_t refill_count = 0;
+
+    lock();
+    // Pages of an open file heap or shared heap can only be taken under the lock
+    if (!_is_region_open()) {
+        refill_count = _collect_refill_page_items(vm_page_items, page_counts, REFILL_BATCH_SIZE);
+    }
+    unlock();
+
+    uint32_t added_count = 0;
+
+    for (uint32_t i = 0; i < refill_count; i++) {
+        fault_sample_t fault_sample;
+        _start_fault_sample(&fault_sample);
+
+        // Mapping and page faults happen while allocations go on
+        void *addr = _create_refill_memory_mapping(page_counts[i]);
+
+        if (addr == NULL) {
+            continue;
+        }
+
+        lock();
+        if (_add_refill_vm_page(vm_page_items[i], addr, page_counts[i])) {
+            _account_fault_sample(vm_page_items[i], &fault_sample);
+            added_count++;
+        }
+        unlock();
+    }
+    return added_count;
+}
+
+static void* _run_refill_thread(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&refill_lock);
+
+    while (!is_refill_stopping) {
+        pthread_mutex_unlock(&refill_lock);
+        _refill_page_items(lock_heap, unlock_heap);
+        pthread_mutex_lock(&refill_lock);
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+
+        uint64_t const nanoseconds = (uint64_t)deadline.tv_nsec + (uint64_t)refill_interval_us * 1000;
+        deadline.tv_sec += nanoseconds / 1000000000;
+        deadline.tv_nsec = nanoseconds % 1000000000;
+
+        while (!is_refill_stopping) {
+            if (pthread_cond_timedwait(&refill_stop_cond, &refill_lock, &deadline) == ETIMEDOUT) break;
+        }
+    }
+    pthread_mutex_unlock(&refill_lock);
+
+    return NULL;
+}
+
+static void _forget_refill_thread_after_fork() {
+    // Child has only the forking thread
+    pthread_mutex_init(&refill_lock, NULL);
+    pthread_cond_init(&refill_stop_cond, NULL);
+    is_refill_running = false;
+    is_refill_stopping = false;
+}
+
+bool_t _start_refill_thread(uint32_t interval_us, refill_lock_func lock, refill_lock_func unlock) {
+    pthread_mutex_lock(&refill_lock);
+
+    if (is_refill_running) {
+        pthread_mutex_unlock(&refill_lock);
+        fprintf(stderr, "%s: error: refill thread is already running.\n", __func__);
+        return false;
+    }
+
+    refill_interval_us = interval_us;
+    lock_heap = lock;
+    unlock_heap = unlock;
+    is_refill_stopping = false;
+
+    int const error = pthread_create(&refill_thread, NULL, _run_refill_thread, NULL);
+
+    if (error != 0) {
+        pthread_mutex_unlock(&refill_lock);
+        fprintf(stderr, "%s: error: refill thread cannot be created: %s\n", __func__, strerror(error));
+        return false;
+    }
+
+    if (!is_fork_handler_registered) {
+        is_fork_handler_registered = true;
+        pthread_atfork(NULL, NULL, _forget_refill_thread_after_fork);
+    }
+    is_refill_running = true;
+    pthread_mutex_unlock(&refill_lock);
+
+    return true;
+}
+
+bool_t _stop_refill_thread() {
+    pthread_mutex_lock(&refill_lock);
+
+    if (!is_refill_running) {
+        pthread_mutex_unlock(&refill_lock);
+        return false;
+    }
+
+    is_refill_stopping = true;
+    pthread_cond_signal(&refill_stop_cond);
+    pthread_mutex_unlock(&refill_lock);
+
+    pthread_join(refill_thread, NULL);
+
+    pthread_mutex_lock(&refill_lock);
+    is_refill_running = false;
+    pthread_mutex_unlock(&refill_lock);
+
+    return true;
+}
+
+bool_t _is_refill_thread_running() {
+    pthread_mutex_lock(&refill_lock);
+    bool_t const is_running = is_refill_running;
+    pthread_mutex_unlock(&refill_lock);
+
+    return is_running;
+}
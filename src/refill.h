@@ -0,0 +1,26 @@
+#ifndef __REFILL__
+#define __REFILL__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "memtools.h"
+
+#define REFILL_BATCH_SIZE 64 // Max count of vm pages mapped by one refill cycle
+#define DEFAULT_REFILL_INTERVAL_US 1000
+
+typedef void (*refill_lock_func)();
+
+/*
+Background thread that keeps free capacity mapped for the types that asked for it. Each cycle finds
+the heaps whose largest free data block is below their refill size under the heap lock, maps and faults
+in their new vm pages without the lock, and adds the pages to the heaps under the lock again.
+*/
+uint32_t _refill_page_items(refill_lock_func lock, refill_lock_func unlock);
+
+bool_t _start_refill_thread(uint32_t interval_us, refill_lock_func lock, refill_lock_func unlock);
+bool_t _stop_refill_thread();
+bool_t _is_refill_thread_running();
+
+#endif /* __REFILL__ */
@@ -0,0 +1,485 @@
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#include "memtools.h"
+#include "slab.h"
+#include "region.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0 // Without the flag the address is only a hint and gets verified
+#endif
+
+#define GET_REGION_EXTENT(offset) ((region_free_extent_t *)((char *)open_region + (offset)))
+
+static region_header_t *open_region = NULL;
+static int open_region_fd = -1;
+
+
+bool_t _is_region_open() {
+    return open_region != NULL;
+}
+
+bool_t _is_region_address(void const *addr) {
+    if (open_region == NULL) {
+        return false;
+    }
+    return (
+        (uintptr_t)addr >= open_region->base_address &&
+        (uintptr_t)addr - open_region->base_address < open_region->region_size
+    );
+}
+
+static void _insert_region_free_extent(uint64_t offset, uint64_t extent_size) {
+    uint64_t prev_offset = 0;
+    uint64_t next_offset = open_region->first_free_extent_offset;
+
+    // Free extents are sorted by offset and merged with their neighbours
+    while (next_offset != 0 && next_offset < offset) {
+        prev_offset = next_offset;
+        next_offset = GET_REGION_EXTENT(next_offset)->next_offset;
+    }
+
+    if (next_offset != 0 && offset + extent_size == next_offset) {
+        extent_size += GET_REGION_EXTENT(next_offset)->extent_size;
+        next_offset = GET_REGION_EXTENT(next_offset)->next_offset;
+    }
+
+    if (prev_offset != 0 && prev_offset + GET_REGION_EXTENT(prev_offset)->extent_size == offset) {
+        GET_REGION_EXTENT(prev_offset)->extent_size += extent_size;
+        GET_REGION_EXTENT(prev_offset)->next_offset = next_offset;
+        return;
+    }
+
+    region_free_extent_t *extent = GET_REGION_EXTENT(offset);
+    extent->extent_size = extent_size;
+    extent->next_offset = next_offset;
+
+    if (prev_offset != 0) {
+        GET_REGION_EXTENT(prev_offset)->next_offset = offset;
+    } else {
+        open_region->first_free_extent_offset = offset;
+    }
+}
+
+void* _allocate_region_pages(size_t units, size_t alignment_units) {
+    size_t const system_page_size = _get_system_page_size();
+    uint64_t const alloc_size = units * system_page_size;
+    uint64_t const alignment = alignment_units * system_page_size;
+    uint64_t *extent_link = &open_region->first_free_extent_offset;
+
+    // First fit from the free extents
+    while (*extent_link != 0) {
+        uint64_t const extent_offset = *extent_link;
+        region_free_extent_t *extent = GET_REGION_EXTENT(extent_offset);
+        uint64_t const extent_end = extent_offset + extent->extent_size;
+        uint64_t const aligned_offset = ALIGN_UP(open_region->base_address + extent_offset, alignment)
+            - open_region->base_address;
+
+        if (aligned_offset + alloc_size <= extent_end) {
+            *extent_link = extent->next_offset;
+
+            if (aligned_offset > extent_offset) {
+                _insert_region_free_extent(extent_offset, aligned_offset - extent_offset);
+            }
+            if (aligned_offset + alloc_size < extent_end) {
+                _insert_region_free_extent(aligned_offset + alloc_size, extent_end - aligned_offset - alloc_size);
+            }
+
+            // Reused pages must look like fresh anonymous memory
+            char *region_pages = (char *)open_region + aligned_offset;
+            memset(region_pages, 0, alloc_size);
+            return region_pages;
+        }
+        extent_link = &extent->next_offset;
+    }
+
+    uint64_t const aligned_offset = ALIGN_UP(open_region->base_address + open_region->bump_offset, alignment)
+        - open_region->base_address;
+
+    if (aligned_offset + alloc_size > open_region->region_size) {
+        fprintf(stderr,
+            "%s: error: heap of %llu bytes has no room for %llu bytes.\n",
+            __func__, (unsigned long long)open_region->region_size, (unsigned long long)alloc_size
+        );
+        return NULL;
+    }
+
+    if (aligned_offset > open_region->bump_offset) {
+        _insert_region_free_extent(open_region->bump_offset, aligned_offset - open_region->bump_offset);
+    }
+    open_region->bump_offset = aligned_offset + alloc_size;
+
+    // File was extended with zeros, never allocated pages are zero-filled
+    return (char *)open_region + aligned_offset;
+}
+
+void _free_region_pages(void *addr, size_t units) {
+    uint64_t const extent_size = units * _get_system_page_size();
+
+#ifdef MADV_REMOVE
+    // Give the pages back to the file system, failure only leaves the pages in the file
+    madvise(addr, extent_size, MADV_REMOVE);
+#endif
+
+    _insert_region_free_extent((char *)addr - (char *)open_region, extent_size);
+}
+
+size_t _get_region_free_extent_count() {
+    size_t extent_count = 0;
+    uint64_t extent_offset = open_region ? open_region->first_free_extent_offset : 0;
+
+    while (extent_offset != 0) {
+        ++extent_count;
+        extent_offset = GET_REGION_EXTENT(extent_offset)->next_offset;
+    }
+    return extent_count;
+}
+
+static void _init_region_lock(region_header_t *region) {
+    pthread_mutexattr_t lock_attr;
+
+    pthread_mutexattr_init(&lock_attr);
+    pthread_mutexattr_setpshared(&lock_attr, PTHREAD_PROCESS_SHARED);
+#ifdef __linux__
+    // Lock held by a process that dies gets handed over to the next process
+    pthread_mutexattr_setrobust(&lock_attr, PTHREAD_MUTEX_ROBUST);
+#endif
+    pthread_mutex_init(&region->lock, &lock_attr);
+    pthread_mutexattr_destroy(&lock_attr);
+}
+
+void _lock_region() {
+    if (open_region == NULL || !open_region->is_shared) {
+        return;
+    }
+
+#ifdef __linux__
+    if (pthread_mutex_lock(&open_region->lock) == EOWNERDEAD) {
+        // Heap may have been left inconsistent by the dead process but it stays usable for others
+        pthread_mutex_consistent(&open_region->lock);
+    }
+#else
+    pthread_mutex_lock(&open_region->lock);
+#endif
+}
+
+void _unlock_region() {
+    if (open_region == NULL || !open_region->is_shared) {
+        return;
+    }
+    pthread_mutex_unlock(&open_region->lock);
+}
+
+static uint64_t _get_region_data_offset(size_t region_size) {
+    // One bit for every slab page that fits into the region, slab pages are aligned by their address
+    size_t const slab_page_words = region_size / SLAB_PAGE_SIZE / 64 + 1;
+
+    return ALIGN_UP(sizeof(region_header_t) + slab_page_words * sizeof(uint64_t), _get_system_page_size());
+}
+
+void _mark_region_slab_page(void const *slab_page, bool_t is_mapped) {
+    uint64_t const index = ((uintptr_t)slab_page - open_region->base_address) / SLAB_PAGE_SIZE;
+
+    if (is_mapped) {
+        open_region->slab_page_bits[index / 64] |= (uint64_t)1 << (index % 64);
+    } else {
+        open_region->slab_page_bits[index / 64] &= ~((uint64_t)1 << (index % 64));
+    }
+}
+
+bool_t _is_region_slab_page(void const *slab_page) {
+    if ((uintptr_t)slab_page < open_region->base_address) {
+        // Slab page would start before the region
+        return false;
+    }
+
+    uint64_t const index = ((uintptr_t)slab_page - open_region->base_address) / SLAB_PAGE_SIZE;
+
+    return (open_region->slab_page_bits[index / 64] >> (index % 64)) & 1;
+}
+
+static region_header_t* _create_region(int fd, size_t region_size, bool_t is_shared) {
+    region_size = ALIGN_UP(region_size, _get_system_page_size());
+    uint64_t const data_offset = _get_region_data_offset(region_size);
+
+    if (region_size <= data_offset) {
+        fprintf(stderr, "%s: error: heap size %zu is too small.\n", __func__, region_size);
+        return NULL;
+    }
+
+    if (fd != -1 && ftruncate(fd, region_size) == -1) {
+        fprintf(stderr, "%s: error: resizing of the heap file failed.\n", __func__);
+        perror("ftruncate: ");
+        return NULL;
+    }
+
+    // Anonymous shared region is inherited by child processes at the same address
+    region_header_t *region = mmap(
+        NULL,
+        region_size,
+        PROT_READ|PROT_WRITE,
+        (fd != -1) ? MAP_SHARED : MAP_SHARED|MAP_ANONYMOUS,
+        fd,
+        0
+    );
+
+    if (region == MAP_FAILED) {
+        fprintf(stderr, "%s: error: mapping of the heap failed.\n", __func__);
+        perror("mmap: ");
+        return NULL;
+    }
+
+    region->version = REGION_VERSION;
+    region->system_page_size = _get_system_page_size();
+    region->meta_block_size = sizeof(meta_block_t);
+    region->page_item_size = sizeof(vm_page_item_t);
+    region->base_address = (uintptr_t)region;
+    region->region_size = region_size;
+    region->data_offset = data_offset;
+    region->bump_offset = data_offset;
+    region->first_free_extent_offset = 0;
+    region->first_vm_page_item_container = NULL;
+    region->root_object = NULL;
+    region->is_shared = is_shared;
+
+    _init_region_lock(region);
+
+    // Magic is published last, processes attaching meanwhile wait for it before they use the header
+    __atomic_store_n(&region->magic, REGION_MAGIC, __ATOMIC_RELEASE);
+
+    return region;
+}
+
+static bool_t _wait_for_region_header(int fd, region_header_t *header) {
+    // File is sized before its header is written, the magic of a header still being written is zero
+    for (uint32_t waited_us = 0; waited_us < REGION_ATTACH_TIMEOUT_US; waited_us += REGION_ATTACH_POLL_US) {
+        if (pread(fd, header, sizeof(region_header_t), 0) != (ssize_t)sizeof(region_header_t)) {
+            fprintf(stderr, "%s: error: reading of the heap header failed.\n", __func__);
+            return false;
+        }
+        if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != 0) {
+            return true;
+        }
+        usleep(REGION_ATTACH_POLL_US);
+    }
+
+    fprintf(stderr, "%s: error: heap header was not written by the creating process in time.\n", __func__);
+    return false;
+}
+
+static region_header_t* _map_existing_region(int fd, bool_t is_shared) {
+    region_header_t header;
+    struct stat file_stat;
+
+    if (!_wait_for_region_header(fd, &header)) {
+        return NULL;
+    }
+    if (fstat(fd, &file_stat) == -1) {
+        fprintf(stderr, "%s: error: reading status of the heap file failed.\n", __func__);
+        perror("fstat: ");
+        return NULL;
+    }
+    size_t const file_size = file_stat.st_size;
+
+    if (header.magic != REGION_MAGIC || header.version != REGION_VERSION ||
+        header.system_page_size != _get_system_page_size() ||
+        header.meta_block_size != sizeof(meta_block_t) ||
+        header.page_item_size != sizeof(vm_page_item_t) ||
+        header.region_size != file_size || header.is_shared != is_shared) {
+        fprintf(stderr, "%s: error: file isn't a heap of this kind compatible with this build.\n", __func__);
+        return NULL;
+    }
+
+    void *addr = mmap(
+        (void *)header.base_address,
+        header.region_size,
+        PROT_READ|PROT_WRITE,
+        MAP_SHARED|MAP_FIXED_NOREPLACE,
+        fd,
+        0
+    );
+
+    if (addr == MAP_FAILED || addr != (void *)header.base_address) {
+        fprintf(stderr,
+            "%s: error: heap cannot be mapped at its address %p, the range is in use.\n",
+            __func__, (void *)header.base_address
+        );
+        if (addr != MAP_FAILED) munmap(addr, header.region_size);
+        return NULL;
+    }
+
+    region_header_t *region = addr;
+
+    // Pairs with the publishing of the magic, the rest of the header is complete from here on
+    if (__atomic_load_n(&region->magic, __ATOMIC_ACQUIRE) != REGION_MAGIC) {
+        fprintf(stderr, "%s: error: heap header changed while it was mapped.\n", __func__);
+        munmap(addr, header.region_size);
+        return NULL;
+    }
+    return region;
+}
+
+static region_header_t* _open_region_file(int fd, size_t region_size, bool_t is_shared) {
+    struct stat file_stat;
+
+    // Empty file is initialized by whoever locks it first, the others attach to the heap it created
+    if (flock(fd, LOCK_EX) == -1) {
+        fprintf(stderr, "%s: error: locking of the heap file failed.\n", __func__);
+        perror("flock: ");
+        return NULL;
+    }
+
+    if (fstat(fd, &file_stat) == -1) {
+        fprintf(stderr, "%s: error: reading status of the heap file failed.\n", __func__);
+        perror("fstat: ");
+        flock(fd, LOCK_UN);
+        return NULL;
+    }
+
+    region_header_t *region = NULL;
+    bool_t const is_empty = file_stat.st_size == 0;
+
+    if (is_empty) {
+        region = _create_region(fd, region_size, is_shared);
+    }
+    flock(fd, LOCK_UN);
+
+    if (is_empty) {
+        return region;
+    }
+
+    region = _map_existing_region(fd, is_shared);
+
+    if (region != NULL && !is_shared) {
+        // File heap is used by a single process at a time, its lock may be left locked by a crash
+        _init_region_lock(region);
+    }
+    return region;
+}
+
+static int _open_region_fd(char const *path, bool_t is_shared) {
+    int const flags = O_RDWR|O_CREAT|O_EXCL;
+    int fd = is_shared ? shm_open(path, flags, 0600) : open(path, flags, 0600);
+
+    if (fd == -1 && errno == EEXIST) {
+        // Heap exists already or is being created by another process, it's attached to
+        fd = is_shared ? shm_open(path, O_RDWR, 0600) : open(path, O_RDWR);
+    }
+    return fd;
+}
+
+static void _use_region(region_header_t *region, int fd) {
+    open_region = region;
+    open_region_fd = fd;
+
+    _set_page_item_registry(&open_region->first_vm_page_item_container, REGION_FIRST_PAGE_ITEM_ID);
+}
+
+bool_t _open_file_region(char const *path, size_t region_size) {
+    if (open_region != NULL) {
+        fprintf(stderr, "%s: error: a file heap or a shared heap is already open.\n", __func__);
+        return false;
+    }
+
+    int fd = _open_region_fd(path, false);
+
+    if (fd == -1) {
+        fprintf(stderr, "%s: error: opening of file heap `%s` failed.\n", __func__, path);
+        perror("open: ");
+        return false;
+    }
+
+    region_header_t *region = _open_region_file(fd, region_size, false);
+
+    if (region == NULL) {
+        close(fd);
+        return false;
+    }
+
+    _use_region(region, fd);
+    return true;
+}
+
+bool_t _open_shared_region(char const *name, size_t region_size) {
+    if (open_region != NULL) {
+        fprintf(stderr, "%s: error: a file heap or a shared heap is already open.\n", __func__);
+        return false;
+    }
+
+    if (name == NULL) {
+        region_header_t *region = _create_region(-1, region_size, true);
+
+        if (region == NULL) {
+            return false;
+        }
+        _use_region(region, -1);
+        return true;
+    }
+
+    int fd = _open_region_fd(name, true);
+
+    if (fd == -1) {
+        fprintf(stderr, "%s: error: opening of shared heap `%s` failed.\n", __func__, name);
+        perror("shm_open: ");
+        return false;
+    }
+
+    region_header_t *region = _open_region_file(fd, region_size, true);
+
+    if (region == NULL) {
+        close(fd);
+        return false;
+    }
+
+    _use_region(region, fd);
+    return true;
+}
+
+bool_t _close_region() {
+    if (open_region == NULL) {
+        fprintf(stderr, "%s: error: no file heap or shared heap is open.\n", __func__);
+        return false;
+    }
+
+    _set_page_item_registry(NULL, 0);
+
+    bool_t synced = true;
+    size_t const region_size = open_region->region_size;
+
+    if (!open_region->is_shared && msync(open_region, region_size, MS_SYNC) == -1) {
+        fprintf(stderr, "%s: error: writing of the file heap failed.\n", __func__);
+        perror("msync: ");
+        synced = false;
+    }
+
+    munmap(open_region, region_size);
+
+    if (open_region_fd != -1) {
+        close(open_region_fd);
+    }
+
+    open_region = NULL;
+    open_region_fd = -1;
+
+    return synced;
+}
+
+void _set_region_root_object(void *root_object) {
+    if (open_region == NULL) {
+        fprintf(stderr, "%s: error: no file heap or shared heap is open.\n", __func__);
+        return;
+    }
+    open_region->root_object = root_object;
+}
+
+void* _get_region_root_object() {
+    return open_region ? open_region->root_object : NULL;
+}
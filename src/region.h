@@ -0,0 +1,68 @@
+#ifndef __REGION__
+#define __REGION__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "memtools.h"
+
+#define REGION_MAGIC 0x314c4946434c4148ULL // "HALCFIL1" in little endian
+#define REGION_VERSION 2
+#define REGION_FIRST_PAGE_ITEM_ID 0x80000000 // Ids of region types never equal ids of other types
+#define REGION_ATTACH_TIMEOUT_US 1000000 // Time an attaching process waits for the creator to write the header
+#define REGION_ATTACH_POLL_US 1000
+
+/*
+Header in the first system pages of a region, i.e. a file heap or a shared heap. The region is always
+mapped at the address it was created at, hence all pointers inside it, both of halloc and of the user,
+stay valid between processes. Offsets of free extents are relative to the start of the region.
+
+Slab pages of the region are marked in the bitmap after the header, such that every process using the
+region recognizes them. Shared regions are guarded by the process-shared lock.
+*/
+typedef struct region_header_ {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t system_page_size;
+    uint32_t meta_block_size; // Sizes of the persisted structures must match the ones of the process
+    uint32_t page_item_size;
+    uintptr_t base_address;
+    uint64_t region_size;
+    uint64_t data_offset; // Size of the header pages
+    uint64_t bump_offset; // Pages from this offset on have never been allocated
+    uint64_t first_free_extent_offset; // Zero when there are no free extents
+    vm_page_item_container_t *first_vm_page_item_container;
+    void *root_object;
+    uint32_t is_shared;
+    pthread_mutex_t lock;
+    uint64_t slab_page_bits[];
+} region_header_t;
+
+// Free extent of pages stores its size and the offset of the next free extent at its start
+typedef struct region_free_extent_ {
+    uint64_t extent_size;
+    uint64_t next_offset;
+} region_free_extent_t;
+
+bool_t _open_file_region(char const *path, size_t region_size);
+bool_t _open_shared_region(char const *name, size_t region_size);
+bool_t _close_region();
+bool_t _is_region_open();
+bool_t _is_region_address(void const *addr);
+
+void _lock_region();
+void _unlock_region();
+
+void* _allocate_region_pages(size_t units, size_t alignment_units);
+void _free_region_pages(void *addr, size_t units);
+size_t _get_region_free_extent_count();
+
+void _mark_region_slab_page(void const *slab_page, bool_t is_mapped);
+bool_t _is_region_slab_page(void const *slab_page);
+
+void _set_region_root_object(void *root_object);
+void* _get_region_root_object();
+
+#endif /* __REGION__ */
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "memtools.h"
+#include "site.h"
+
+#define GET_SITE_TABLE_INDEX(file, line) \
+    ((((uintptr_t)(file) >> 3) ^ ((uintptr_t)(line) * 0x9e3779b97f4a7c15ULL)) & (SITE_TABLE_SIZE - 1))
+
+// Sites of each file are keyed by the address of its name, which is the same for a translation unit
+static site_t *sites = NULL;
+
+
+static bool_t _init_sites() {
+    if (sites != NULL) {
+        return true;
+    }
+
+    size_t const system_page_size = _get_system_page_size();
+    sites = _create_anonymous_memory_mapping(ALIGN_UP(SITE_TABLE_SIZE * sizeof(site_t), system_page_size) / system_page_size);
+
+    if (sites == NULL) {
+        fprintf(stderr, "%s: error: call site table cannot be mapped.\n", __func__);
+        return false;
+    }
+    sites[UNKNOWN_SITE_ID].file = "<unknown>";
+    return true;
+}
+
+uint32_t _get_site_id(char const *file, uint32_t line, char const *struct_name) {
+    if (!_init_sites() || file == NULL) {
+        return UNKNOWN_SITE_ID;
+    }
+
+    uint32_t site_id = GET_SITE_TABLE_INDEX(file, line);
+
+    for (uint32_t probe = 0; probe < SITE_TABLE_SIZE; probe++) {
+        if (site_id != UNKNOWN_SITE_ID) {
+            site_t *site = &sites[site_id];
+
+            if (site->file == NULL) {
+                site->file = file;
+                site->line = line;
+                site->struct_name = struct_name;
+                return site_id;
+            }
+            if (site->file == file && site->line == line) {
+                return site_id;
+            }
+        }
+        site_id = (site_id + 1) & (SITE_TABLE_SIZE - 1);
+    }
+
+    // Table is full, later sites are counted together
+    return UNKNOWN_SITE_ID;
+}
+
+void _account_site_allocation(uint32_t site_id, uint32_t block_size) {
+    if (sites == NULL) return;
+
+    site_t *site = &sites[site_id];
+
+    site->live_bytes += block_size;
+    site->live_count += 1;
+    site->alloc_count += 1;
+}
+
+void _account_site_free(uint32_t site_id, uint32_t block_size) {
+    if (sites == NULL || site_id >= SITE_TABLE_SIZE) return;
+
+    site_t *site = &sites[site_id];
+
+    if (site->live_count > 0) {
+        site->live_bytes -= block_size;
+        site->live_count -= 1;
+        site->free_count += 1;
+    }
+}
+
+bool_t _get_site_usage(char const *file, uint32_t line, site_t *usage) {
+    memset(usage, 0, sizeof(site_t));
+
+    bool_t is_found = false;
+
+    for (uint32_t site_id = 0; sites != NULL && site_id < SITE_TABLE_SIZE; site_id++) {
+        site_t const *site = &sites[site_id];
+
+        // File included by several translation units has a site for each of them
+        if (site->file == NULL || site->line != line || strcmp(site->file, file) != 0) {
+            continue;
+        }
+        if (!is_found) {
+            *usage = *site;
+            is_found = true;
+        } else {
+            usage->live_bytes += site->live_bytes;
+            usage->live_count += site->live_count;
+            usage->alloc_count += site->alloc_count;
+            usage->free_count += site->free_count;
+        }
+    }
+    return is_found;
+}
+
+void _walk_sites() {
+    for (uint32_t site_id = 0; sites != NULL && site_id < SITE_TABLE_SIZE; site_id++) {
+        site_t const *site = &sites[site_id];
+
+        if (site->file == NULL || site->alloc_count == 0) {
+            continue;
+        }
+
+        fprintf(stdout, "> %s:%u", site->file, site->line);
+
+        if (site->struct_name != NULL) {
+            fprintf(stdout, " (%s)", site->struct_name);
+        }
+        fprintf(stdout, " live bytes: %llu, live objects: %llu, allocs: %llu, frees: %llu\n",
+            (unsigned long long)site->live_bytes, (unsigned long long)site->live_count,
+            (unsigned long long)site->alloc_count, (unsigned long long)site->free_count
+        );
+    }
+    fprintf(stdout, "\n");
+}
@@ -0,0 +1,36 @@
+#ifndef __SITE__
+#define __SITE__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "memtools.h"
+
+#define SITE_TABLE_SIZE 4096 // Must be a power of two
+#define UNKNOWN_SITE_ID 0 // Allocations without a call site, e.g. by the malloc shim
+
+/*
+Call site of halloc, i.e. a source file and a line, and the data blocks it has allocated. Site id is
+the index of the site in the table, the site of a data block is stored in its meta block or in the side
+table of its slab page.
+*/
+typedef struct site_ {
+    char const *file; // NULL for an unused entry
+    char const *struct_name;
+    uint32_t line;
+    uint32_t : 32;
+    uint64_t live_bytes;
+    uint64_t live_count;
+    uint64_t alloc_count;
+    uint64_t free_count;
+} site_t;
+
+uint32_t _get_site_id(char const *file, uint32_t line, char const *struct_name);
+void _account_site_allocation(uint32_t site_id, uint32_t block_size);
+void _account_site_free(uint32_t site_id, uint32_t block_size);
+
+bool_t _get_site_usage(char const *file, uint32_t line, site_t *usage);
+void _walk_sites();
+
+#endif /* __SITE__ */
@@ -0,0 +1,303 @@
+#include <stdio.h>
+
+#include "memtools.h"
+#include "slab.h"
+#include "numa.h"
+#include "region.h"
+#include "lifetime.h"
+
+#define SLAB_MAP_ROOT_SIZE ((1UL << SLAB_MAP_LEVEL_SHIFT) * sizeof(uint64_t *))
+#define SLAB_MAP_LEAF_SIZE ((1UL << SLAB_MAP_LEVEL_SHIFT) / 8)
+
+// Map from addresses to a bit telling whether the slab page containing the address is mapped.
+// Slab pages of a file heap or a shared heap are marked in the region instead.
+static uint64_t **slab_page_map = NULL;
+
+
+static size_t _get_mapping_units(size_t size) {
+    size_t const system_page_size = _get_system_page_size();
+
+    return ALIGN_UP(size, system_page_size) / system_page_size;
+}
+
+static uint64_t* _get_slab_page_map_leaf(uintptr_t slab_page_key, bool_t create) {
+    if (slab_page_key >> (2 * SLAB_MAP_LEVEL_SHIFT)) {
+        // Address beyond the range of the map, such an address is never a slab page
+        return NULL;
+    }
+
+    if (slab_page_map == NULL) {
+        if (!create) return NULL;
+
+        // Zero-filled root gets faulted in only where leafs are stored
+        slab_page_map = _create_anonymous_memory_mapping(_get_mapping_units(SLAB_MAP_ROOT_SIZE));
+        if (slab_page_map == NULL) {
+            return NULL;
+        }
+    }
+
+    uint64_t **leaf = &slab_page_map[slab_page_key >> SLAB_MAP_LEVEL_SHIFT];
+
+    if (*leaf == NULL && create) {
+        *leaf = _create_anonymous_memory_mapping(_get_mapping_units(SLAB_MAP_LEAF_SIZE));
+    }
+    return *leaf;
+}
+
+static bool_t _mark_slab_page(slab_page_t *slab_page, bool_t is_mapped) {
+    if (_is_region_address(slab_page)) {
+        _mark_region_slab_page(slab_page, is_mapped);
+        return true;
+    }
+
+    uintptr_t const slab_page_key = (uintptr_t)slab_page >> SLAB_PAGE_SHIFT;
+    uint64_t *leaf = _get_slab_page_map_leaf(slab_page_key, is_mapped);
+
+    if (leaf == NULL) {
+        if (is_mapped) {
+            fprintf(stderr, "%s: error: slab page %p cannot be added to the map.\n",
+                __func__, (void *)slab_page
+            );
+        }
+        return false;
+    }
+
+    uint32_t const bit = slab_page_key & ((1UL << SLAB_MAP_LEVEL_SHIFT) - 1);
+
+    if (is_mapped) {
+        leaf[bit / 64] |= (uint64_t)1 << (bit % 64);
+    } else {
+        leaf[bit / 64] &= ~((uint64_t)1 << (bit % 64));
+    }
+    return true;
+}
+
+bool_t _is_slab_slot(void const *data) {
+    if (_is_region_address(data)) {
+        return _is_region_slab_page(GET_SLAB_PAGE(data));
+    }
+
+    uintptr_t const slab_page_key = (uintptr_t)data >> SLAB_PAGE_SHIFT;
+    uint64_t *leaf = _get_slab_page_map_leaf(slab_page_key, false);
+
+    if (leaf == NULL) {
+        return false;
+    }
+
+    uint32_t const bit = slab_page_key & ((1UL << SLAB_MAP_LEVEL_SHIFT) - 1);
+
+    return (leaf[bit / 64] >> (bit % 64)) & 1;
+}
+
+uint32_t _get_slab_slot_count(uint32_t slot_size) {
+    if (slot_size == 0 || slot_size > MAX_SLAB_SLOT_SIZE) {
+        return 0;
+    }
+    // Leave room for aligning the birth table and the first slot after the side tables
+    size_t const available_size = SLAB_PAGE_SIZE - sizeof(slab_page_t) - (GET_SLAB_SLOT_ALIGNMENT(slot_size) - 1)
+        - (SLAB_BIRTH_TABLE_ENTRY_SIZE ? sizeof(uint32_t) : 0);
+
+    return available_size / (slot_size + SLAB_SIDE_TABLE_ENTRY_SIZE);
+}
+
+bool_t _set_out_of_band_layout(vm_page_item_t *vm_page_item, bool_t enabled) {
+    if (!enabled) {
+        // Slots already allocated stay valid and are freed as usual
+        vm_page_item->item_flags &= ~PAGE_ITEM_OUT_OF_BAND;
+        return true;
+    }
+
+    if (_get_slab_slot_count(vm_page_item->struct_size) == 0) {
+        fprintf(stderr,
+            "%s: error: type size %u exceeds the max slot size %lu of out-of-band layout.\n",
+            __func__, vm_page_item->struct_size, MAX_SLAB_SLOT_SIZE
+        );
+        return false;
+    }
+    if (_get_system_page_size() > SLAB_PAGE_SIZE) {
+        fprintf(stderr,
+            "%s: error: system page size %zu exceeds the slab page size %lu.\n",
+            __func__, _get_system_page_size(), SLAB_PAGE_SIZE
+        );
+        return false;
+    }
+
+    vm_page_item->item_flags |= PAGE_ITEM_OUT_OF_BAND;
+    return true;
+}
+
+static void _link_slab_page_first(vm_page_item_t *vm_page_item, slab_page_t *slab_page) {
+    slab_page_t *first_slab_page = vm_page_item->first_slab_page;
+
+    if (first_slab_page == NULL) {
+        slab_page->prev = slab_page;
+        slab_page->next = slab_page;
+    } else {
+        slab_page->next = first_slab_page;
+        slab_page->prev = first_slab_page->prev;
+        first_slab_page->prev->next = slab_page;
+        first_slab_page->prev = slab_page;
+    }
+    vm_page_item->first_slab_page = slab_page;
+}
+
+static void _unlink_slab_page(slab_page_t *slab_page) {
+    vm_page_item_t *vm_page_item = slab_page->page_item;
+
+    if (slab_page->next == slab_page) {
+        vm_page_item->first_slab_page = NULL;
+    } else {
+        slab_page->prev->next = slab_page->next;
+        slab_page->next->prev = slab_page->prev;
+
+        if (vm_page_item->first_slab_page == slab_page) {
+            vm_page_item->first_slab_page = slab_page->next;
+        }
+    }
+    slab_page->prev = NULL;
+    slab_page->next = NULL;
+}
+
+static slab_page_t* _map_slab_page(vm_page_item_t *vm_page_item) {
+    size_t const units = _get_mapping_units(SLAB_PAGE_SIZE);
+    slab_page_t *slab_page = _create_aligned_memory_mapping(units);
+
+    if (slab_page == NULL) {
+        return NULL;
+    }
+    if (!_mark_slab_page(slab_page, true)) {
+        _delete_memory_mapping(slab_page, units);
+        return NULL;
+    }
+
+    _apply_numa_policy(vm_page_item, slab_page, SLAB_PAGE_SIZE);
+    _account_mapped_pages(vm_page_item, slab_page, SLAB_PAGE_SIZE);
+
+    slab_page->page_item = vm_page_item;
+    slab_page->slot_size = vm_page_item->struct_size;
+    slab_page->slot_count = _get_slab_slot_count(vm_page_item->struct_size);
+    slab_page->allocated_slot_count = 0;
+    slab_page->first_free_slot = slab_page->slot_count;
+    slab_page->untouched_slot = 0;
+    slab_page->slots_offset = ALIGN_UP(
+        GET_SLAB_SIDE_TABLES_END(slab_page->slot_count), GET_SLAB_SLOT_ALIGNMENT(slab_page->slot_size)
+    );
+
+    _link_slab_page_first(vm_page_item, slab_page);
+
+    return slab_page;
+}
+
+static void _free_slab_page(slab_page_t *slab_page) {
+    _account_unmapped_pages(slab_page->page_item, slab_page, SLAB_PAGE_SIZE);
+    _unlink_slab_page(slab_page);
+    _mark_slab_page(slab_page, false);
+    _delete_memory_mapping(slab_page, _get_mapping_units(SLAB_PAGE_SIZE));
+}
+
+void* _allocate_slab_slot(vm_page_item_t *vm_page_item) {
+    slab_page_t *slab_page = vm_page_item->first_slab_page;
+
+    if (slab_page == NULL || IS_SLAB_PAGE_FULL(slab_page)) {
+        // First slab page is full only if all of them are
+        slab_page = _map_slab_page(vm_page_item);
+        if (slab_page == NULL) {
+            return NULL;
+        }
+    }
+
+    uint32_t slot_index;
+
+    if (slab_page->first_free_slot < slab_page->slot_count) {
+        slot_index = slab_page->first_free_slot;
+        slab_page->first_free_slot = slab_page->slot_table[slot_index];
+    } else {
+        slot_index = slab_page->untouched_slot++;
+    }
+
+    slab_page->slot_table[slot_index] = SLAB_SLOT_ALLOCATED;
+    slab_page->allocated_slot_count += 1;
+
+    if (IS_SLAB_PAGE_FULL(slab_page)) {
+        // Rotate the full slab page behind the others
+        vm_page_item->first_slab_page = slab_page->next;
+    }
+
+    vm_page_item->live_block_count += 1;
+    vm_page_item->live_bytes += slab_page->slot_size;
+    vm_page_item->alloc_count += 1;
+
+#ifdef HALLOC_LIFETIME_STATS
+    GET_SLAB_SLOT_BIRTH_STAMP(slab_page, slot_index) = _get_birth_stamp();
+#endif
+
+    return GET_SLAB_SLOT(slab_page, slot_index);
+}
+
+void _free_slab_slot(void *data) {
+    slab_page_t *slab_page = GET_SLAB_PAGE(data);
+    size_t const data_offset = (char *)data - (char *)slab_page;
+
+    if (data_offset < slab_page->slots_offset || (data_offset - slab_page->slots_offset) % slab_page->slot_size) {
+        fprintf(stderr, "%s: error: address %p is not a start of a slot.\n", __func__, data);
+        return;
+    }
+
+    uint32_t const slot_index = GET_SLAB_SLOT_INDEX(slab_page, data);
+
+    if (slot_index >= slab_page->untouched_slot || slab_page->slot_table[slot_index] != SLAB_SLOT_ALLOCATED) {
+        fprintf(stderr, "%s: error: slot at address %p isn't allocated.\n", __func__, data);
+        return;
+    }
+
+    bool_t const was_full = IS_SLAB_PAGE_FULL(slab_page);
+    vm_page_item_t *vm_page_item = slab_page->page_item;
+
+    slab_page->slot_table[slot_index] = slab_page->first_free_slot;
+    slab_page->first_free_slot = slot_index;
+    slab_page->allocated_slot_count -= 1;
+
+    if (vm_page_item->live_block_count > 0) {
+        vm_page_item->live_block_count -= 1;
+        vm_page_item->live_bytes -= slab_page->slot_size;
+        vm_page_item->free_count += 1;
+#ifdef HALLOC_LIFETIME_STATS
+        _record_lifetime(vm_page_item, GET_SLAB_SLOT_BIRTH_STAMP(slab_page, slot_index));
+#endif
+    }
+
+    if (slab_page->allocated_slot_count == 0) {
+        _free_slab_page(slab_page);
+        return;
+    }
+
+    if (was_full && vm_page_item->first_slab_page != slab_page) {
+        // Slab page has a free slot again, move it in front of the full ones
+        _unlink_slab_page(slab_page);
+        _link_slab_page_first(vm_page_item, slab_page);
+    }
+}
+
+void _walk_slab_pages(vm_page_item_t *vm_page_item) {
+    slab_page_t *slab_page = vm_page_item->first_slab_page;
+
+    if (vm_page_item->item_flags & PAGE_ITEM_OUT_OF_BAND) {
+        fprintf(stdout, "> type uses out-of-band layout, single allocations are slots in slab pages of %lu bytes\n\n",
+            SLAB_PAGE_SIZE
+        );
+    }
+
+    if (slab_page == NULL) {
+        return;
+    }
+
+    do {
+        fprintf(stdout, "> slab page %p has %u allocated slots out of %u, slots start at %p\n",
+            (void *)slab_page, slab_page->allocated_slot_count, slab_page->slot_count,
+            GET_SLAB_SLOT(slab_page, 0)
+        );
+        slab_page = slab_page->next;
+    } while (slab_page != vm_page_item->first_slab_page);
+
+    fprintf(stdout, "\n");
+}
@@ -0,0 +1,83 @@
+#ifndef __SLAB__
+#define __SLAB__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "memtools.h"
+
+#define SLAB_PAGE_SHIFT 16
+#define SLAB_PAGE_SIZE (1UL << SLAB_PAGE_SHIFT) // Slab pages are aligned to their size
+#define MAX_SLAB_SLOT_SIZE (SLAB_PAGE_SIZE / 16)
+#define SLAB_SLOT_ALLOCATED UINT32_MAX
+#define SLAB_MAP_LEVEL_SHIFT 16 // Slab page map has two levels, both indexed by 16 bits
+
+#ifdef HALLOC_SITE_STATS
+#define SLAB_SIDE_TABLE_COUNT 2 // Call sites of the slots follow the free list table
+#else
+#define SLAB_SIDE_TABLE_COUNT 1
+#endif
+#ifdef HALLOC_LIFETIME_STATS
+#define SLAB_BIRTH_TABLE_ENTRY_SIZE sizeof(uint64_t) // Birth stamps of the slots follow the other tables
+#else
+#define SLAB_BIRTH_TABLE_ENTRY_SIZE 0
+#endif
+#define SLAB_SIDE_TABLE_ENTRY_SIZE (SLAB_SIDE_TABLE_COUNT * sizeof(uint32_t) + SLAB_BIRTH_TABLE_ENTRY_SIZE)
+
+/*
+Slab page of a type that uses the out-of-band layout. Header and the side table are in front of
+the slots and the slots follow each other without any metadata in between. Side table entry of a free
+slot holds the index of the next free slot, entry of an allocated slot is SLAB_SLOT_ALLOCATED.
+
+Slab pages of a type form a circular list such that pages with free slots precede the full ones.
+*/
+typedef struct slab_page_ {
+    struct slab_page_ *prev;
+    struct slab_page_ *next;
+    vm_page_item_t *page_item;
+    uint32_t slot_size;
+    uint32_t slot_count;
+    uint32_t allocated_slot_count;
+    uint32_t first_free_slot; // Equals slot_count when the free list is empty
+    uint32_t untouched_slot; // Slots from this index on have never been allocated
+    uint32_t slots_offset;
+    uint32_t slot_table[];
+} slab_page_t;
+
+
+// Natural alignment of a type divides its size, slots are aligned to the largest power of two that does
+#define GET_SLAB_SLOT_ALIGNMENT(slot_size) \
+    (((slot_size) & -(slot_size)) > DATA_BLOCK_ALIGNMENT ? (size_t)((slot_size) & -(slot_size)) : DATA_BLOCK_ALIGNMENT)
+
+#define GET_SLAB_PAGE(data) ((slab_page_t *)((uintptr_t)(data) & ~(SLAB_PAGE_SIZE - 1)))
+
+#define GET_SLAB_SLOT(slab_page, index) \
+    ((void *)((char *)(slab_page) + (slab_page)->slots_offset + (size_t)(index) * (slab_page)->slot_size))
+
+#define GET_SLAB_SLOT_INDEX(slab_page, data) \
+    ((uint32_t)(((char *)(data) - (char *)(slab_page) - (slab_page)->slots_offset) / (slab_page)->slot_size))
+
+#define GET_SLAB_BIRTH_TABLE_OFFSET(slot_count) \
+    ALIGN_UP(sizeof(slab_page_t) + (size_t)(slot_count) * SLAB_SIDE_TABLE_COUNT * sizeof(uint32_t), sizeof(uint64_t))
+
+#define GET_SLAB_SIDE_TABLES_END(slot_count) \
+    (GET_SLAB_BIRTH_TABLE_OFFSET(slot_count) + (size_t)(slot_count) * SLAB_BIRTH_TABLE_ENTRY_SIZE)
+
+#define GET_SLAB_SLOT_BIRTH_STAMP(slab_page, index) \
+    (((uint64_t *)((char *)(slab_page) + GET_SLAB_BIRTH_TABLE_OFFSET((slab_page)->slot_count)))[index])
+
+#define GET_SLAB_SLOT_SITE_ID(slab_page, index) ((slab_page)->slot_table[(slab_page)->slot_count + (index)])
+
+#define IS_SLAB_PAGE_FULL(slab_page) ((slab_page)->allocated_slot_count == (slab_page)->slot_count)
+
+uint32_t _get_slab_slot_count(uint32_t slot_size);
+bool_t _set_out_of_band_layout(vm_page_item_t *vm_page_item, bool_t enabled);
+
+bool_t _is_slab_slot(void const *data);
+void* _allocate_slab_slot(vm_page_item_t *vm_page_item);
+void _free_slab_slot(void *data);
+
+void _walk_slab_pages(vm_page_item_t *vm_page_item);
+
+#endif /* __SLAB__ */
@@ -26,6 +26,17 @@ typedef struct {
 
 extern test_func dll_tests[];
 extern test_func memtools_tests[];
+extern test_func slab_tests[];
+extern test_func numa_tests[];
+extern test_func region_tests[];
+extern test_func profile_tests[];
+extern test_func site_tests[];
+extern test_func lifetime_tests[];
+extern test_func provider_tests[];
+extern test_func arena_tests[];
+extern test_func handle_tests[];
+extern test_func refill_tests[];
+extern test_func epoch_tests[];
 extern test_func halloc_tests[];
 
 #endif /* __COMMON__ */
@@ -0,0 +1,165 @@
+// Shim is compiled into this test, every allocation of the test program goes through it
+#include "malloc.c"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "common.h"
+
+static void test_size_class_rounding() {
+    size_t previous_size_class = 0;
+    uint32_t previous_index = 0;
+
+    for (size_t size = 1; size <= SHIM_MAX_SIZE_CLASS; size++) {
+        size_t const size_class = _get_size_class(size);
+
+        assert(size_class >= size && size_class % DATA_BLOCK_ALIGNMENT == 0);
+        assert(_get_size_class(size_class) == size_class);
+
+        if (size > SHIM_MIN_STEPPED_SIZE_CLASS) {
+            // Four size classes per power of two waste less than a quarter
+            assert((size_class - size) * SHIM_SIZE_CLASSES_PER_POWER_OF_TWO < size_class);
+        }
+        if (size_class == previous_size_class) {
+            continue;
+        }
+
+        // Every size class has the next slot of the table
+        uint32_t const index = _get_size_class_index(size_class);
+
+        assert(index < SHIM_SIZE_CLASS_COUNT);
+        assert(previous_size_class == 0 ? index == 0 : index == previous_index + 1);
+
+        previous_size_class = size_class;
+        previous_index = index;
+    }
+    assert(previous_size_class == SHIM_MAX_SIZE_CLASS);
+    assert(previous_index == SHIM_SIZE_CLASS_COUNT - 1);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_allocation_by_size_class() {
+    size_t const sizes[] = {1, 16, 17, 100, 129, 1000, 4097, SHIM_MAX_SIZE_CLASS, SHIM_MAX_SIZE_CLASS + 1, 1 << 20};
+
+    for (size_t i = 0; i < sizeof sizes / sizeof sizes[0]; i++) {
+        uint8_t *data = malloc(sizes[i]);
+
+        assert(data != NULL);
+        assert((uintptr_t)data % DATA_BLOCK_ALIGNMENT == 0);
+        assert(malloc_usable_size(data) >= sizes[i]);
+
+        data[sizes[i] - 1] = 1;
+        free(data);
+    }
+
+    u64 *zeroed = calloc(100, sizeof(u64));
+
+    assert(zeroed != NULL && zeroed[0] == 0 && zeroed[99] == 0);
+    free(zeroed);
+
+    errno = 0;
+    assert(calloc(SIZE_MAX, 2) == NULL && errno == ENOMEM);
+
+    errno = 0;
+    assert(malloc((size_t)MAX_SINGLE_PAGE_SIZE_BYTES + 1) == NULL && errno == ENOMEM);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_realloc() {
+    uint8_t *data = malloc(20);
+    assert(data != NULL);
+
+    size_t const usable_size = malloc_usable_size(data);
+
+    for (size_t i = 0; i < usable_size; i++) data[i] = (uint8_t)i;
+
+    // Growing within the size class keeps the data block
+    uintptr_t const address = (uintptr_t)data;
+
+    data = realloc(data, usable_size);
+    assert((uintptr_t)data == address);
+
+    data = realloc(data, 1);
+    assert((uintptr_t)data == address);
+
+    // Growing past it moves the data
+    uint8_t *grown = realloc(data, usable_size + 1);
+
+    assert(grown != NULL && (uintptr_t)grown != address);
+    assert(malloc_usable_size(grown) > usable_size);
+
+    for (size_t i = 0; i < usable_size; i++) assert(grown[i] == (uint8_t)i);
+
+    // Large requests grow in their shared heap as well
+    uint8_t *large = realloc(grown, 4 * SHIM_MAX_SIZE_CLASS);
+
+    assert(large != NULL && large[usable_size - 1] == (uint8_t)(usable_size - 1));
+
+    errno = 0;
+    assert(realloc(large, (size_t)MAX_SINGLE_PAGE_SIZE_BYTES + 1) == NULL && errno == ENOMEM);
+
+    // Failed realloc leaves the old data block live
+    assert(large[0] == 0);
+
+    // Null pointer allocates and zero size frees
+    uint8_t *fresh = realloc(NULL, 10);
+    assert(fresh != NULL);
+
+    assert(realloc(fresh, 0) == NULL);
+    free(large);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_aligned_allocation_errors() {
+    void *data = NULL;
+
+    assert(posix_memalign(&data, 3, 8) == EINVAL);
+    assert(posix_memalign(&data, sizeof(void *) / 2, 8) == EINVAL);
+    assert(posix_memalign(&data, 0, 8) == EINVAL);
+    assert(data == NULL);
+
+    assert(posix_memalign(&data, 64, (size_t)MAX_SINGLE_PAGE_SIZE_BYTES + 1) == ENOMEM);
+    assert(data == NULL);
+
+    assert(posix_memalign(&data, 64, 100) == 0);
+    assert(data != NULL && (uintptr_t)data % 64 == 0);
+    free(data);
+
+    errno = 0;
+    assert(aligned_alloc(3, 8) == NULL && errno == EINVAL);
+
+    errno = 0;
+    assert(aligned_alloc(0, 8) == NULL && errno == EINVAL);
+
+    errno = 0;
+    assert(aligned_alloc(64, (size_t)MAX_SINGLE_PAGE_SIZE_BYTES + 1) == NULL && errno == ENOMEM);
+
+    data = aligned_alloc(4096, 100);
+    assert(data != NULL && (uintptr_t)data % 4096 == 0);
+    free(data);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static test_func shim_tests[] = {
+    {"size_class_rounding", test_size_class_rounding},
+    {"allocation_by_size_class", test_allocation_by_size_class},
+    {"realloc", test_realloc},
+    {"aligned_allocation_errors", test_aligned_allocation_errors},
+    {NULL, NULL},
+};
+
+int main() {
+    printf("\nrunning shim tests...\n");
+
+    for (test_func *test=&shim_tests[0]; test->name; test++)
+    {
+        test->func();
+    }
+
+    printf("\n");
+}
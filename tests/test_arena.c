@@ -0,0 +1,94 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "common.h"
+#include "memtools.h"
+#include "arena.h"
+#include "provider.h"
+
+
+static void test_reservation() {
+    size_t const page_size = _get_provider_page_size();
+    size_t reserved_bytes = 0, committed_bytes = 0;
+
+    assert(!_reserve_arena(page_size - 1, page_size));
+    assert(!_is_arena_reserved());
+
+    // Pages of all later tests are committed from this reservation
+    assert(_reserve_address_space(16384 * page_size + 1));
+    assert(_is_arena_reserved());
+    assert(!_reserve_address_space(16384 * page_size));
+
+    _get_arena_usage(&reserved_bytes, &committed_bytes);
+    assert(reserved_bytes == 16384 * page_size);
+    assert(committed_bytes == 0);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_commit_and_decommit() {
+    size_t const page_size = _get_provider_page_size();
+    size_t reserved_bytes = 0, committed_bytes = 0;
+
+    char *first = _commit_arena_pages(3 * page_size, page_size);
+    assert(first != NULL && _is_arena_address(first));
+    assert(first[0] == 0 && first[3 * page_size - 1] == 0);
+    first[0] = 1;
+
+    char *aligned = _commit_arena_pages(page_size, 16 * page_size);
+    assert(aligned != NULL && (uintptr_t)aligned % (16 * page_size) == 0);
+
+    _get_arena_usage(&reserved_bytes, &committed_bytes);
+    assert(committed_bytes == 4 * page_size);
+
+    // Freed pages are reused and zero-filled again
+    assert(_decommit_arena_pages(first, 3 * page_size));
+
+    char *second = _commit_arena_pages(2 * page_size, page_size);
+    assert(second == first);
+    assert(second[0] == 0);
+
+    // Middle pages of a commit are decommitted alone
+    char *third = _commit_arena_pages(4 * page_size, page_size);
+    assert(third != NULL);
+    assert(_decommit_arena_pages(third + page_size, 2 * page_size));
+    assert(_commit_arena_pages(2 * page_size, page_size) == third + page_size);
+
+    assert(!_is_arena_address(first - 1));
+    assert(!_is_arena_address(&page_size));
+
+    assert(_decommit_arena_pages(second, 2 * page_size));
+    assert(_decommit_arena_pages(third, 4 * page_size));
+    assert(_decommit_arena_pages(aligned, page_size));
+
+    _get_arena_usage(&reserved_bytes, &committed_bytes);
+    assert(committed_bytes == 0);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_exhausted_reservation() {
+    size_t const page_size = _get_provider_page_size();
+
+    assert(_commit_arena_pages(16385 * page_size, page_size) == NULL);
+
+    // Default provider maps pages separately once the reservation is full
+    char *pages = _map_provider_pages(16385 * page_size, page_size, 0);
+    assert(pages != NULL && !_is_arena_address(pages));
+    assert(_unmap_provider_pages(pages, 16385 * page_size));
+
+    pages = _map_provider_pages(8 * page_size, 8 * page_size, PAGE_PROVIDER_POPULATE);
+    assert(pages != NULL && _is_arena_address(pages));
+    assert(_unmap_provider_pages(pages, 8 * page_size));
+
+    PRINT_SUCCESS(__func__);
+}
+
+test_func arena_tests[] = {
+    {"reservation", test_reservation},
+    {"commit_and_decommit", test_commit_and_decommit},
+    {"exhausted_reservation", test_exhausted_reservation},
+    {NULL, NULL},
+};
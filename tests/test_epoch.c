@@ -0,0 +1,156 @@
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "common.h"
+#include "memtools.h"
+#include "epoch.h"
+
+static u64 test_objects[2048];
+static u32 freed_object_count = 0;
+static bool_t is_reader_inside = false;
+static bool_t is_reader_released = false;
+
+static void _free_test_object(void *data) {
+    u64 *object = data;
+
+    // Object is freed only once
+    assert(*object == 0);
+    *object = 1;
+    freed_object_count++;
+}
+
+static void _reset_test_objects() {
+    assert(_reclaim_deferred_frees(true, _free_test_object) == 0);
+
+    for (u32 i = 0; i < 2048; i++) {
+        test_objects[i] = 0;
+    }
+    freed_object_count = 0;
+}
+
+
+static void test_deferred_frees_without_readers() {
+    _reset_test_objects();
+
+    for (u32 i = 0; i < 3; i++) {
+        assert(_defer_free(&test_objects[i], _free_test_object));
+    }
+    assert(_get_deferred_free_count() == 3);
+    assert(freed_object_count == 0);
+
+    // Open batch is freed as soon as it is retired since nobody reads
+    assert(_reclaim_deferred_frees(false, _free_test_object) == 0);
+    assert(_reclaim_deferred_frees(true, _free_test_object) == 3);
+    assert(_get_deferred_free_count() == 0);
+    assert(freed_object_count == 3);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_reader_delays_reclamation() {
+    _reset_test_objects();
+
+    assert(_enter_read_epoch());
+    assert(_enter_read_epoch());
+    assert(_defer_free(&test_objects[0], _free_test_object));
+
+    assert(_reclaim_deferred_frees(true, _free_test_object) == 0);
+
+    // Nested section keeps the epoch of the outermost one
+    _exit_read_epoch();
+    assert(_reclaim_deferred_frees(true, _free_test_object) == 0);
+
+    _exit_read_epoch();
+    assert(_reclaim_deferred_frees(true, _free_test_object) == 1);
+    assert(test_objects[0] == 1);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_reader_entered_after_retirement() {
+    _reset_test_objects();
+
+    assert(_enter_read_epoch());
+    assert(_defer_free(&test_objects[0], _free_test_object));
+    assert(_reclaim_deferred_frees(true, _free_test_object) == 0);
+    _exit_read_epoch();
+
+    // Section entered after the batch was retired cannot have seen its objects
+    assert(_enter_read_epoch());
+    assert(_defer_free(&test_objects[1], _free_test_object));
+    assert(_reclaim_deferred_frees(true, _free_test_object) == 1);
+    assert(test_objects[0] == 1 && test_objects[1] == 0);
+    _exit_read_epoch();
+
+    assert(_reclaim_deferred_frees(true, _free_test_object) == 1);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_full_batch_is_reclaimed() {
+    _reset_test_objects();
+
+    u32 const batch_capacity = (_get_system_page_size() - sizeof(epoch_batch_t)) / sizeof(void *);
+    assert(batch_capacity < 2048);
+
+    for (u32 i = 0; i < batch_capacity; i++) {
+        assert(_defer_free(&test_objects[i], _free_test_object));
+    }
+    // Full batch retires itself and is reclaimed by the deferring call
+    assert(freed_object_count == batch_capacity);
+    assert(_get_deferred_free_count() == 0);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void* _read_in_section(void *arg) {
+    (void)arg;
+
+    assert(_enter_read_epoch());
+    __atomic_store_n(&is_reader_inside, true, __ATOMIC_RELEASE);
+
+    while (!__atomic_load_n(&is_reader_released, __ATOMIC_ACQUIRE)) {
+        usleep(100);
+    }
+    _exit_read_epoch();
+
+    // Thread leaves while inside another section, its reader is released at exit
+    assert(_enter_read_epoch());
+    return NULL;
+}
+
+static void test_reader_of_another_thread() {
+    _reset_test_objects();
+
+    pthread_t reader_thread;
+    assert(pthread_create(&reader_thread, NULL, _read_in_section, NULL) == 0);
+
+    while (!__atomic_load_n(&is_reader_inside, __ATOMIC_ACQUIRE)) {
+        usleep(100);
+    }
+
+    assert(_defer_free(&test_objects[0], _free_test_object));
+    assert(_reclaim_deferred_frees(true, _free_test_object) == 0);
+
+    __atomic_store_n(&is_reader_released, true, __ATOMIC_RELEASE);
+    assert(pthread_join(reader_thread, NULL) == 0);
+
+    assert(_reclaim_deferred_frees(true, _free_test_object) == 1);
+    assert(test_objects[0] == 1);
+
+    PRINT_SUCCESS(__func__);
+}
+
+test_func epoch_tests[] = {
+    {"deferred_frees_without_readers", test_deferred_frees_without_readers},
+    {"reader_delays_reclamation", test_reader_delays_reclamation},
+    {"reader_entered_after_retirement", test_reader_entered_after_retirement},
+    {"full_batch_is_reclaimed", test_full_batch_is_reclaimed},
+    {"reader_of_another_thread", test_reader_of_another_thread},
+    {NULL, NULL},
+};
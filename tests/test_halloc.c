@@ -1,10 +1,18 @@
+#define _DEFAULT_SOURCE
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
 
 #include "common.h"
 #include "dll.h"
 #include "memtools.h"
+#include "slab.h"
+#include "provider.h"
+#include "arena.h"
 #include "halloc.h"
 
 typedef struct {
@@ -248,6 +256,1150 @@ static void test_readme_example_allocation() {
     PRINT_SUCCESS(__func__);
 }
 
+static void test_trimming_after_free() {
+    u32 const alloc_count = 100000;
+
+    product *large = halloc(product, alloc_count);
+    assert(large != NULL);
+    large[alloc_count - 1].year = 2024;
+
+    product *small = halloc(product, 1);
+    assert(small != NULL);
+
+    hfree(large);
+    // Hfree has already released the pages automatically, explicit trim can still be called
+    halloc_trim();
+
+    large = halloc(product, alloc_count);
+    assert(large != NULL);
+    assert(large[alloc_count - 1].year == 0);
+
+    hfree(small);
+    hfree(large);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_allocation_filling_single_page() {
+    // Data block and vm page header together need more than one system page
+    u32 const alloc_count = 4090;
+
+    char *ptr = halloc(char, alloc_count);
+    assert(ptr != NULL);
+    assert(ptr[alloc_count - 1] == 0);
+
+    hfree(ptr);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_reservation_for_type() {
+    typedef struct {
+        u32 id;
+        double value;
+    } reservedType;
+
+    u32 const alloc_count = 500;
+
+    assert(halloc_reserve(reservedType, alloc_count, HALLOC_RESERVE_POPULATE) == 1);
+    assert(halloc_reserve(reservedType, 1, HALLOC_RESERVE_POPULATE | HALLOC_RESERVE_LOCK) == 1);
+    assert(halloc_reserve(reservedType, 0, 0) == 0);
+
+    reservedType *ptr = halloc(reservedType, alloc_count);
+    assert(ptr != NULL);
+    assert(ptr[alloc_count - 1].value == 0.0);
+
+    hfree(ptr);
+
+    ptr = halloc(reservedType, 1);
+    assert(ptr != NULL);
+    ptr->id = 1;
+
+    halloc_release_reservation(reservedType);
+    hfree(ptr);
+
+    typedef struct {
+        u64 key;
+        u64 value;
+        u64 next;
+    } reservedRecord;
+
+    reservedRecord *records[1000];
+    halloc_mapping_stats_t stats;
+
+    // Reserved capacity holds the meta blocks of single allocations as well
+    assert(halloc_reserve(reservedRecord, 1000, 0) == 1);
+    assert(halloc_get_mapping_stats(reservedRecord, &stats) == 1);
+    u64 const map_count = stats.map_count;
+
+    for (u32 i = 0; i < 1000; i++) {
+        records[i] = halloc(reservedRecord, 1);
+        assert(records[i] != NULL);
+    }
+    assert(halloc_get_mapping_stats(reservedRecord, &stats) == 1);
+    assert(stats.map_count == map_count);
+
+    for (u32 i = 0; i < 1000; i++) {
+        hfree(records[i]);
+    }
+    halloc_release_reservation(reservedRecord);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_allocation_with_heaps_keyed_by_size() {
+    typedef struct {
+        i32 x;
+        i32 y;
+    } pointI32;
+
+    halloc_set_heap_key(HALLOC_HEAP_KEY_SIZE);
+
+    u64 *first = halloc(u64, 1);
+    pointI32 *second = halloc(pointI32, 1);
+    double *third = halloc(double, 3);
+
+    assert(first != NULL && second != NULL && third != NULL);
+
+    meta_block_t *first_meta_block = (meta_block_t *)first - 1;
+    meta_block_t *second_meta_block = (meta_block_t *)second - 1;
+
+    // Types of the same size share vm pages
+    assert(GET_META_PAGE(first_meta_block, first_meta_block->offset) ==
+        GET_META_PAGE(second_meta_block, second_meta_block->offset));
+
+    vm_page_item_t *page_item = _lookup_page_item("pointI32");
+    assert(page_item != NULL);
+    assert(page_item->first_page == NULL);
+    assert(page_item->live_block_count == 1);
+    assert(page_item->live_bytes == sizeof(pointI32));
+
+    page_item = _lookup_page_item("double");
+    assert(page_item != NULL);
+    assert(page_item->live_block_count == 1);
+    assert(page_item->live_bytes == 3 * sizeof(double));
+
+    hfree(second);
+    assert(_lookup_page_item("pointI32")->live_block_count == 0);
+
+    hfree(first);
+    hfree(third);
+
+    halloc_set_heap_key(HALLOC_HEAP_KEY_NAME);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_allocation_in_shared_area() {
+    typedef struct {
+        char name[3];
+    } configA;
+
+    typedef struct {
+        double limit;
+        u32 count;
+    } configB;
+
+    halloc_set_shared_area(512);
+
+    configA *a = halloc(configA, 1);
+    configB *b = halloc(configB, 1);
+
+    assert(a != NULL && b != NULL);
+    assert((uintptr_t)b % _Alignof(configB) == 0);
+
+    meta_block_t *meta_block_a = (meta_block_t *)a - 1;
+    meta_block_t *meta_block_b = (meta_block_t *)b - 1;
+
+    // Both types are packed into the same vm page
+    assert(GET_META_PAGE(meta_block_a, meta_block_a->offset) ==
+        GET_META_PAGE(meta_block_b, meta_block_b->offset));
+    assert(_lookup_page_item("configA")->first_page == NULL);
+    assert(_lookup_page_item("configB")->live_block_count == 1);
+
+    // Exceeding the threshold promotes the type to a heap of its own
+    configB *many_b = halloc(configB, 100);
+    assert(many_b != NULL);
+    assert(_lookup_page_item("configB")->first_page != NULL);
+
+    hfree(a);
+    hfree(b);
+    hfree(many_b);
+
+    halloc_set_shared_area(0);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_allocation_with_out_of_band_layout() {
+    typedef struct {
+        u32 x;
+        u32 y;
+        u32 z;
+    } voxel;
+
+    assert(halloc_set_layout(voxel, HALLOC_LAYOUT_OUT_OF_BAND) == 1);
+
+    u32 const count = 100;
+    voxel *voxels[100];
+
+    for (u32 i = 0; i < count; i++) {
+        voxels[i] = halloc(voxel, 1);
+        assert(voxels[i] != NULL);
+        voxels[i]->x = i;
+    }
+
+    // Consecutive single allocations are adjacent without any meta data in between
+    for (u32 i = 1; i < count; i++) {
+        assert(voxels[i] == voxels[0] + i);
+        assert(voxels[i - 1]->x == i - 1);
+    }
+
+    // Allocation of several units is a data block as before
+    voxel *row = halloc(voxel, 4);
+    assert(row != NULL);
+    assert(!_is_slab_slot(row));
+
+    vm_page_item_t *page_item = _lookup_page_item("voxel");
+    assert(page_item != NULL);
+    assert(page_item->live_block_count == count + 1);
+    assert(page_item->live_bytes == (count + 4) * sizeof(voxel));
+
+    hfree(row);
+
+    for (u32 i = 0; i < count; i++) {
+        hfree(voxels[i]);
+    }
+
+    assert(page_item->first_slab_page == NULL);
+    assert(page_item->live_block_count == 0);
+
+    // Fresh slot is zeroed as any other allocation
+    voxel *first = halloc(voxel, 1);
+    assert(first != NULL && first->x == 0);
+    hfree(first);
+
+    assert(halloc_set_layout(voxel, HALLOC_LAYOUT_INLINE) == 1);
+
+    voxel *inline_voxel = halloc(voxel, 1);
+    assert(inline_voxel != NULL && !_is_slab_slot(inline_voxel));
+    hfree(inline_voxel);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_allocation_with_numa_policy() {
+    typedef struct {
+        double values[32];
+    } sample;
+
+    assert(halloc_set_numa_policy(sample, HALLOC_NUMA_LOCAL + 1, 0) == 0);
+    assert(halloc_set_numa_policy(sample, HALLOC_NUMA_BIND, -1) == 0);
+    assert(halloc_set_numa_policy(sample, HALLOC_NUMA_INTERLEAVE, 0) == 1);
+
+    vm_page_item_t *page_item = _lookup_page_item("sample");
+    assert(page_item != NULL);
+    assert(page_item->numa_policy == HALLOC_NUMA_INTERLEAVE);
+    assert(page_item->item_flags & PAGE_ITEM_PROMOTED);
+
+    sample *samples = halloc(sample, 100);
+    assert(samples != NULL);
+    samples[99].values[31] = 1.0;
+
+    assert(halloc_set_thread_numa_policy(HALLOC_NUMA_LOCAL, 0) == 1);
+
+    double *values = halloc(double, 10);
+    assert(values != NULL);
+
+    hfree(values);
+    hfree(samples);
+
+    assert(halloc_set_thread_numa_policy(HALLOC_NUMA_DEFAULT, 0) == 1);
+    assert(halloc_set_numa_policy(sample, HALLOC_NUMA_DEFAULT, 0) == 1);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_allocation_in_file_heap() {
+    typedef struct list_node_ {
+        struct list_node_ *next;
+        u32 value;
+    } list_node;
+
+    char path[] = "/tmp/halloc_file_heap_XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    close(fd);
+
+    list_node *outside_node = halloc(list_node, 1);
+    assert(outside_node != NULL);
+
+    assert(halloc_open_file_heap(path, 8UL << 20) == 1);
+    assert(halloc_get_heap_root() == NULL);
+
+    list_node *head = NULL;
+
+    for (u32 i = 0; i < 100; i++) {
+        list_node *node = halloc(list_node, 1);
+        assert(node != NULL);
+        node->value = i;
+        node->next = head;
+        head = node;
+    }
+    halloc_set_heap_root(head);
+
+    // Memory allocated before opening the file heap can still be freed
+    hfree(outside_node);
+
+    assert(halloc_close_file_heap() == 1);
+    assert(halloc_close_file_heap() == 0);
+
+    assert(halloc_open_file_heap(path, 0) == 1);
+
+    head = halloc_get_heap_root();
+    u32 expected_value = 100;
+
+    for (list_node *node = head; node != NULL; node = node->next) {
+        assert(node->value == --expected_value);
+    }
+    assert(expected_value == 0);
+    assert(_lookup_page_item("list_node")->live_block_count == 100);
+
+    while (head != NULL) {
+        list_node *next = head->next;
+        hfree(head);
+        head = next;
+    }
+    assert(_lookup_page_item("list_node")->live_block_count == 0);
+
+    assert(halloc_close_file_heap() == 1);
+    unlink(path);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_allocation_in_shared_heap_by_forked_processes() {
+    typedef struct {
+        u64 key;
+        u64 value;
+    } record;
+
+    u32 const worker_count = 3;
+    u32 const rounds = 300;
+
+    assert(halloc_open_shared_heap(NULL, 16UL << 20) == 1);
+
+    u64 *worker_sums = halloc(u64, worker_count);
+    assert(worker_sums != NULL);
+    halloc_set_heap_root(worker_sums);
+
+    for (u32 worker = 0; worker < worker_count; worker++) {
+        pid_t pid = fork();
+        assert(pid != -1);
+
+        if (pid == 0) {
+            u64 *sums = halloc_get_heap_root();
+            record *kept = NULL;
+
+            // Workers allocate and free concurrently, one record of each stays allocated
+            for (u32 i = 0; i < rounds; i++) {
+                record *r = halloc(record, 1 + i % 4);
+                if (r == NULL) _exit(1);
+
+                r->key = worker;
+                r->value = i;
+                sums[worker] += r->value;
+
+                if (kept == NULL) {
+                    kept = r;
+                } else {
+                    hfree(r);
+                }
+            }
+            _exit(kept->key == worker ? 0 : 2);
+        }
+    }
+
+    for (u32 worker = 0; worker < worker_count; worker++) {
+        int status = 0;
+        wait(&status);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    u64 const expected_sum = (u64)rounds * (rounds - 1) / 2;
+
+    for (u32 worker = 0; worker < worker_count; worker++) {
+        assert(worker_sums[worker] == expected_sum);
+    }
+
+    vm_page_item_t *page_item = _lookup_page_item("record");
+    assert(page_item != NULL);
+    assert(page_item->live_block_count == worker_count);
+    assert(page_item->alloc_count == worker_count * rounds);
+
+    hfree(worker_sums);
+    assert(halloc_close_shared_heap() == 1);
+    assert(halloc_close_shared_heap() == 0);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_aligned_allocation() {
+    size_t const alignments[] = {16, 64, 4096};
+
+    for (u32 i = 0; i < sizeof(alignments) / sizeof(alignments[0]); i++) {
+        double *ptr = halloc_aligned(double, 100, alignments[i]);
+        assert(ptr != NULL);
+        assert((uintptr_t)ptr % alignments[i] == 0);
+        assert(ptr[0] == 0 && ptr[99] == 0);
+
+        meta_block_t *meta_block = (meta_block_t *)ptr - 1;
+
+        if (alignments[i] > DATA_BLOCK_ALIGNMENT) {
+            // Alias leads back to the data block, which holds all units after the aligned address
+            assert(meta_block->is_alias);
+            meta_block = GET_ALIASED_META_BLOCK(meta_block);
+            assert(!meta_block->is_alias && !meta_block->is_free);
+            assert((char *)(meta_block + 1) + meta_block->block_size >= (char *)(ptr + 100));
+        } else {
+            assert(!meta_block->is_alias);
+        }
+        ptr[99] = 1.0;
+        hfree(ptr);
+    }
+
+    assert(halloc_aligned(double, 1, 48) == NULL);
+    assert(_lookup_page_item("double")->live_block_count == 0);
+
+    PRINT_SUCCESS(__func__);
+}
+
+typedef u64 thread_record;
+
+static void* _allocate_and_free_records(void *arg) {
+    u32 const thread_index = *(u32 *)arg;
+    thread_record *kept[64];
+
+    for (u32 round = 0; round < 200; round++) {
+        for (u32 i = 0; i < 64; i++) {
+            kept[i] = halloc(thread_record, 1 + (round + i) % 8);
+            if (kept[i] == NULL) return arg;
+            kept[i][0] = thread_index;
+        }
+        for (u32 i = 0; i < 64; i++) {
+            if (kept[i][0] != thread_index) return arg;
+            hfree(kept[i]);
+        }
+    }
+    return NULL;
+}
+
+static void test_allocation_by_threads_with_thread_safety() {
+    u32 const thread_count = 4;
+    pthread_t threads[4];
+    u32 thread_indices[4];
+
+    halloc_set_thread_safety(1);
+
+    for (u32 i = 0; i < thread_count; i++) {
+        thread_indices[i] = i;
+        assert(pthread_create(&threads[i], NULL, _allocate_and_free_records, &thread_indices[i]) == 0);
+    }
+    for (u32 i = 0; i < thread_count; i++) {
+        void *result = NULL;
+        assert(pthread_join(threads[i], &result) == 0);
+        assert(result == NULL);
+    }
+
+    vm_page_item_t *page_item = _lookup_page_item("thread_record");
+    assert(page_item != NULL);
+    assert(page_item->live_block_count == 0);
+    assert(page_item->alloc_count == thread_count * 200 * 64);
+
+    halloc_set_thread_safety(0);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_site_usage() {
+    halloc_site_usage_t usage;
+
+    u32 const line = __LINE__ + 1;
+    double *first = halloc(double, 8);
+    u32 *second = halloc(u32, 1);
+
+    assert(first != NULL && second != NULL);
+
+#ifdef HALLOC_SITE_STATS
+    assert(halloc_get_site_usage(__FILE__, line, &usage) == 1);
+    assert(usage.live_bytes == 8 * sizeof(double) && usage.live_objects == 1);
+    assert(usage.alloc_count == 1 && usage.free_count == 0);
+
+    hfree(first);
+
+    assert(halloc_get_site_usage(__FILE__, line, &usage) == 1);
+    assert(usage.live_bytes == 0 && usage.live_objects == 0 && usage.free_count == 1);
+
+    assert(halloc_get_site_usage(__FILE__, line + 1, &usage) == 1);
+    assert(usage.live_objects == 1);
+#else
+    // Call sites are only recorded in the site stats build mode
+    assert(halloc_get_site_usage(__FILE__, line, &usage) == 0);
+    hfree(first);
+#endif
+    hfree(second);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_placement_site_usage() {
+    typedef struct {
+        u64 id;
+        double weight;
+    } siteRecord;
+
+    uint32_t const field_sizes[] = {halloc_field_size(siteRecord, id), halloc_field_size(siteRecord, weight)};
+    halloc_child_t const children[] = {halloc_child(u32, 4)};
+    void *arrays[2];
+    halloc_site_usage_t usage;
+
+    u32 const line = __LINE__ + 1;
+    siteRecord *first = halloc(siteRecord, 1);
+    siteRecord *near = halloc_near(first, siteRecord, 1);
+    siteRecord *aligned = halloc_aligned(siteRecord, 1, 64);
+    siteRecord *short_lived = halloc_with_lifetime(siteRecord, 1, HALLOC_LIFETIME_SHORT);
+    void *fields = halloc_soa(siteRecord, field_sizes, 2, 8, arrays);
+    siteRecord *composite = halloc_composite(siteRecord, children, 1, arrays);
+
+    assert(first != NULL && near != NULL && aligned != NULL);
+    assert(short_lived != NULL && fields != NULL && composite != NULL);
+
+#ifdef HALLOC_SITE_STATS
+    // Each placement macro is accounted to its own line, not to <unknown>
+    for (u32 offset = 1; offset <= 5; offset++) {
+        assert(halloc_get_site_usage(__FILE__, line + offset, &usage) == 1);
+        assert(usage.live_objects == 1 && usage.alloc_count == 1);
+    }
+#else
+    assert(halloc_get_site_usage(__FILE__, line + 1, &usage) == 0);
+#endif
+    hfree(first);
+    hfree(near);
+    hfree(aligned);
+    hfree(short_lived);
+    hfree(fields);
+    hfree(composite);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_lifetime_histogram() {
+    typedef struct {
+        u64 key;
+        u64 value;
+    } lifetime_record;
+
+    u64 counts[HALLOC_LIFETIME_BUCKETS];
+
+    assert(halloc_set_lifetime_clock(HALLOC_LIFETIME_CLOCK_ALLOCATIONS) == 1);
+
+    lifetime_record *short_lived = halloc(lifetime_record, 1);
+    hfree(short_lived);
+
+    // Hundred allocations in between put the lifetime into the bucket of 64 to 127
+    lifetime_record *long_lived = halloc(lifetime_record, 1);
+
+    for (u32 i = 0; i < 100; i++) {
+        hfree(halloc(u32, 1));
+    }
+    hfree(long_lived);
+
+#ifdef HALLOC_LIFETIME_STATS
+    assert(halloc_get_lifetime_histogram(lifetime_record, counts) == 1);
+    assert(counts[0] == 1 && counts[7] == 1);
+#else
+    assert(halloc_get_lifetime_histogram(lifetime_record, counts) == 0);
+#endif
+
+    assert(halloc_set_lifetime_clock(-1) == 0);
+    assert(halloc_set_lifetime_clock(HALLOC_LIFETIME_CLOCK_TIME) == 1);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static u32 provider_map_count = 0;
+static u32 provider_unmap_count = 0;
+
+static void* _map_test_pages(void *context, size_t length, size_t alignment, int flags) {
+    halloc_page_provider_t const *fallback = context;
+
+    provider_map_count++;
+    return fallback->map(fallback->context, length, alignment, flags);
+}
+
+static int _unmap_test_pages(void *context, void *addr, size_t length) {
+    halloc_page_provider_t const *fallback = context;
+
+    provider_unmap_count++;
+    return fallback->unmap(fallback->context, addr, length);
+}
+
+static int _advise_test_pages(void *context, void *addr, size_t length, int advice) {
+    halloc_page_provider_t const *fallback = context;
+    return fallback->advise(fallback->context, addr, length, advice);
+}
+
+static size_t _get_test_page_size(void *context) {
+    (void)context;
+    return sysconf(_SC_PAGESIZE);
+}
+
+static void test_allocation_with_page_provider() {
+    typedef struct {
+        char payload[100000];
+    } provided_record;
+
+    // Default provider is wrapped, so that pages mapped before the swap can be unmapped
+    static halloc_page_provider_t fallback;
+    page_provider_t const *default_provider = _get_page_provider();
+
+    fallback.map = default_provider->map;
+    fallback.unmap = default_provider->unmap;
+    fallback.advise = default_provider->advise;
+    fallback.get_page_size = default_provider->get_page_size;
+    fallback.context = default_provider->context;
+
+    halloc_page_provider_t const provider = {
+        _map_test_pages, _unmap_test_pages, _advise_test_pages, _get_test_page_size, &fallback
+    };
+    assert(halloc_set_page_provider(&provider) == 1);
+
+    provided_record *record = halloc(provided_record, 4);
+    assert(record != NULL);
+    assert(provider_map_count > 0);
+
+    record[3].payload[0] = 1;
+    hfree(record);
+    halloc_trim();
+    assert(provider_unmap_count > 0);
+
+    assert(halloc_set_page_provider(NULL) == 1);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_allocation_in_reserved_address_space() {
+    typedef struct {
+        u64 values[600];
+    } reserved_record;
+
+    // Address space was reserved by the arena tests
+    assert(halloc_reserve_address_space((size_t)1 << 30) == 0);
+
+    reserved_record *first = halloc(reserved_record, 8);
+    reserved_record *second = halloc(reserved_record, 200);
+    assert(first != NULL && second != NULL);
+    assert(_is_arena_address(first) && _is_arena_address(second));
+
+    second[199].values[599] = 1;
+    hfree(first);
+    hfree(second);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_usable_size_and_ownership() {
+    typedef struct {
+        u32 x;
+        u32 y;
+        u32 z;
+    } usable_point;
+
+    typedef struct {
+        u64 key;
+        u32 flags;
+    } usable_slot;
+
+    // Twelve bytes are padded to the alignment of data blocks
+    usable_point *points = halloc(usable_point, 1);
+    assert(points != NULL);
+    assert(halloc_usable_size(points) == DATA_BLOCK_ALIGNMENT);
+    assert(halloc_owns(points) == 1);
+
+    usable_point *aligned = halloc_aligned(usable_point, 10, 256);
+    assert(aligned != NULL);
+    assert(halloc_usable_size(aligned) >= 10 * sizeof(usable_point));
+    assert(halloc_owns(aligned) == 1);
+
+    // Slots of out-of-band layout are as large as the type
+    assert(halloc_set_layout(usable_slot, HALLOC_LAYOUT_OUT_OF_BAND) == 1);
+    usable_slot *slot = halloc(usable_slot, 1);
+    assert(slot != NULL);
+    assert(halloc_usable_size(slot) == sizeof(usable_slot));
+    assert(halloc_owns(slot) == 1);
+
+    u32 on_stack = 0;
+    u32 *on_malloc_heap = malloc(sizeof(u32));
+
+    assert(halloc_owns(&on_stack) == 0);
+    assert(halloc_owns(on_malloc_heap) == 0);
+    assert(halloc_owns(NULL) == 0);
+    assert(halloc_usable_size(NULL) == 0);
+
+    free(on_malloc_heap);
+    hfree(points);
+    hfree(aligned);
+    hfree(slot);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_handles_with_compaction() {
+    typedef struct {
+        u64 key;
+        char payload[500];
+    } movable_record;
+
+    u32 const record_count = 200;
+    halloc_handle_t handles[200];
+
+    for (u32 i = 0; i < record_count; i++) {
+        handles[i] = halloc_handle(movable_record, 1);
+        assert(handles[i] != HALLOC_NULL_HANDLE);
+
+        movable_record *record = halloc_pin(handles[i]);
+        assert(record != NULL && record->key == 0);
+        record->key = i;
+        halloc_unpin(handles[i]);
+    }
+
+    // Three of every four records are freed, such that pages are sparse
+    for (u32 i = 0; i < record_count; i++) {
+        if (i % 4 != 0) hfree_handle(handles[i]);
+    }
+    assert(halloc_pin(handles[1]) == NULL);
+
+    assert(halloc_compact(movable_record, 1 << 20) > 0);
+
+    for (u32 i = 0; i < record_count; i += 4) {
+        movable_record *record = halloc_pin(handles[i]);
+        assert(record != NULL && record->key == i);
+        halloc_unpin(handles[i]);
+        hfree_handle(handles[i]);
+    }
+    assert(halloc_compact(movable_record, 1 << 20) == 0);
+    assert(halloc_compact(unknown_movable_record, 1 << 20) == 0);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_allocation_with_refill_thread() {
+    typedef struct {
+        u64 key;
+        u64 values[63];
+    } refilled_record;
+
+    size_t const refill_bytes = 32 * sizeof(refilled_record);
+
+    assert(halloc_set_refill(refilled_record, (size_t)1 << 40) == 0);
+    assert(halloc_set_refill(refilled_record, refill_bytes) == 1);
+    assert(halloc_start_refill_thread(100) == 1);
+
+    vm_page_item_t *page_item = _get_heap_page_item(_lookup_page_item("refilled_record"));
+    assert(page_item != NULL);
+
+    // Thread maps the first page of the type before anything is allocated
+    for (u32 i = 0; i < 1000 && page_item->first_page == NULL; i++) {
+        usleep(1000);
+    }
+    assert(page_item->first_page != NULL);
+
+    refilled_record *records[64];
+
+    for (u32 i = 0; i < 64; i++) {
+        records[i] = halloc(refilled_record, 1);
+        assert(records[i] != NULL);
+        records[i]->key = i;
+    }
+    for (u32 i = 0; i < 64; i++) {
+        assert(records[i]->key == i);
+        hfree(records[i]);
+    }
+
+    halloc_stop_refill_thread();
+    assert(halloc_set_refill(refilled_record, 0) == 1);
+    halloc_set_thread_safety(0);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_mapping_stats() {
+    typedef struct {
+        u64 key;
+        char payload[248];
+    } mapped_record;
+
+    halloc_mapping_stats_t type_stats, total_stats_before, total_stats_after;
+
+    assert(halloc_get_mapping_stats(mapped_record, &type_stats) == 0);
+    assert(halloc_get_total_mapping_stats(&total_stats_before) == 1);
+
+    u32 const record_count = 4096;
+    mapped_record *records = halloc(mapped_record, record_count);
+    assert(records != NULL);
+
+    // Touching every page of the records faults them in
+    for (u32 i = 0; i < record_count; i++) {
+        records[i].key = i;
+    }
+
+    assert(halloc_get_mapping_stats(mapped_record, &type_stats) == 1);
+    assert(type_stats.map_count >= 1);
+    assert(type_stats.mapped_bytes >= record_count * sizeof(mapped_record));
+    // Faults of a type are only sampled on request
+    assert(type_stats.minor_faults == 0);
+
+    hfree(records);
+
+    halloc_set_fault_sampling(1);
+    records = halloc(mapped_record, record_count);
+    assert(records != NULL);
+    halloc_set_fault_sampling(0);
+
+    // Zeroing of the fresh pages of the records faulted them in
+    assert(halloc_get_mapping_stats(mapped_record, &type_stats) == 1);
+    assert(type_stats.minor_faults + type_stats.major_faults > 0);
+
+    hfree(records);
+
+    assert(halloc_get_mapping_stats(mapped_record, &type_stats) == 1);
+    assert(type_stats.unmap_count + type_stats.release_count >= 1);
+
+    assert(halloc_get_total_mapping_stats(&total_stats_after) == 1);
+    assert(total_stats_after.map_count >= total_stats_before.map_count + type_stats.map_count);
+    assert(total_stats_after.mapped_bytes >= total_stats_before.mapped_bytes + type_stats.mapped_bytes);
+    assert(total_stats_after.minor_faults > total_stats_before.minor_faults);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_allocation_near_hint() {
+    typedef struct {
+        u64 key;
+        void *left;
+        void *right;
+    } near_node;
+
+    u32 const node_count = 8;
+    near_node *nodes[8];
+
+    for (u32 i = 0; i < node_count; i++) {
+        nodes[i] = halloc(near_node, 1);
+        assert(nodes[i] != NULL);
+        nodes[i]->key = i;
+    }
+
+    // Hole left by the freed node is closer to the hint than the rest of the vm page
+    near_node *hole = nodes[3];
+    hfree(nodes[3]);
+
+    nodes[3] = halloc_near(nodes[4], near_node, 1);
+    assert(nodes[3] == hole);
+    assert(nodes[3]->key == 0 && nodes[3]->left == NULL);
+
+    // Other hints, or none, fall back to the placement of halloc
+    product *other = halloc(product, 1);
+    u64 local = 0;
+
+    near_node *placed_nodes[3] = {
+        halloc_near(other, near_node, 1),
+        halloc_near(&local, near_node, 1),
+        halloc_near(NULL, near_node, 1),
+    };
+
+    for (u32 i = 0; i < 3; i++) {
+        assert(placed_nodes[i] != NULL);
+        hfree(placed_nodes[i]);
+    }
+    hfree(other);
+
+    for (u32 i = 0; i < node_count; i++) {
+        hfree(nodes[i]);
+    }
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_struct_of_arrays_allocation() {
+    typedef struct {
+        float x;
+        float y;
+        double mass;
+        uint8_t flags;
+    } particle;
+
+    u32 const field_sizes[] = {
+        halloc_field_size(particle, x),
+        halloc_field_size(particle, y),
+        halloc_field_size(particle, mass),
+        halloc_field_size(particle, flags),
+    };
+    size_t const field_count = 4, particle_count = 1000;
+    void *field_arrays[4];
+
+    void *particles = halloc_soa(particle, field_sizes, field_count, particle_count, field_arrays);
+    assert(particles != NULL);
+    assert(particles == field_arrays[0]);
+
+    for (size_t i = 0; i < field_count; i++) {
+        assert((uintptr_t)field_arrays[i] % 64 == 0);
+
+        if (i + 1 < field_count) {
+            assert((char *)field_arrays[i] + field_sizes[i] * particle_count <= (char *)field_arrays[i + 1]);
+        }
+    }
+    char *const arrays_end = (char *)field_arrays[3] + field_sizes[3] * particle_count;
+    assert(halloc_usable_size(particles) >= (size_t)(arrays_end - (char *)particles));
+
+    float *x = field_arrays[0];
+    double *mass = field_arrays[2];
+    uint8_t *flags = field_arrays[3];
+
+    for (size_t i = 0; i < particle_count; i++) {
+        assert(x[i] == 0.0f && mass[i] == 0.0 && flags[i] == 0);
+        x[i] = i;
+        mass[i] = 2.0 * i;
+        flags[i] = 1;
+    }
+    assert(x[particle_count - 1] * 2.0 == mass[particle_count - 1]);
+
+    hfree(particles);
+
+    u32 const invalid_field_sizes[] = {4, 0};
+    assert(halloc_soa(particle, field_sizes, 0, particle_count, field_arrays) == NULL);
+    assert(halloc_soa(particle, invalid_field_sizes, 2, particle_count, field_arrays) == NULL);
+
+    // Padded struct allocated as fields first is still allocated whole by halloc
+    typedef struct {
+        char tag;
+        double weight;
+    } padded_particle;
+
+    u32 const padded_field_sizes[] = {
+        halloc_field_size(padded_particle, tag),
+        halloc_field_size(padded_particle, weight),
+    };
+    void *padded_particles = halloc_soa(padded_particle, padded_field_sizes, 2, particle_count, field_arrays);
+    assert(padded_particles != NULL);
+
+    padded_particle *array = halloc(padded_particle, 5);
+    assert(array != NULL);
+    assert(halloc_usable_size(array) >= 5 * sizeof(padded_particle));
+
+    array[4].weight = 1.0;
+
+    hfree(array);
+    hfree(padded_particles);
+
+    PRINT_SUCCESS(__func__);
+}
+
+typedef struct {
+    u64 magic;
+    u64 version;
+} shared_config;
+
+#define SHARED_CONFIG_MAGIC 0x5eed5eed5eed5eedULL
+
+static shared_config *current_config = NULL;
+static bool_t is_config_writer_done = false;
+
+static void* _read_shared_config(void *arg) {
+    u64 *read_count = arg;
+
+    while (!__atomic_load_n(&is_config_writer_done, __ATOMIC_ACQUIRE)) {
+        assert(halloc_epoch_enter() == 1);
+
+        shared_config *config = __atomic_load_n(&current_config, __ATOMIC_ACQUIRE);
+        // Freed data block would have its free list node written over the fields
+        assert(config->magic == SHARED_CONFIG_MAGIC);
+        *read_count += config->version > 0;
+
+        halloc_epoch_exit();
+    }
+    return NULL;
+}
+
+static void test_deferred_free_with_concurrent_readers() {
+    halloc_set_thread_safety(1);
+
+    shared_config *config = halloc(shared_config, 1);
+    config->magic = SHARED_CONFIG_MAGIC;
+    config->version = 1;
+    current_config = config;
+
+    // Reader keeps using an object that was unlinked while it was inside its section
+    assert(halloc_epoch_enter() == 1);
+    shared_config *read_config = current_config;
+
+    shared_config *next_config = halloc(shared_config, 1);
+    next_config->magic = SHARED_CONFIG_MAGIC;
+    next_config->version = 2;
+    __atomic_store_n(&current_config, next_config, __ATOMIC_RELEASE);
+    hfree_deferred(read_config);
+
+    assert(halloc_reclaim_deferred() == 0);
+    assert(read_config->magic == SHARED_CONFIG_MAGIC && read_config->version == 1);
+
+    halloc_epoch_exit();
+    assert(halloc_reclaim_deferred() == 1);
+
+    pthread_t readers[4];
+    u64 read_counts[4] = {0};
+
+    for (u32 i = 0; i < 4; i++) {
+        assert(pthread_create(&readers[i], NULL, _read_shared_config, &read_counts[i]) == 0);
+    }
+
+    for (u64 version = 3; version < 20000; version++) {
+        shared_config *new_config = halloc(shared_config, 1);
+        new_config->magic = SHARED_CONFIG_MAGIC;
+        new_config->version = version;
+
+        shared_config *old_config = __atomic_exchange_n(&current_config, new_config, __ATOMIC_ACQ_REL);
+        hfree_deferred(old_config);
+    }
+    __atomic_store_n(&is_config_writer_done, true, __ATOMIC_RELEASE);
+
+    for (u32 i = 0; i < 4; i++) {
+        assert(pthread_join(readers[i], NULL) == 0);
+    }
+
+    halloc_reclaim_deferred();
+    hfree(current_config);
+
+    vm_page_item_t *page_item = _lookup_page_item("shared_config");
+    assert(page_item != NULL && page_item->live_block_count == 0);
+
+    halloc_set_thread_safety(0);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_allocation_with_lifetime_hints() {
+    typedef struct {
+        u64 id;
+        char payload[104];
+    } session_record;
+
+    u32 const record_count = 256;
+    session_record *short_records[256], *long_records[256], *permanent_records[256];
+
+    // Records of all three lifetimes are allocated in turns, as by a server handling requests
+    for (u32 i = 0; i < record_count; i++) {
+        short_records[i] = halloc_with_lifetime(session_record, 1, HALLOC_LIFETIME_SHORT);
+        long_records[i] = halloc_with_lifetime(session_record, 1, HALLOC_LIFETIME_LONG);
+        permanent_records[i] = halloc_with_lifetime(session_record, 1, HALLOC_LIFETIME_PERMANENT);
+        assert(short_records[i] != NULL && long_records[i] != NULL && permanent_records[i] != NULL);
+    }
+
+    vm_page_item_t *page_item = _lookup_page_item("session_record");
+    assert(page_item != NULL);
+    assert(page_item->live_block_count == 3 * record_count);
+
+    vm_page_item_t *short_item = page_item->lifetime_class_items[LIFETIME_CLASS_SHORT];
+    vm_page_item_t *permanent_item = page_item->lifetime_class_items[LIFETIME_CLASS_PERMANENT];
+    assert(short_item != NULL && permanent_item != NULL);
+
+    // Permanent records are packed next to each other despite the others allocated in between
+    meta_block_t *meta_block = (meta_block_t *)permanent_records[0] - 1;
+    assert(NEXT_META_BLOCK(meta_block) == (meta_block_t *)permanent_records[1] - 1);
+
+    for (u32 i = 0; i < record_count; i++) {
+        hfree(short_records[i]);
+    }
+
+    // Pages of the short-lived records are unmapped as a whole, the others are left alone
+    assert(short_item->first_page == NULL);
+    assert(page_item->first_page != NULL && permanent_item->first_page != NULL);
+    assert(page_item->live_block_count == 2 * record_count);
+
+    assert(halloc_with_lifetime(session_record, 1, 3) == NULL);
+    assert(halloc_with_lifetime(session_record, 1, -1) == NULL);
+
+    for (u32 i = 0; i < record_count; i++) {
+        hfree(long_records[i]);
+        hfree(permanent_records[i]);
+    }
+    assert(page_item->live_block_count == 0);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_composite_allocation() {
+    typedef struct {
+        _Alignas(64) u64 counters[4];
+    } cache_line;
+
+    halloc_child_t const children[] = {
+        halloc_child(double, 25),
+        halloc_child(char, 3),
+        halloc_child(cache_line, 2),
+    };
+    void *child_arrays[3];
+
+    // Struct of the README example with its data array in the same data block
+    myType *ptr = halloc_composite(myType, children, 1, child_arrays);
+    assert(ptr != NULL);
+
+    ptr->size = 25;
+    ptr->data = child_arrays[0];
+    assert((char *)ptr->data >= (char *)(ptr + 1));
+    assert((uintptr_t)ptr->data % _Alignof(double) == 0);
+    assert(ptr->data[ptr->size - 1] == 0.0);
+
+    ptr->data[ptr->size - 1] = 1.0;
+    assert(halloc_usable_size(ptr) >= sizeof(myType) + 25 * sizeof(double));
+
+    // Single free releases the struct together with its array
+    hfree(ptr);
+
+    ptr = halloc_composite(myType, children, 3, child_arrays);
+    assert(ptr != NULL);
+
+    char *const name = child_arrays[1];
+    cache_line *lines = child_arrays[2];
+
+    assert(name >= (char *)child_arrays[0] + 25 * sizeof(double));
+    assert((char *)lines >= name + 3);
+    assert((uintptr_t)lines % 64 == 0);
+    assert(halloc_usable_size(ptr) >= (size_t)((char *)(lines + 2) - (char *)ptr));
+
+    name[2] = 'x';
+    lines[1].counters[3] = 1;
+    assert(lines[0].counters[0] == 0);
+
+    hfree(ptr);
+
+    // Struct aligned above data blocks keeps its own alignment
+    cache_line *parent = halloc_composite(cache_line, children, 1, child_arrays);
+    assert(parent != NULL);
+    assert((uintptr_t)parent % _Alignof(cache_line) == 0);
+    assert((uintptr_t)child_arrays[0] % _Alignof(double) == 0);
+
+    parent->counters[3] = 1;
+    hfree(parent);
+
+    halloc_child_t const empty_child[] = {halloc_child(double, 0)};
+    halloc_child_t const misaligned_child[] = {{8, 12, 1}};
+
+    assert(halloc_composite(myType, children, 0, child_arrays) == NULL);
+    assert(halloc_composite(myType, empty_child, 1, child_arrays) == NULL);
+    assert(halloc_composite(myType, misaligned_child, 1, child_arrays) == NULL);
+
+    PRINT_SUCCESS(__func__);
+}
+
 test_func halloc_tests[] = {
     {"allocation_primitive_type_small", test_allocation_primitive_type_small},
     {"allocation_primitive_type_large", test_allocation_primitive_type_large},
@@ -263,5 +1415,30 @@ test_func halloc_tests[] = {
     {"allocation_oversize", test_allocation_oversize},
     {"nested_allocation", test_nested_allocation},
     {"readme_example_allocation", test_readme_example_allocation},
+    {"trimming_after_free", test_trimming_after_free},
+    {"allocation_filling_single_page", test_allocation_filling_single_page},
+    {"reservation_for_type", test_reservation_for_type},
+    {"allocation_with_heaps_keyed_by_size", test_allocation_with_heaps_keyed_by_size},
+    {"allocation_in_shared_area", test_allocation_in_shared_area},
+    {"allocation_with_out_of_band_layout", test_allocation_with_out_of_band_layout},
+    {"allocation_with_numa_policy", test_allocation_with_numa_policy},
+    {"allocation_in_file_heap", test_allocation_in_file_heap},
+    {"allocation_in_shared_heap_by_forked_processes", test_allocation_in_shared_heap_by_forked_processes},
+    {"aligned_allocation", test_aligned_allocation},
+    {"allocation_by_threads_with_thread_safety", test_allocation_by_threads_with_thread_safety},
+    {"site_usage", test_site_usage},
+    {"placement_site_usage", test_placement_site_usage},
+    {"lifetime_histogram", test_lifetime_histogram},
+    {"allocation_with_page_provider", test_allocation_with_page_provider},
+    {"allocation_in_reserved_address_space", test_allocation_in_reserved_address_space},
+    {"usable_size_and_ownership", test_usable_size_and_ownership},
+    {"handles_with_compaction", test_handles_with_compaction},
+    {"allocation_with_refill_thread", test_allocation_with_refill_thread},
+    {"mapping_stats", test_mapping_stats},
+    {"allocation_near_hint", test_allocation_near_hint},
+    {"struct_of_arrays_allocation", test_struct_of_arrays_allocation},
+    {"deferred_free_with_concurrent_readers", test_deferred_free_with_concurrent_readers},
+    {"allocation_with_lifetime_hints", test_allocation_with_lifetime_hints},
+    {"composite_allocation", test_composite_allocation},
     {NULL, NULL},
 };
@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include "common.h"
+#include "memtools.h"
+#include "handle.h"
+
+typedef struct {
+    u64 key;
+    char payload[200];
+} test_handle_record;
+
+
+static void test_handle_registration() {
+    char block[HANDLE_HEADER_SIZE + 32];
+    void *first_data = block + HANDLE_HEADER_SIZE;
+
+    u64 const first = _register_handle(first_data);
+    assert(first != NULL_HANDLE);
+    assert(*(u64 *)block == GET_HANDLE_INDEX(first));
+
+    handle_entry_t *entry = _lookup_handle(first);
+    assert(entry != NULL && entry->data == first_data && entry->pin_count == 0);
+
+    // Entry is reused by the next handle, the stale handle is not resolved anymore
+    _unregister_handle(entry);
+    assert(_lookup_handle(first) == NULL);
+
+    u64 const second = _register_handle(first_data);
+    assert(GET_HANDLE_INDEX(second) == GET_HANDLE_INDEX(first));
+    assert(GET_HANDLE_GENERATION(second) == GET_HANDLE_GENERATION(first) + 1);
+    assert(_lookup_handle(second) == entry);
+    assert(_lookup_handle(first) == NULL);
+
+    assert(_lookup_handle(NULL_HANDLE) == NULL);
+    assert(_lookup_handle(((u64)1 << 32) | (HANDLE_TABLE_SIZE - 1)) == NULL);
+
+    _unregister_handle(entry);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_compaction_of_sparse_pages() {
+    _register_page_item("test_handle_record", sizeof(test_handle_record));
+
+    vm_page_item_t *vm_page_item = _lookup_page_item("test_handle_record");
+    vm_page_item_t *handle_item = _get_handle_page_item(vm_page_item);
+    assert(handle_item != NULL && (handle_item->item_flags & PAGE_ITEM_HANDLES));
+    assert(_get_handle_page_item(vm_page_item) == handle_item);
+
+    u32 const alloc_size = HANDLE_HEADER_SIZE + sizeof(test_handle_record);
+    u32 const record_count = 64;
+    u64 handles[64];
+
+    for (u32 i = 0; i < record_count; i++) {
+        meta_block_t *meta_block = _allocate_free_data_block(handle_item, alloc_size);
+        assert(meta_block != NULL);
+
+        test_handle_record *record = (test_handle_record *)((char *)(meta_block + 1) + HANDLE_HEADER_SIZE);
+        record->key = i;
+        handles[i] = _register_handle(record);
+    }
+
+    u32 page_count = 0;
+    for (vm_page_t *vm_page = handle_item->first_page; vm_page; vm_page = vm_page->next) page_count++;
+    assert(page_count > 2);
+
+    // Every other record is freed, which leaves every page half full
+    for (u32 i = 0; i < record_count; i += 2) {
+        handle_entry_t *entry = _lookup_handle(handles[i]);
+        meta_block_t *meta_block = GET_HANDLE_OBJECT_META_BLOCK(entry->data);
+
+        _unregister_handle(entry);
+        _free_data_blocks(meta_block);
+    }
+
+    // Pinned objects keep their place
+    for (u32 i = 1; i < record_count; i += 2) _lookup_handle(handles[i])->pin_count = 1;
+    assert(_compact_handle_objects(handle_item, SIZE_MAX) == 0);
+
+    for (u32 i = 1; i < record_count; i += 2) _lookup_handle(handles[i])->pin_count = 0;
+    assert(_compact_handle_objects(handle_item, 0) == 0);
+    assert(_compact_handle_objects(handle_item, SIZE_MAX) > 0);
+
+    u32 compacted_page_count = 0;
+    for (vm_page_t *vm_page = handle_item->first_page; vm_page; vm_page = vm_page->next) compacted_page_count++;
+    assert(compacted_page_count < page_count);
+
+    for (u32 i = 1; i < record_count; i += 2) {
+        handle_entry_t *entry = _lookup_handle(handles[i]);
+        assert(entry != NULL);
+        assert(((test_handle_record *)entry->data)->key == i);
+        assert(_is_vm_page_address(entry->data));
+
+        meta_block_t *meta_block = GET_HANDLE_OBJECT_META_BLOCK(entry->data);
+
+        _unregister_handle(entry);
+        _free_data_blocks(meta_block);
+    }
+    assert(handle_item->first_page == NULL);
+
+    PRINT_SUCCESS(__func__);
+}
+
+test_func handle_tests[] = {
+    {"handle_registration", test_handle_registration},
+    {"compaction_of_sparse_pages", test_compaction_of_sparse_pages},
+    {NULL, NULL},
+};
@@ -0,0 +1,58 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include "common.h"
+#include "memtools.h"
+#include "lifetime.h"
+
+
+static void test_lifetime_buckets() {
+    _register_page_item("test_lifetime_x", sizeof(u64));
+
+    vm_page_item_t *page_item = _lookup_page_item("test_lifetime_x");
+    assert(page_item != NULL);
+    assert(_set_lifetime_clock(LIFETIME_CLOCK_ALLOCATIONS));
+
+    u64 const first_birth_stamp = _get_birth_stamp();
+    assert(first_birth_stamp & LIFETIME_STAMP_CLOCK_BIT);
+
+    // Lifetime of one allocation
+    _record_lifetime(page_item, _get_birth_stamp() - 1);
+
+    for (u32 i = 0; i < 4; i++) {
+        _get_birth_stamp();
+    }
+    // Lifetime of five allocations
+    _record_lifetime(page_item, first_birth_stamp);
+
+    u64 bucket_counts[LIFETIME_BUCKET_COUNT];
+
+#ifdef HALLOC_LIFETIME_STATS
+    assert(_get_lifetime_histogram(page_item, bucket_counts));
+    assert(bucket_counts[1] == 1);
+    assert(bucket_counts[3] == 1);
+
+    // Stamp of the other clock is ignored
+    _record_lifetime(page_item, first_birth_stamp & ~LIFETIME_STAMP_CLOCK_BIT);
+    assert(_get_lifetime_histogram(page_item, bucket_counts));
+
+    u64 total_count = 0;
+    for (u32 bucket = 0; bucket < LIFETIME_BUCKET_COUNT; bucket++) total_count += bucket_counts[bucket];
+    assert(total_count == 2);
+#else
+    assert(!_get_lifetime_histogram(page_item, bucket_counts));
+    assert(bucket_counts[3] == 0);
+#endif
+
+    assert(!_set_lifetime_clock(LIFETIME_CLOCK_ALLOCATIONS + 1));
+    assert(_set_lifetime_clock(LIFETIME_CLOCK_TIME));
+    assert(!(_get_birth_stamp() & LIFETIME_STAMP_CLOCK_BIT));
+
+    PRINT_SUCCESS(__func__);
+}
+
+test_func lifetime_tests[] = {
+    {"lifetime_buckets", test_lifetime_buckets},
+    {NULL, NULL},
+};
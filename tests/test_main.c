@@ -2,22 +2,8 @@
 
 #include "common.h"
 
-static void run_dll_tests() {
-    for (test_func *test=&dll_tests[0]; test->name; test++)
-    {
-        test->func();
-    }
-}
-
-static void run_memtools_tests() {
-    for (test_func *test=&memtools_tests[0]; test->name; test++)
-    {
-        test->func();
-    }
-}
-
-static void run_halloc_tests() {
-    for (test_func *test=&halloc_tests[0]; test->name; test++)
+static void run_tests(test_func *tests) {
+    for (test_func *test=&tests[0]; test->name; test++)
     {
         test->func();
     }
@@ -27,15 +13,48 @@ int main() {
     printf("\nrunning tests...\n\n");
 
     printf("running dll tests...\n");
-    run_dll_tests();
+    run_tests(dll_tests);
 
     init_memtools_testing();
 
     printf("\nrunning memtools tests...\n");
-    run_memtools_tests();
+    run_tests(memtools_tests);
+
+    printf("\nrunning slab tests...\n");
+    run_tests(slab_tests);
+
+    printf("\nrunning numa tests...\n");
+    run_tests(numa_tests);
+
+    printf("\nrunning region tests...\n");
+    run_tests(region_tests);
+
+    printf("\nrunning profile tests...\n");
+    run_tests(profile_tests);
+
+    printf("\nrunning site tests...\n");
+    run_tests(site_tests);
+
+    printf("\nrunning lifetime tests...\n");
+    run_tests(lifetime_tests);
+
+    printf("\nrunning provider tests...\n");
+    run_tests(provider_tests);
+
+    printf("\nrunning arena tests...\n");
+    run_tests(arena_tests);
+
+    printf("\nrunning handle tests...\n");
+    run_tests(handle_tests);
+
+    printf("\nrunning refill tests...\n");
+    run_tests(refill_tests);
+
+    printf("\nrunning epoch tests...\n");
+    run_tests(epoch_tests);
 
     printf("\nrunning halloc tests...\n");
-    run_halloc_tests();
+    run_tests(halloc_tests);
 
     printf("\n");
 }
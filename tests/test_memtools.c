@@ -211,12 +211,12 @@ static void test_free_data_block_allocation_for_consecutive_times() {
     // Assuming that everything so far fits into one standard size page
     assert(page_item->first_page->next == NULL);
 
-    assert(first_free_meta_block->next == second_free_meta_block);
+    assert(NEXT_META_BLOCK(first_free_meta_block) == second_free_meta_block);
     assert(second_free_meta_block->block_size == 2 * page_item->struct_size);
-    assert(first_free_meta_block->next->is_free == false);
+    assert(NEXT_META_BLOCK(first_free_meta_block)->is_free == false);
 
     _free_data_blocks(second_free_meta_block);
-    assert(first_free_meta_block->next->is_free == true);
+    assert(NEXT_META_BLOCK(first_free_meta_block)->is_free == true);
 
     // Assuming that following allocation needs a new page (it becomes first in order)
     needed_page_count = (100*page_item->struct_size)/system_page_size + 1;
@@ -234,13 +234,552 @@ static void test_free_data_block_allocation_for_consecutive_times() {
     PRINT_SUCCESS(__func__);
 }
 
+static void test_free_data_block_merging_with_neighbours() {
+    _register_page_item("test_merge", sizeof(test_x));
+
+    vm_page_item_t *page_item = _lookup_page_item("test_merge");
+    assert(page_item != NULL);
+
+    meta_block_t *first_meta_block = _allocate_free_data_block(page_item, page_item->struct_size);
+    meta_block_t *second_meta_block = _allocate_free_data_block(page_item, page_item->struct_size);
+    meta_block_t *third_meta_block = _allocate_free_data_block(page_item, page_item->struct_size);
+
+    assert(first_meta_block != NULL && second_meta_block != NULL && third_meta_block != NULL);
+
+    _free_data_blocks(second_meta_block);
+    _free_data_blocks(first_meta_block);
+
+    // Merged free block and the free tail of the page should be the only queue nodes
+    u32 free_block_count = 0;
+    dll_node_t *node = page_item->heap_root_node.next;
+
+    TRAVERSE_DLL_FORWARD_BEGIN(node)
+    {
+        ++free_block_count;
+    }
+    TRAVERSE_DLL_FORWARD_END(node);
+
+    assert(free_block_count == 2);
+    assert(first_meta_block->is_free == true);
+    assert(NEXT_META_BLOCK(first_meta_block) == third_meta_block);
+
+    _free_data_blocks(third_meta_block);
+    assert(page_item->first_page == NULL);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_trimming_of_free_data_blocks() {
+    _register_page_item("test_trim", sizeof(test_x));
+
+    vm_page_item_t *page_item = _lookup_page_item("test_trim");
+    assert(page_item != NULL);
+
+    size_t const trim_threshold = _get_trim_threshold();
+    // Disable automatic trimming in order to trim explicitly below
+    _set_trim_threshold(0);
+
+    u32 const system_page_size = _get_system_page_size();
+    u32 const large_block_size = 64 * system_page_size;
+
+    meta_block_t *large_meta_block = _allocate_free_data_block(page_item, large_block_size);
+    assert(large_meta_block != NULL);
+
+    // Small block after the large one keeps the vm page mapped
+    meta_block_t *small_meta_block = _allocate_free_data_block(page_item, page_item->struct_size);
+    assert(small_meta_block != NULL);
+    assert(NEXT_META_BLOCK(large_meta_block) == small_meta_block);
+
+    assert(_trim_free_data_block(large_meta_block) == 0);
+
+    _free_data_blocks(large_meta_block);
+    assert(page_item->first_page != NULL);
+
+    // Page holding the meta block stays resident, rest of the data block can be released
+    assert(_trim_free_data_block(large_meta_block) == large_block_size - system_page_size);
+    assert(_trim_free_data_block(large_meta_block) == 0);
+
+    meta_block_t *reused_meta_block = _allocate_free_data_block(page_item, large_block_size);
+    assert(reused_meta_block == large_meta_block);
+
+    _set_trim_threshold(trim_threshold);
+
+    _free_data_blocks(reused_meta_block);
+    _free_data_blocks(small_meta_block);
+    assert(page_item->first_page == NULL);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_geometric_vm_page_growth() {
+    _register_page_item("test_growth", sizeof(test_x));
+
+    vm_page_item_t *page_item = _lookup_page_item("test_growth");
+    assert(page_item != NULL);
+    assert(page_item->growth_page_count == DEFAULT_MIN_PAGE_GROWTH_UNITS);
+
+    meta_block_t *meta_blocks[256];
+    u32 block_count = 0;
+    u32 page_count = 0;
+    u32 expected_page_count = 1;
+
+    // Fill the first three vm pages, each of them twice as large as the previous one
+    while (page_count < 3 && block_count < 256) {
+        vm_page_t *first_page = page_item->first_page;
+
+        meta_blocks[block_count] = _allocate_free_data_block(page_item, page_item->struct_size);
+        assert(meta_blocks[block_count] != NULL);
+
+        if (page_item->first_page != first_page) {
+            assert(page_item->first_page->system_page_count == expected_page_count);
+            expected_page_count *= 2;
+            ++page_count;
+        }
+        ++block_count;
+    }
+
+    assert(page_count == 3);
+    assert(page_item->growth_page_count == expected_page_count);
+
+    for (u32 j=0; j<block_count; ++j)
+    {
+        _free_data_blocks(meta_blocks[j]);
+    }
+
+    // Unmaps right after the growth don't shrink it
+    assert(page_item->first_page == NULL);
+    assert(page_item->growth_page_count == expected_page_count);
+
+    meta_blocks[0] = _allocate_free_data_block(page_item, page_item->struct_size);
+    assert(meta_blocks[0] != NULL);
+    assert(page_item->first_page->system_page_count == expected_page_count);
+
+    // Type idle for three intervals halves its growth three times at the next unmap
+    page_item->growth_stamp_ns -= 3 * PAGE_GROWTH_IDLE_NS;
+    _free_data_blocks(meta_blocks[0]);
+
+    assert(page_item->first_page == NULL);
+    assert(page_item->growth_page_count == expected_page_count * 2 / 8);
+
+    // Large allocations get a page that fits them regardless of the growth
+    u32 const alloc_size = 10 * _get_system_page_size();
+    meta_block_t *meta_block = _allocate_free_data_block(page_item, alloc_size);
+
+    assert(meta_block != NULL);
+    assert(page_item->first_page->system_page_count == _get_required_page_units(alloc_size));
+
+    _free_data_blocks(meta_block);
+
+    assert(_set_page_growth_bounds(0, 1) == false);
+    assert(_set_page_growth_bounds(4, 2) == false);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_reserved_vm_page_stays_mapped() {
+    _register_page_item("test_reserve", sizeof(test_y));
+
+    vm_page_item_t *page_item = _lookup_page_item("test_reserve");
+    assert(page_item != NULL);
+
+    u32 const reserved_size = 100 * page_item->struct_size;
+
+    vm_page_t *vm_page = _reserve_vm_page(page_item, reserved_size, true, false);
+
+    assert(vm_page != NULL);
+    assert(page_item->first_page == vm_page);
+    assert(vm_page->reservation_flags == (VM_PAGE_RESERVED | VM_PAGE_POPULATED));
+    assert(vm_page->system_page_count == _get_required_page_units(reserved_size));
+
+    // Allocations up to the reserved capacity are served from the reserved page
+    meta_block_t *first_meta_block = _allocate_free_data_block(page_item, 50 * page_item->struct_size);
+    meta_block_t *second_meta_block = _allocate_free_data_block(page_item, 50 * page_item->struct_size);
+
+    assert(first_meta_block == &vm_page->meta_block);
+    assert(GET_META_PAGE(second_meta_block, second_meta_block->offset) == vm_page);
+
+    _free_data_blocks(first_meta_block);
+    _free_data_blocks(second_meta_block);
+
+    assert(page_item->first_page == vm_page);
+    assert(vm_page->meta_block.is_free == true);
+    assert(_trim_free_data_block(&vm_page->meta_block) == 0);
+
+    assert(_release_reserved_vm_pages(page_item) == 1);
+    assert(page_item->first_page == NULL);
+    assert(page_item->heap_root_node.next == NULL);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_page_item_lookup_by_id() {
+    vm_page_item_t *page_item = _lookup_page_item("test_1");
+    assert(page_item != NULL);
+
+    assert(_lookup_page_item_by_id(page_item->item_id) == page_item);
+
+    char last_name[20];
+    snprintf(last_name, sizeof last_name, "%s_%d", "test", (i32)_get_max_page_items_per_page_container() + 25);
+
+    page_item = _lookup_page_item(last_name);
+    assert(page_item != NULL);
+    assert(_lookup_page_item_by_id(page_item->item_id) == page_item);
+
+    // Ids are consecutive across page item containers
+    assert(_lookup_page_item_by_id(page_item->item_id - 1) != NULL);
+    assert(_lookup_page_item_by_id(page_item->item_id + 1000) == NULL);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_heap_page_items_keyed_by_size() {
+    _register_page_item("test_size_a", sizeof(test_x));
+    _register_page_item("test_size_b", sizeof(test_x));
+    _register_page_item("test_size_c", sizeof(test_y));
+
+    vm_page_item_t *page_item_a = _lookup_page_item("test_size_a");
+    vm_page_item_t *page_item_b = _lookup_page_item("test_size_b");
+    vm_page_item_t *page_item_c = _lookup_page_item("test_size_c");
+
+    assert(_get_heap_page_item(page_item_a) == page_item_a);
+
+    _set_heaps_keyed_by_size(true);
+
+    vm_page_item_t *heap_page_item = _get_heap_page_item(page_item_a);
+
+    assert(heap_page_item != page_item_a);
+    assert(heap_page_item->item_flags & PAGE_ITEM_SIZE_CLASS);
+    assert(heap_page_item->struct_size == sizeof(test_x));
+    assert(_get_heap_page_item(page_item_b) == heap_page_item);
+    assert(_get_heap_page_item(page_item_c) != heap_page_item);
+    assert(_get_heap_page_item(heap_page_item) == heap_page_item);
+
+    meta_block_t *meta_block = _allocate_free_data_block(heap_page_item, page_item_a->struct_size);
+    assert(meta_block != NULL);
+    assert(meta_block->owner_id == heap_page_item->item_id);
+
+    _account_data_block_allocation(page_item_a, meta_block);
+
+    assert(meta_block->owner_id == page_item_a->item_id);
+    assert(page_item_a->live_block_count == 1);
+    assert(page_item_a->live_bytes == page_item_a->struct_size);
+    assert(heap_page_item->live_block_count == 0);
+
+    _account_data_block_free(meta_block);
+    _free_data_blocks(meta_block);
+
+    assert(page_item_a->live_block_count == 0);
+    assert(page_item_a->free_count == 1);
+    assert(heap_page_item->first_page == NULL);
+
+    _set_heaps_keyed_by_size(false);
+    assert(_get_heap_page_item(page_item_a) == page_item_a);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_shared_area_for_small_types() {
+    _register_page_item("test_shared_a", sizeof(test_x));
+    _register_page_item("test_shared_b", sizeof(test_y));
+
+    vm_page_item_t *page_item_a = _lookup_page_item("test_shared_a");
+    vm_page_item_t *page_item_b = _lookup_page_item("test_shared_b");
+
+    assert(_get_allocation_page_item(page_item_a, page_item_a->struct_size) == page_item_a);
+
+    _set_shared_area_threshold(2 * sizeof(test_y));
+
+    vm_page_item_t *shared_page_item = _get_allocation_page_item(page_item_a, page_item_a->struct_size);
+
+    assert(shared_page_item != page_item_a);
+    assert(shared_page_item->item_flags & PAGE_ITEM_SHARED_AREA);
+    assert(_get_allocation_page_item(page_item_b, page_item_b->struct_size) == shared_page_item);
+    assert(_get_allocation_page_item(shared_page_item, 1) == shared_page_item);
+
+    meta_block_t *meta_block = _allocate_free_data_block(shared_page_item, page_item_a->struct_size);
+    assert(meta_block != NULL);
+    _account_data_block_allocation(page_item_a, meta_block);
+
+    // Type exceeding the threshold gets promoted for good
+    assert(_get_allocation_page_item(page_item_b, 3 * page_item_b->struct_size) == page_item_b);
+    assert(page_item_b->item_flags & PAGE_ITEM_PROMOTED);
+    assert(_get_allocation_page_item(page_item_b, page_item_b->struct_size) == page_item_b);
+
+    assert(_get_allocation_page_item(page_item_a, page_item_a->struct_size) == shared_page_item);
+
+    _account_data_block_free(meta_block);
+    _free_data_blocks(meta_block);
+    assert(shared_page_item->first_page == NULL);
+
+    _set_shared_area_threshold(0);
+    assert(_get_allocation_page_item(page_item_a, page_item_a->struct_size) == page_item_a);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_compact_meta_blocks() {
+    _register_page_item("test_compact", sizeof(u32));
+
+    vm_page_item_t *page_item = _lookup_page_item("test_compact");
+    assert(page_item != NULL);
+
+    assert(sizeof(meta_block_t) == 16 + META_BLOCK_EXTENSION_SIZE);
+
+    meta_block_t *first_meta_block = _allocate_free_data_block(page_item, page_item->struct_size);
+    meta_block_t *second_meta_block = _allocate_free_data_block(page_item, page_item->struct_size);
+
+    assert(first_meta_block != NULL && second_meta_block != NULL);
+    assert(first_meta_block->block_size == sizeof(u32));
+
+    // Data block is padded, next meta block starts right after the padding
+    assert((char *)second_meta_block - (char *)first_meta_block == sizeof(meta_block_t) + DATA_BLOCK_ALIGNMENT);
+    assert((uintptr_t)(second_meta_block + 1) % DATA_BLOCK_ALIGNMENT == 0);
+    assert(NEXT_META_BLOCK(first_meta_block) == second_meta_block);
+    assert(PREV_META_BLOCK(second_meta_block) == first_meta_block);
+    assert(PREV_META_BLOCK(first_meta_block) == NULL);
+
+    vm_page_t *vm_page = page_item->first_page;
+    u32 const max_available_memory = _get_page_max_available_memory(vm_page->system_page_count);
+
+    // Residual that cannot hold a free block gets absorbed by the last data block of the page
+    u32 const free_size = max_available_memory - 2 * (DATA_BLOCK_ALIGNMENT + sizeof(meta_block_t));
+    u32 const alloc_size = free_size - sizeof(meta_block_t) - 8;
+
+    meta_block_t *last_meta_block = _allocate_free_data_block(page_item, alloc_size);
+
+    assert(GET_META_PAGE(last_meta_block, last_meta_block->offset) == vm_page);
+    assert(last_meta_block->block_size == free_size);
+    assert(NEXT_META_BLOCK(last_meta_block) == NULL);
+
+    _free_data_blocks(second_meta_block);
+    assert(second_meta_block->block_size == DATA_BLOCK_ALIGNMENT);
+
+    _free_data_blocks(last_meta_block);
+    _free_data_blocks(first_meta_block);
+
+    assert(page_item->first_page == NULL);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_usable_size_and_vm_page_map() {
+    _register_page_item("test_usable", sizeof(test_y));
+
+    vm_page_item_t *page_item = _lookup_page_item("test_usable");
+    assert(page_item != NULL);
+
+    // Residue too small for a free block is usable by the data block in front of it
+    u32 const page_capacity = _get_page_max_available_memory(1);
+    u32 const alloc_size = page_capacity - sizeof(meta_block_t) - DATA_BLOCK_ALIGNMENT / 2;
+
+    meta_block_t *meta_block = _allocate_free_data_block(page_item, alloc_size);
+    assert(meta_block != NULL);
+
+    vm_page_t *vm_page = GET_META_PAGE(meta_block, meta_block->offset);
+    assert(vm_page->system_page_count == 1);
+    assert(_get_data_block_usable_size(meta_block + 1) == page_capacity);
+
+    assert(_is_vm_page_address(vm_page));
+    assert(_is_vm_page_address((char *)vm_page + _get_system_page_size() - 1));
+    assert(!_is_vm_page_address(&page_capacity));
+
+    // Page of the vm page leaves the map when it gets unmapped
+    page_item->growth_page_count = 1;
+    _free_data_blocks(meta_block);
+
+    assert(page_item->first_page == NULL);
+    assert(!_is_vm_page_address(vm_page));
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_released_pages_are_released_once() {
+    _register_page_item("test_release_once", sizeof(test_x));
+
+    vm_page_item_t *page_item = _lookup_page_item("test_release_once");
+    assert(page_item != NULL);
+
+    u32 const system_page_size = _get_system_page_size();
+    u32 const large_block_size = 64 * system_page_size;
+    assert(large_block_size >= _get_trim_threshold());
+
+    meta_block_t *large_meta_block = _allocate_free_data_block(page_item, large_block_size);
+    meta_block_t *small_meta_block = _allocate_free_data_block(page_item, page_item->struct_size);
+    assert(large_meta_block != NULL && small_meta_block != NULL);
+
+    // Free data block over the trim threshold is released by the free itself
+    _free_data_blocks(large_meta_block);
+    mapping_stats_t const released_stats = page_item->mapping_stats;
+    assert(released_stats.release_count == 1);
+    assert(released_stats.released_bytes == large_block_size - system_page_size);
+
+    // Short allocations at its front write only the resident first page, which needs no release
+    for (u32 i = 0; i < 1000; i++) {
+        meta_block_t *meta_block = _allocate_free_data_block(page_item, page_item->struct_size);
+        assert(meta_block == large_meta_block);
+        _free_data_blocks(meta_block);
+    }
+    assert(page_item->mapping_stats.release_count == released_stats.release_count);
+    assert(page_item->mapping_stats.released_bytes == released_stats.released_bytes);
+
+    // Allocation over several pages faults them in, its free releases just these pages again
+    meta_block_t *meta_block = _allocate_free_data_block(page_item, 4 * system_page_size);
+    assert(meta_block == large_meta_block);
+    _free_data_blocks(meta_block);
+    assert(page_item->mapping_stats.release_count == released_stats.release_count + 1);
+    assert(page_item->mapping_stats.released_bytes <= released_stats.released_bytes + 5 * system_page_size);
+
+    assert(_trim_free_data_block(large_meta_block) == 0);
+
+    _free_data_blocks(small_meta_block);
+    assert(page_item->first_page == NULL);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_mapping_stats_of_page_item() {
+    _register_page_item("test_mapping", sizeof(test_x));
+
+    vm_page_item_t *page_item = _lookup_page_item("test_mapping");
+    assert(page_item != NULL);
+    assert(page_item->mapping_stats.map_count == 0);
+
+    size_t const trim_threshold = _get_trim_threshold();
+    _set_trim_threshold(0);
+
+    mapping_stats_t process_stats_before, process_stats_after;
+    _get_process_mapping_stats(&process_stats_before);
+
+    u32 const system_page_size = _get_system_page_size();
+    meta_block_t *large_meta_block = _allocate_free_data_block(page_item, 16 * system_page_size);
+    meta_block_t *small_meta_block = _allocate_free_data_block(page_item, page_item->struct_size);
+    assert(large_meta_block != NULL && small_meta_block != NULL);
+
+    vm_page_t *vm_page = page_item->first_page;
+    size_t const page_bytes = (size_t)vm_page->system_page_count * system_page_size;
+
+    assert(page_item->mapping_stats.map_count == 1);
+    assert(page_item->mapping_stats.mapped_bytes == page_bytes);
+
+    // Released pages stay mapped and are counted apart from unmappings
+    _free_data_blocks(large_meta_block);
+    size_t const released_bytes = _trim_free_data_block(large_meta_block);
+    assert(released_bytes > 0);
+    assert(page_item->mapping_stats.release_count == 1);
+    assert(page_item->mapping_stats.released_bytes == released_bytes);
+    assert(page_item->mapping_stats.unmap_count == 0);
+
+    _free_data_blocks(small_meta_block);
+    assert(page_item->first_page == NULL);
+    assert(page_item->mapping_stats.unmap_count == 1);
+    assert(page_item->mapping_stats.unmapped_bytes == page_bytes);
+
+    _get_process_mapping_stats(&process_stats_after);
+    assert(process_stats_after.map_count >= process_stats_before.map_count + 1);
+    assert(process_stats_after.unmap_count >= process_stats_before.unmap_count + 1);
+    assert(process_stats_after.released_bytes >= process_stats_before.released_bytes + released_bytes);
+
+    _set_trim_threshold(trim_threshold);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_free_data_block_allocation_near_hint() {
+    _register_page_item("test_near", sizeof(test_x));
+    _register_page_item("test_near_other", sizeof(test_x));
+
+    vm_page_item_t *page_item = _lookup_page_item("test_near");
+    vm_page_item_t *other_page_item = _lookup_page_item("test_near_other");
+    assert(page_item != NULL && other_page_item != NULL);
+
+    u32 const block_count = 6;
+    meta_block_t *meta_blocks[6];
+
+    for (u32 i = 0; i < block_count; i++) {
+        meta_blocks[i] = _allocate_free_data_block(page_item, page_item->struct_size);
+        assert(meta_blocks[i] != NULL);
+    }
+
+    // Holes between allocated data blocks are not the largest free data block
+    _free_data_blocks(meta_blocks[1]);
+    _free_data_blocks(meta_blocks[3]);
+
+    meta_block_t *near_meta_block = _allocate_free_data_block_near(page_item, meta_blocks[2] + 1, page_item->struct_size);
+    assert(near_meta_block == meta_blocks[1]);
+
+    near_meta_block = _allocate_free_data_block_near(page_item, meta_blocks[0] + 1, page_item->struct_size);
+    assert(near_meta_block == meta_blocks[3]);
+    assert(near_meta_block->owner_id == page_item->item_id);
+
+    // Hints that don't lead to a vm page of the heap are ignored
+    test_x local;
+    meta_block_t *other_meta_block = _allocate_free_data_block(other_page_item, other_page_item->struct_size);
+
+    assert(_allocate_free_data_block_near(page_item, NULL, page_item->struct_size) == NULL);
+    assert(_allocate_free_data_block_near(page_item, &local, page_item->struct_size) == NULL);
+    assert(_allocate_free_data_block_near(page_item, other_meta_block + 1, page_item->struct_size) == NULL);
+
+    _free_data_blocks(other_meta_block);
+
+    for (u32 i = 0; i < block_count; i++) {
+        _free_data_blocks(meta_blocks[i]);
+    }
+    assert(page_item->first_page == NULL);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_lifetime_class_page_items() {
+    _register_page_item("test_lifetime_class", sizeof(test_x));
+
+    vm_page_item_t *page_item = _lookup_page_item("test_lifetime_class");
+    assert(page_item != NULL);
+
+    // Long-lived objects use the heap of the type
+    assert(_get_lifetime_class_page_item(page_item, LIFETIME_CLASS_LONG) == NULL);
+    assert(_get_lifetime_class_page_item(page_item, LIFETIME_CLASS_COUNT) == NULL);
+
+    vm_page_item_t *short_item = _get_lifetime_class_page_item(page_item, LIFETIME_CLASS_SHORT);
+    vm_page_item_t *permanent_item = _get_lifetime_class_page_item(page_item, LIFETIME_CLASS_PERMANENT);
+
+    assert(short_item != NULL && permanent_item != NULL && short_item != permanent_item);
+    assert(short_item->item_flags & PAGE_ITEM_LIFETIME_CLASS);
+    assert(permanent_item->item_flags & PAGE_ITEM_LIFETIME_CLASS);
+    assert(short_item->struct_size == page_item->struct_size);
+    assert(_get_lifetime_class_page_item(page_item, LIFETIME_CLASS_SHORT) == short_item);
+
+    char expected_name[MAX_STRUCT_NAME_SIZE];
+    snprintf(expected_name, sizeof expected_name, "<short %u>", page_item->item_id);
+    assert(strcmp(short_item->struct_name, expected_name) == 0);
+
+    // Class items are not split further by heaps keyed by size
+    _set_heaps_keyed_by_size(true);
+    assert(_get_heap_page_item(short_item) == short_item);
+    _set_heaps_keyed_by_size(false);
+
+    PRINT_SUCCESS(__func__);
+}
+
 test_func memtools_tests[] = {
     {"page_item_registration", test_page_item_registration},
     {"page_item_registration_for_few", test_page_item_registration_for_few},
     {"page_item_registration_for_multiple", test_page_item_registration_for_multiple},
+    {"page_item_lookup_by_id", test_page_item_lookup_by_id},
+    {"heap_page_items_keyed_by_size", test_heap_page_items_keyed_by_size},
+    {"shared_area_for_small_types", test_shared_area_for_small_types},
     {"free_data_block_allocation_small_size", test_free_data_block_allocation_small_size},
     {"free_data_block_allocation_medium_size", test_free_data_block_allocation_medium_size},
     {"free_data_block_allocation_large_size", test_free_data_block_allocation_large_size},
     {"free_data_block_allocation_for_consecutive_times", test_free_data_block_allocation_for_consecutive_times},
+    {"compact_meta_blocks", test_compact_meta_blocks},
+    {"free_data_block_merging_with_neighbours", test_free_data_block_merging_with_neighbours},
+    {"trimming_of_free_data_blocks", test_trimming_of_free_data_blocks},
+    {"geometric_vm_page_growth", test_geometric_vm_page_growth},
+    {"reserved_vm_page_stays_mapped", test_reserved_vm_page_stays_mapped},
+    {"usable_size_and_vm_page_map", test_usable_size_and_vm_page_map},
+    {"released_pages_are_released_once", test_released_pages_are_released_once},
+    {"mapping_stats_of_page_item", test_mapping_stats_of_page_item},
+    {"free_data_block_allocation_near_hint", test_free_data_block_allocation_near_hint},
+    {"lifetime_class_page_items", test_lifetime_class_page_items},
     {NULL, NULL},
 };
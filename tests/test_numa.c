@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "common.h"
+#include "memtools.h"
+#include "slab.h"
+#include "numa.h"
+
+
+static u32 get_first_allowed_node() {
+    for (u32 node = 0; node < NUMA_MAX_NODES; node++) {
+        if (_is_numa_node_allowed(node)) return node;
+    }
+    assert(false);
+    return 0;
+}
+
+static void test_numa_node_count() {
+    size_t const node_count = _get_numa_node_count();
+    size_t allowed_count = 0;
+
+    assert(node_count >= 1 && node_count <= NUMA_MAX_NODES);
+
+    for (u32 node = 0; node < NUMA_MAX_NODES; node++) {
+        if (_is_numa_node_allowed(node)) ++allowed_count;
+    }
+
+    assert(allowed_count == node_count);
+    assert(!_is_numa_node_allowed(NUMA_MAX_NODES));
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_page_item_numa_policy_setting() {
+    _register_page_item("test_numa_policy", 64);
+
+    vm_page_item_t *page_item = _lookup_page_item("test_numa_policy");
+    assert(page_item != NULL);
+    assert(page_item->numa_policy == NUMA_POLICY_DEFAULT);
+
+    u32 const node = get_first_allowed_node();
+
+    assert(!_set_page_item_numa_policy(page_item, NUMA_POLICY_LOCAL + 1, 0));
+    assert(!_set_page_item_numa_policy(page_item, NUMA_POLICY_BIND, NUMA_MAX_NODES));
+    assert(page_item->numa_policy == NUMA_POLICY_DEFAULT);
+
+    assert(_set_page_item_numa_policy(page_item, NUMA_POLICY_BIND, node));
+    assert(page_item->numa_policy == NUMA_POLICY_BIND && page_item->numa_node == node);
+
+    // Node matters only for binding
+    assert(_set_page_item_numa_policy(page_item, NUMA_POLICY_INTERLEAVE, NUMA_MAX_NODES));
+    assert(page_item->numa_policy == NUMA_POLICY_INTERLEAVE && page_item->numa_node == 0);
+
+    assert(_set_page_item_numa_policy(page_item, NUMA_POLICY_DEFAULT, 0));
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_numa_policy_for_vm_pages() {
+    _register_page_item("test_numa_pages", 4096);
+
+    vm_page_item_t *page_item = _lookup_page_item("test_numa_pages");
+    assert(page_item != NULL);
+
+    u32 const node = get_first_allowed_node();
+    assert(_set_page_item_numa_policy(page_item, NUMA_POLICY_BIND, node));
+
+    meta_block_t *meta_block = _allocate_free_data_block(page_item, 4 * page_item->struct_size);
+    assert(meta_block != NULL);
+    memset(meta_block + 1, 1, meta_block->block_size);
+
+    assert(_set_out_of_band_layout(page_item, true));
+    char *slot = _allocate_slab_slot(page_item);
+    assert(slot != NULL);
+    slot[0] = 1;
+
+    uint64_t node_page_counts[NUMA_MAX_NODES];
+    size_t const resident_page_count = _get_numa_node_page_counts(page_item, node_page_counts);
+
+    // All resident pages, if the kernel reports them, are on the bound node
+    assert(node_page_counts[node] == resident_page_count);
+
+    _free_slab_slot(slot);
+    _free_data_blocks(meta_block);
+
+    assert(_get_numa_node_page_counts(page_item, node_page_counts) == 0);
+
+    _set_out_of_band_layout(page_item, false);
+    _set_page_item_numa_policy(page_item, NUMA_POLICY_DEFAULT, 0);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_thread_default_numa_policy() {
+    _register_page_item("test_numa_thread", 32);
+
+    vm_page_item_t *page_item = _lookup_page_item("test_numa_thread");
+    assert(page_item != NULL);
+
+    assert(!_set_thread_default_numa_policy(NUMA_POLICY_BIND, NUMA_MAX_NODES));
+    assert(_set_thread_default_numa_policy(NUMA_POLICY_LOCAL, 0));
+
+    meta_block_t *meta_block = _allocate_free_data_block(page_item, page_item->struct_size);
+    assert(meta_block != NULL);
+
+    assert(_apply_numa_policy(page_item, GET_META_PAGE(meta_block, meta_block->offset), _get_system_page_size()));
+
+    _free_data_blocks(meta_block);
+    assert(_set_thread_default_numa_policy(NUMA_POLICY_DEFAULT, 0));
+
+    PRINT_SUCCESS(__func__);
+}
+
+test_func numa_tests[] = {
+    {"numa_node_count", test_numa_node_count},
+    {"page_item_numa_policy_setting", test_page_item_numa_policy_setting},
+    {"numa_policy_for_vm_pages", test_numa_policy_for_vm_pages},
+    {"thread_default_numa_policy", test_thread_default_numa_policy},
+    {NULL, NULL},
+};
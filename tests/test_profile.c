@@ -0,0 +1,186 @@
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "memtools.h"
+#include "profile.h"
+#include "halloc.h"
+
+typedef struct {
+    u64 id;
+    char payload[120];
+} test_profile_record;
+
+
+static void test_sampling_disabled_by_default() {
+    assert(_get_profile_sampling_rate() == 0);
+
+    test_profile_record *records[16];
+
+    for (u32 i = 0; i < 16; i++) {
+        records[i] = halloc(test_profile_record, 1);
+        assert(records[i] != NULL);
+    }
+    assert(_get_live_sample_count() == 0);
+
+    for (u32 i = 0; i < 16; i++) {
+        hfree(records[i]);
+    }
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_samples_are_tracked_until_free() {
+    u32 const record_count = 10;
+    test_profile_record *records[10];
+
+    // Every allocation of the record is far larger than the distance between samples
+    halloc_set_profile_rate(1);
+
+    for (u32 i = 0; i < record_count; i++) {
+        records[i] = halloc(test_profile_record, 1);
+        assert(records[i] != NULL);
+    }
+    assert(_get_live_sample_count() == record_count);
+
+    for (u32 i = 0; i < record_count; i += 2) {
+        hfree(records[i]);
+    }
+    assert(_get_live_sample_count() == record_count / 2);
+
+    halloc_set_profile_rate(0);
+
+    // Samples taken earlier are still forgotten when freed
+    for (u32 i = 1; i < record_count; i += 2) {
+        hfree(records[i]);
+    }
+    assert(_get_live_sample_count() == 0);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_deferred_free_samples_stay_until_reclaimed() {
+    halloc_set_profile_rate(1);
+
+    test_profile_record *record = halloc(test_profile_record, 1);
+    assert(record != NULL);
+    assert(_get_live_sample_count() == 1);
+
+    // Record is still allocated while a reader may use it
+    assert(halloc_epoch_enter() == 1);
+    hfree_deferred(record);
+
+    assert(halloc_reclaim_deferred() == 0);
+    assert(_get_live_sample_count() == 1);
+
+    halloc_epoch_exit();
+    assert(halloc_reclaim_deferred() == 1);
+    assert(_get_live_sample_count() == 0);
+
+    halloc_set_profile_rate(0);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_sampling_frequency() {
+    u32 const record_count = 10000;
+    size_t const sampling_rate = 4096;
+    test_profile_record **records = malloc(record_count * sizeof(test_profile_record *));
+    assert(records != NULL);
+
+    halloc_set_profile_rate(sampling_rate);
+
+    for (u32 i = 0; i < record_count; i++) {
+        records[i] = halloc(test_profile_record, 2);
+        assert(records[i] != NULL);
+    }
+
+    // Expected sample count is the allocated bytes divided by the rate, i.e. 625
+    size_t const expected_count = record_count * 2 * sizeof(test_profile_record) / sampling_rate;
+    size_t const sample_count = _get_live_sample_count();
+
+    assert(sample_count > expected_count * 3 / 4 && sample_count < expected_count * 5 / 4);
+
+    for (u32 i = 0; i < record_count; i++) {
+        hfree(records[i]);
+    }
+    assert(_get_live_sample_count() == 0);
+
+    halloc_set_profile_rate(0);
+    free(records);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_heap_profile_format() {
+    char path[] = "/tmp/halloc_test_profile_XXXXXX";
+    int const fd = mkstemp(path);
+    assert(fd != -1);
+    close(fd);
+
+    u32 const record_count = 6;
+    test_profile_record *records[6];
+
+    halloc_set_profile_rate(1);
+
+    for (u32 i = 0; i < record_count; i++) {
+        records[i] = halloc(test_profile_record, 1);
+    }
+    hfree(records[0]);
+    hfree(records[1]);
+
+    assert(halloc_dump_heap_profile(path) == 1);
+
+    FILE *file = fopen(path, "r");
+    assert(file != NULL);
+
+    char line[4096];
+    char expected_text[128];
+    size_t const record_size = sizeof(test_profile_record);
+
+    // Totals in brackets also count allocations of earlier tests since sampling was enabled
+    snprintf(expected_text, sizeof expected_text, "heap profile: 4: %zu [", 4 * record_size);
+
+    assert(fgets(line, sizeof line, file) != NULL);
+    assert(strncmp(line, expected_text, strlen(expected_text)) == 0);
+    assert(strstr(line, "] @ heap_v2/1\n") != NULL);
+
+    // Records were allocated at the same call site, hence they share one stack
+    snprintf(expected_text, sizeof expected_text, "4: %zu [6: %zu] @ 0x", 4 * record_size, 6 * record_size);
+
+    bool_t has_stack = false;
+    bool_t has_mapped_libraries = false;
+
+    while (fgets(line, sizeof line, file) != NULL) {
+        if (strncmp(line, expected_text, strlen(expected_text)) == 0) has_stack = true;
+        if (strcmp(line, "MAPPED_LIBRARIES:\n") == 0) has_mapped_libraries = true;
+    }
+    assert(has_stack);
+    assert(has_mapped_libraries);
+
+    fclose(file);
+    unlink(path);
+
+    for (u32 i = 2; i < record_count; i++) {
+        hfree(records[i]);
+    }
+    halloc_set_profile_rate(0);
+
+    assert(halloc_dump_heap_profile("/nonexistent/halloc.heap") == 0);
+
+    PRINT_SUCCESS(__func__);
+}
+
+test_func profile_tests[] = {
+    {"sampling_disabled_by_default", test_sampling_disabled_by_default},
+    {"samples_are_tracked_until_free", test_samples_are_tracked_until_free},
+    {"deferred_free_samples_stay_until_reclaimed", test_deferred_free_samples_stay_until_reclaimed},
+    {"sampling_frequency", test_sampling_frequency},
+    {"heap_profile_format", test_heap_profile_format},
+    {NULL, NULL},
+};
@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "common.h"
+#include "memtools.h"
+#include "provider.h"
+
+typedef struct {
+    page_provider_t fallback;
+    size_t page_size;
+    u32 map_count;
+    u32 unmap_count;
+    u32 advise_count;
+    int last_flags;
+} counting_provider_context;
+
+static void* _map_counted_pages(void *context, size_t length, size_t alignment, int flags) {
+    counting_provider_context *counts = context;
+
+    counts->map_count++;
+    counts->last_flags = flags;
+    return counts->fallback.map(counts->fallback.context, length, alignment, flags);
+}
+
+static int _unmap_counted_pages(void *context, void *addr, size_t length) {
+    counting_provider_context *counts = context;
+
+    counts->unmap_count++;
+    return counts->fallback.unmap(counts->fallback.context, addr, length);
+}
+
+static int _advise_counted_pages(void *context, void *addr, size_t length, int advice) {
+    counting_provider_context *counts = context;
+
+    counts->advise_count++;
+    return counts->fallback.advise(counts->fallback.context, addr, length, advice);
+}
+
+static size_t _get_counted_page_size(void *context) {
+    counting_provider_context *counts = context;
+
+    return counts->page_size;
+}
+
+static page_provider_t _get_counting_provider(counting_provider_context *counts) {
+    page_provider_t const provider = {
+        _map_counted_pages,
+        _unmap_counted_pages,
+        _advise_counted_pages,
+        _get_counted_page_size,
+        counts,
+    };
+    return provider;
+}
+
+
+static void test_default_provider_alignment() {
+    size_t const page_size = _get_provider_page_size();
+    size_t const alignment = 16 * page_size;
+
+    char *pages = _map_provider_pages(4 * page_size, alignment, PAGE_PROVIDER_POPULATE);
+    assert(pages != NULL);
+    assert((uintptr_t)pages % alignment == 0);
+
+    for (size_t i = 0; i < 4 * page_size; i += page_size) {
+        assert(pages[i] == 0);
+        pages[i] = 1;
+    }
+    assert(_advise_provider_pages(pages, page_size, PAGE_PROVIDER_ADVICE_RELEASE));
+
+    // Tail of a mapping can be unmapped apart from its head
+    assert(_unmap_provider_pages(pages + 2 * page_size, 2 * page_size));
+    assert(_unmap_provider_pages(pages, 2 * page_size));
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_mappings_go_through_provider() {
+    // Registration may map a page item container, which isn't counted here
+    _register_page_item("test_provider_x", sizeof(u64));
+    vm_page_item_t *page_item = _lookup_page_item("test_provider_x");
+    assert(page_item != NULL);
+
+    counting_provider_context counts = {0};
+    counts.fallback = *_get_page_provider();
+    counts.page_size = _get_provider_page_size();
+
+    page_provider_t const provider = _get_counting_provider(&counts);
+    assert(_set_page_provider(&provider));
+
+    void *pages = _create_memory_mapping(2);
+    assert(pages != NULL);
+    assert(counts.map_count == 1 && counts.last_flags == 0);
+
+    _delete_memory_mapping(pages, 2);
+    assert(counts.unmap_count == 1);
+
+    pages = _create_aligned_memory_mapping(4);
+    assert(pages != NULL);
+    assert((uintptr_t)pages % (4 * _get_system_page_size()) == 0);
+    assert(counts.map_count == 2);
+
+    _delete_memory_mapping(pages, 4);
+    assert(counts.unmap_count == 2);
+
+    // Reserved pages are faulted in by the provider
+    vm_page_t *vm_page = _reserve_vm_page(page_item, 64, true, false);
+    assert(vm_page != NULL);
+    assert(counts.map_count == 3 && counts.last_flags == PAGE_PROVIDER_POPULATE);
+
+    assert(_release_reserved_vm_pages(page_item) == 1);
+    assert(counts.unmap_count == 3);
+
+    assert(_set_page_provider(NULL));
+    assert(_get_page_provider()->context == NULL);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_invalid_provider() {
+    counting_provider_context counts = {0};
+    counts.fallback = *_get_page_provider();
+
+    page_provider_t provider = _get_counting_provider(&counts);
+
+    // Page size is not a power of two
+    counts.page_size = 3 * _get_provider_page_size();
+    assert(!_set_page_provider(&provider));
+
+    // Page size differs from the one of already mapped pages
+    counts.page_size = 2 * _get_provider_page_size();
+    assert(!_set_page_provider(&provider));
+
+    counts.page_size = _get_provider_page_size();
+    provider.advise = NULL;
+    assert(!_set_page_provider(&provider));
+
+    assert(_get_page_provider()->context == NULL);
+
+    PRINT_SUCCESS(__func__);
+}
+
+test_func provider_tests[] = {
+    {"default_provider_alignment", test_default_provider_alignment},
+    {"mappings_go_through_provider", test_mappings_go_through_provider},
+    {"invalid_provider", test_invalid_provider},
+    {NULL, NULL},
+};
@@ -0,0 +1,89 @@
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "common.h"
+#include "memtools.h"
+#include "refill.h"
+
+typedef struct {
+    u64 key;
+    u64 values[31];
+} test_refill_record;
+
+static pthread_mutex_t test_heap_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void _lock_test_heap() {
+    pthread_mutex_lock(&test_heap_lock);
+}
+
+static void _unlock_test_heap() {
+    pthread_mutex_unlock(&test_heap_lock);
+}
+
+static u32 _get_largest_free_block_size(vm_page_item_t *page_item) {
+    dll_node_t *largest_free_block = page_item->heap_root_node.next;
+
+    return largest_free_block ? GET_FREE_BLOCK_META_BLOCK(largest_free_block)->block_size : 0;
+}
+
+
+static void test_refill_cycle() {
+    _register_page_item("test_refill_record", sizeof(test_refill_record));
+
+    vm_page_item_t *page_item = _lookup_page_item("test_refill_record");
+    assert(page_item != NULL);
+
+    u32 const refill_bytes = 40 * sizeof(test_refill_record);
+
+    // Types without a refill size are left alone
+    assert(_refill_page_items(_lock_test_heap, _unlock_test_heap) == 0);
+
+    page_item->refill_bytes = refill_bytes;
+    assert(_refill_page_items(_lock_test_heap, _unlock_test_heap) == 1);
+
+    vm_page_t *vm_page = page_item->first_page;
+    assert(vm_page != NULL && vm_page->reservation_flags == 0);
+    assert(_get_largest_free_block_size(page_item) >= refill_bytes);
+    assert(_refill_page_items(_lock_test_heap, _unlock_test_heap) == 0);
+
+    // Allocations are served from the refilled page until its free capacity runs low
+    meta_block_t *meta_block = _allocate_free_data_block(page_item, refill_bytes);
+    assert(GET_META_PAGE(meta_block, meta_block->offset) == vm_page);
+    assert(_get_largest_free_block_size(page_item) < refill_bytes);
+
+    assert(_refill_page_items(_lock_test_heap, _unlock_test_heap) == 1);
+    assert(page_item->first_page != vm_page);
+    assert(_get_largest_free_block_size(page_item) >= refill_bytes);
+
+    page_item->refill_bytes = 0;
+    _free_data_blocks(meta_block);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_refill_thread_lifecycle() {
+    assert(!_is_refill_thread_running());
+    assert(!_stop_refill_thread());
+
+    assert(_start_refill_thread(100, _lock_test_heap, _unlock_test_heap));
+    assert(_is_refill_thread_running());
+    assert(!_start_refill_thread(100, _lock_test_heap, _unlock_test_heap));
+
+    usleep(1000);
+
+    assert(_stop_refill_thread());
+    assert(!_is_refill_thread_running());
+
+    PRINT_SUCCESS(__func__);
+}
+
+test_func refill_tests[] = {
+    {"refill_cycle", test_refill_cycle},
+    {"refill_thread_lifecycle", test_refill_thread_lifecycle},
+    {NULL, NULL},
+};
@@ -0,0 +1,307 @@
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "common.h"
+#include "memtools.h"
+#include "slab.h"
+#include "region.h"
+
+#define TEST_REGION_SIZE (16UL << 20)
+
+
+static void create_region_path(char *path) {
+    strcpy(path, "/tmp/halloc_region_XXXXXX");
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    close(fd);
+}
+
+static void test_region_page_allocation() {
+    char path[32];
+    create_region_path(path);
+
+    assert(_open_file_region(path, TEST_REGION_SIZE));
+    assert(_is_region_open());
+    assert(!_open_file_region(path, TEST_REGION_SIZE));
+
+    size_t const system_page_size = _get_system_page_size();
+
+    char *first_pages = _allocate_region_pages(3, 1);
+    char *second_pages = _allocate_region_pages(2, 1);
+
+    assert(first_pages != NULL && second_pages != NULL);
+    assert(_is_region_address(first_pages) && _is_region_address(second_pages + 2 * system_page_size - 1));
+    assert(second_pages == first_pages + 3 * system_page_size);
+
+    memset(first_pages, 0xff, 3 * system_page_size);
+    _free_region_pages(first_pages, 3);
+    assert(_get_region_free_extent_count() == 1);
+
+    // Freed pages are reused zero-filled
+    char *third_pages = _allocate_region_pages(1, 1);
+    assert(third_pages == first_pages);
+    assert(third_pages[0] == 0 && third_pages[system_page_size - 1] == 0);
+
+    // Aligned pages start at a multiple of their size
+    size_t const slab_units = SLAB_PAGE_SIZE / system_page_size;
+    char *aligned_pages = _allocate_region_pages(slab_units, slab_units);
+    assert(aligned_pages != NULL && (uintptr_t)aligned_pages % SLAB_PAGE_SIZE == 0);
+
+    // Neighbouring free extents are merged
+    _free_region_pages(third_pages, 1);
+    _free_region_pages(second_pages, 2);
+    assert(_get_region_free_extent_count() >= 1);
+    assert(_allocate_region_pages(5, 1) == first_pages);
+
+    assert(_allocate_region_pages(TEST_REGION_SIZE / system_page_size, 1) == NULL);
+
+    assert(_close_region());
+    assert(!_is_region_open());
+    assert(!_is_region_address(first_pages));
+
+    unlink(path);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_region_registry_survives_reopening() {
+    char path[32];
+    create_region_path(path);
+
+    assert(_open_file_region(path, TEST_REGION_SIZE));
+    assert(_lookup_page_item("test_region_type") == NULL);
+
+    _register_page_item("test_region_type", sizeof(u64));
+    vm_page_item_t *page_item = _lookup_page_item("test_region_type");
+
+    assert(page_item != NULL && _is_region_address(page_item));
+    assert(page_item->item_id == REGION_FIRST_PAGE_ITEM_ID);
+
+    meta_block_t *meta_block = _allocate_free_data_block(page_item, 10 * page_item->struct_size);
+    assert(meta_block != NULL && _is_region_address(meta_block));
+    _account_data_block_allocation(page_item, meta_block);
+
+    u64 *values = (u64 *)(meta_block + 1);
+    for (u32 i = 0; i < 10; i++) values[i] = i * i;
+
+    _set_region_root_object(values);
+
+    assert(_set_out_of_band_layout(page_item, true));
+    u64 *slot = _allocate_slab_slot(page_item);
+    assert(slot != NULL && _is_region_address(slot));
+    *slot = 42;
+    values[0] = (u64)(uintptr_t)slot;
+
+    assert(_close_region());
+
+    // Types of the process registry are used again
+    assert(_lookup_page_item("test_region_type") == NULL);
+    assert(!_is_slab_slot(slot));
+
+    assert(_open_file_region(path, 0));
+
+    page_item = _lookup_page_item("test_region_type");
+    assert(page_item != NULL);
+    assert(page_item->live_block_count == 2);
+
+    values = _get_region_root_object();
+    assert(values == (u64 *)(meta_block + 1));
+    assert(values[9] == 81);
+
+    slot = (u64 *)(uintptr_t)values[0];
+    assert(_is_slab_slot(slot) && *slot == 42);
+
+    _free_slab_slot(slot);
+    _account_data_block_free(meta_block);
+    _free_data_blocks(meta_block);
+
+    assert(page_item->live_block_count == 0);
+    assert(page_item->first_page == NULL && page_item->first_slab_page == NULL);
+
+    assert(_close_region());
+    unlink(path);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_region_rejects_incompatible_files() {
+    char path[32];
+    create_region_path(path);
+
+    FILE *file = fopen(path, "w");
+    assert(file != NULL);
+    fprintf(file, "not a file heap");
+    fclose(file);
+
+    assert(!_open_file_region(path, TEST_REGION_SIZE));
+    assert(!_is_region_open());
+    assert(!_close_region());
+
+    unlink(path);
+
+    assert(!_open_file_region("/nonexistent_dir/halloc.heap", TEST_REGION_SIZE));
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_shared_region_slab_pages() {
+    assert(_open_shared_region(NULL, TEST_REGION_SIZE));
+    assert(!_open_file_region("/tmp/halloc_region_unused", TEST_REGION_SIZE));
+
+    _register_page_item("test_shared_slab", sizeof(u32));
+    vm_page_item_t *page_item = _lookup_page_item("test_shared_slab");
+
+    assert(page_item != NULL && _is_region_address(page_item));
+    assert(_set_out_of_band_layout(page_item, true));
+
+    u32 *slot = _allocate_slab_slot(page_item);
+    assert(slot != NULL && _is_region_address(slot));
+
+    // Slab page is marked in the region, hence forked processes recognize it as well
+    assert(_is_region_slab_page(GET_SLAB_PAGE(slot)));
+    assert(_is_slab_slot(slot));
+
+    pid_t pid = fork();
+    assert(pid != -1);
+
+    if (pid == 0) {
+        _exit(_is_slab_slot(slot) ? 0 : 1);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    _free_slab_slot(slot);
+    assert(!_is_region_slab_page(GET_SLAB_PAGE(slot)));
+
+    assert(_close_region());
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_named_shared_region_attaching() {
+    char name[64];
+    snprintf(name, sizeof name, "/halloc_test_%d", (int)getpid());
+
+    assert(_open_shared_region(name, TEST_REGION_SIZE));
+
+    _register_page_item("test_shared_named", sizeof(u64));
+    vm_page_item_t *page_item = _lookup_page_item("test_shared_named");
+    assert(page_item != NULL);
+
+    meta_block_t *meta_block = _allocate_free_data_block(page_item, 2 * sizeof(u64));
+    assert(meta_block != NULL);
+
+    u64 *values = (u64 *)(meta_block + 1);
+    values[0] = 7;
+    _set_region_root_object(values);
+
+    pid_t pid = fork();
+    assert(pid != -1);
+
+    if (pid == 0) {
+        // Detach the inherited mapping and attach again by the name as an unrelated process would
+        if (!_close_region() || !_open_shared_region(name, 0)) _exit(1);
+
+        u64 *root = _get_region_root_object();
+        if (root != values || root[0] != 7) _exit(2);
+
+        _lock_region();
+        vm_page_item_t *child_page_item = _lookup_page_item("test_shared_named");
+        meta_block_t *child_meta_block = _allocate_free_data_block(child_page_item, sizeof(u64));
+        _unlock_region();
+
+        if (child_meta_block == NULL) _exit(3);
+
+        *(u64 *)(child_meta_block + 1) = 11;
+        root[1] = (u64)(uintptr_t)(child_meta_block + 1);
+
+        _exit(_close_region() ? 0 : 4);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    u64 *child_value = (u64 *)(uintptr_t)values[1];
+    assert(_is_region_address(child_value) && *child_value == 11);
+
+    _free_data_blocks((meta_block_t *)child_value - 1);
+    _free_data_blocks(meta_block);
+    assert(page_item->first_page == NULL);
+
+    assert(_close_region());
+    shm_unlink(name);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_concurrent_shared_region_creation() {
+    char name[64];
+    snprintf(name, sizeof name, "/halloc_test_race_%d", (int)getpid());
+
+    u32 const process_count = 8;
+    pid_t pids[8];
+    int start_pipe[2];
+    assert(pipe(start_pipe) == 0);
+
+    for (u32 i = 0; i < process_count; i++) {
+        pids[i] = fork();
+        assert(pids[i] != -1);
+
+        if (pids[i] == 0) {
+            char start;
+            close(start_pipe[1]);
+            // All processes open the heap at once after the pipe gets closed
+            if (read(start_pipe[0], &start, 1) != 0) _exit(1);
+            if (!_open_shared_region(name, TEST_REGION_SIZE)) _exit(2);
+
+            _lock_region();
+            _register_page_item("test_shared_race", sizeof(u64));
+            vm_page_item_t *page_item = _lookup_page_item("test_shared_race");
+            meta_block_t *meta_block = _allocate_free_data_block(page_item, sizeof(u64));
+            if (meta_block != NULL) page_item->live_block_count += 1;
+            _unlock_region();
+
+            if (meta_block == NULL) _exit(3);
+            _exit(_close_region() ? 0 : 4);
+        }
+    }
+    close(start_pipe[0]);
+    close(start_pipe[1]);
+
+    for (u32 i = 0; i < process_count; i++) {
+        int status = 0;
+        waitpid(pids[i], &status, 0);
+        assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+
+    // Heap was created once, the allocations of every process are in it
+    assert(_open_shared_region(name, 0));
+    vm_page_item_t *page_item = _lookup_page_item("test_shared_race");
+    assert(page_item != NULL && page_item->live_block_count == process_count);
+
+    assert(_close_region());
+    shm_unlink(name);
+
+    PRINT_SUCCESS(__func__);
+}
+
+test_func region_tests[] = {
+    {"region_page_allocation", test_region_page_allocation},
+    {"region_registry_survives_reopening", test_region_registry_survives_reopening},
+    {"region_rejects_incompatible_files", test_region_rejects_incompatible_files},
+    {"shared_region_slab_pages", test_shared_region_slab_pages},
+    {"named_shared_region_attaching", test_named_shared_region_attaching},
+    {"concurrent_shared_region_creation", test_concurrent_shared_region_creation},
+    {NULL, NULL},
+};
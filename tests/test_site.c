@@ -0,0 +1,68 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "common.h"
+#include "memtools.h"
+#include "site.h"
+
+
+static void test_site_ids() {
+    static char const file[] = "test_site_ids.c";
+
+    u32 const first_site_id = _get_site_id(file, 10, "u32");
+    u32 const second_site_id = _get_site_id(file, 20, "u32");
+
+    assert(first_site_id != UNKNOWN_SITE_ID && second_site_id != UNKNOWN_SITE_ID);
+    assert(first_site_id != second_site_id);
+    assert(_get_site_id(file, 10, "u32") == first_site_id);
+
+    // Allocations without a call site share one site
+    assert(_get_site_id(NULL, 0, NULL) == UNKNOWN_SITE_ID);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_site_accounting() {
+    static char const file[] = "test_site_accounting.c";
+    site_t usage;
+
+    assert(!_get_site_usage(file, 30, &usage));
+
+    u32 const site_id = _get_site_id(file, 30, "double");
+
+    _account_site_allocation(site_id, 64);
+    _account_site_allocation(site_id, 32);
+    _account_site_free(site_id, 64);
+
+    assert(_get_site_usage(file, 30, &usage));
+    assert(usage.line == 30 && strcmp(usage.struct_name, "double") == 0);
+    assert(usage.live_bytes == 32 && usage.live_count == 1);
+    assert(usage.alloc_count == 2 && usage.free_count == 1);
+
+    // Same file and line of another translation unit adds to the usage
+    static char other_file[sizeof file];
+    memcpy(other_file, file, sizeof file);
+    u32 const other_site_id = _get_site_id(other_file, 30, "double");
+
+    assert(other_site_id != site_id);
+    _account_site_allocation(other_site_id, 16);
+
+    assert(_get_site_usage(file, 30, &usage));
+    assert(usage.live_bytes == 48 && usage.live_count == 2 && usage.alloc_count == 3);
+
+    _account_site_free(other_site_id, 16);
+    _account_site_free(site_id, 32);
+
+    assert(_get_site_usage(file, 30, &usage));
+    assert(usage.live_bytes == 0 && usage.live_count == 0 && usage.free_count == 3);
+
+    PRINT_SUCCESS(__func__);
+}
+
+test_func site_tests[] = {
+    {"site_ids", test_site_ids},
+    {"site_accounting", test_site_accounting},
+    {NULL, NULL},
+};
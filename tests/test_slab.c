@@ -0,0 +1,211 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include "common.h"
+#include "memtools.h"
+#include "slab.h"
+
+typedef struct {
+    u32 id;
+    u32 flags;
+    double weight;
+    char tag[8];
+} test_slab_x;
+
+typedef struct {
+    _Alignas(64) u64 counters[4];
+} test_slab_line;
+
+
+static void test_slab_slot_count() {
+    assert(_get_slab_slot_count(0) == 0);
+    assert(_get_slab_slot_count(MAX_SLAB_SLOT_SIZE + 1) == 0);
+
+    u32 const slot_sizes[] = {1, 8, sizeof(test_slab_x), 100, sizeof(test_slab_line), 1536, MAX_SLAB_SLOT_SIZE};
+
+    for (u32 i = 0; i < sizeof(slot_sizes) / sizeof(slot_sizes[0]); i++) {
+        u32 const slot_count = _get_slab_slot_count(slot_sizes[i]);
+        size_t const slots_offset = ALIGN_UP(GET_SLAB_SIDE_TABLES_END(slot_count), GET_SLAB_SLOT_ALIGNMENT(slot_sizes[i]));
+
+        assert(slot_count > 0);
+        assert(slots_offset + (size_t)slot_count * slot_sizes[i] <= SLAB_PAGE_SIZE);
+    }
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_out_of_band_layout_setting() {
+    _register_page_item("test_slab_small", 16);
+    _register_page_item("test_slab_large", MAX_SLAB_SLOT_SIZE + 1);
+
+    vm_page_item_t *small_page_item = _lookup_page_item("test_slab_small");
+    vm_page_item_t *large_page_item = _lookup_page_item("test_slab_large");
+
+    assert(small_page_item != NULL && large_page_item != NULL);
+
+    assert(_set_out_of_band_layout(small_page_item, true));
+    assert(small_page_item->item_flags & PAGE_ITEM_OUT_OF_BAND);
+
+    assert(!_set_out_of_band_layout(large_page_item, true));
+    assert(!(large_page_item->item_flags & PAGE_ITEM_OUT_OF_BAND));
+
+    assert(_set_out_of_band_layout(small_page_item, false));
+    assert(!(small_page_item->item_flags & PAGE_ITEM_OUT_OF_BAND));
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_slab_slots_are_contiguous() {
+    _register_page_item("test_slab_x", sizeof(test_slab_x));
+
+    vm_page_item_t *page_item = _lookup_page_item("test_slab_x");
+    assert(page_item != NULL);
+    assert(_set_out_of_band_layout(page_item, true));
+
+    u32 const slot_count = 10;
+    test_slab_x *slots[10];
+
+    for (u32 i = 0; i < slot_count; i++) {
+        slots[i] = _allocate_slab_slot(page_item);
+        assert(slots[i] != NULL);
+        assert(_is_slab_slot(slots[i]));
+    }
+
+    slab_page_t *slab_page = page_item->first_slab_page;
+
+    assert(slab_page != NULL && slab_page->next == slab_page);
+    assert((uintptr_t)slab_page % SLAB_PAGE_SIZE == 0);
+    assert(slab_page->allocated_slot_count == slot_count);
+    assert(page_item->live_block_count == slot_count);
+
+    // Slots form an array of the type, meta data is only in the side table
+    assert(slots[0] == GET_SLAB_SLOT(slab_page, 0));
+    assert((uintptr_t)slots[0] % DATA_BLOCK_ALIGNMENT == 0);
+
+    for (u32 i = 1; i < slot_count; i++) {
+        assert(slots[i] == slots[0] + i);
+        assert(GET_SLAB_PAGE(slots[i]) == slab_page);
+        assert(GET_SLAB_SLOT_INDEX(slab_page, slots[i]) == i);
+        assert(slab_page->slot_table[i] == SLAB_SLOT_ALLOCATED);
+    }
+
+    // Slot freed last gets reused first
+    _free_slab_slot(slots[3]);
+    _free_slab_slot(slots[7]);
+    assert(slab_page->slot_table[7] == 3);
+
+    assert(_allocate_slab_slot(page_item) == slots[7]);
+    assert(_allocate_slab_slot(page_item) == slots[3]);
+    assert(_allocate_slab_slot(page_item) == slots[slot_count - 1] + 1);
+
+    _free_slab_slot(slots[slot_count - 1] + 1);
+
+    for (u32 i = 0; i < slot_count; i++) {
+        _free_slab_slot(slots[i]);
+    }
+
+    // Empty slab page gets unmapped and forgotten
+    assert(page_item->first_slab_page == NULL);
+    assert(!_is_slab_slot(slots[0]));
+    assert(page_item->live_block_count == 0);
+
+    _set_out_of_band_layout(page_item, false);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_slab_slots_keep_type_alignment() {
+    _register_page_item("test_slab_line", sizeof(test_slab_line));
+
+    vm_page_item_t *page_item = _lookup_page_item("test_slab_line");
+    assert(page_item != NULL);
+    assert(_set_out_of_band_layout(page_item, true));
+
+    test_slab_line *slots[4];
+
+    // Type aligned above data blocks gets slots at its own alignment
+    for (u32 i = 0; i < 4; i++) {
+        slots[i] = _allocate_slab_slot(page_item);
+        assert(slots[i] != NULL);
+        assert((uintptr_t)slots[i] % _Alignof(test_slab_line) == 0);
+    }
+    for (u32 i = 0; i < 4; i++) {
+        _free_slab_slot(slots[i]);
+    }
+    _set_out_of_band_layout(page_item, false);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_full_slab_pages_rotate_behind() {
+    _register_page_item("test_slab_rotation", 1024);
+
+    vm_page_item_t *page_item = _lookup_page_item("test_slab_rotation");
+    assert(page_item != NULL);
+    assert(_set_out_of_band_layout(page_item, true));
+
+    u32 const slot_count = _get_slab_slot_count(page_item->struct_size);
+    char **slots = malloc((slot_count + 1) * sizeof(char *));
+    assert(slots != NULL);
+
+    for (u32 i = 0; i < slot_count; i++) {
+        slots[i] = _allocate_slab_slot(page_item);
+        assert(slots[i] != NULL);
+    }
+
+    slab_page_t *full_slab_page = GET_SLAB_PAGE(slots[0]);
+    assert(IS_SLAB_PAGE_FULL(full_slab_page));
+
+    slots[slot_count] = _allocate_slab_slot(page_item);
+    slab_page_t *second_slab_page = GET_SLAB_PAGE(slots[slot_count]);
+
+    assert(second_slab_page != full_slab_page);
+    assert(page_item->first_slab_page == second_slab_page);
+    assert(second_slab_page->next == full_slab_page && full_slab_page->next == second_slab_page);
+
+    // Slab page that has a free slot again is moved in front
+    _free_slab_slot(slots[1]);
+    assert(page_item->first_slab_page == full_slab_page);
+    assert(_allocate_slab_slot(page_item) == slots[1]);
+    assert(page_item->first_slab_page == second_slab_page);
+
+    for (u32 i = 0; i <= slot_count; i++) {
+        _free_slab_slot(slots[i]);
+    }
+
+    assert(page_item->first_slab_page == NULL);
+    free(slots);
+
+    PRINT_SUCCESS(__func__);
+}
+
+static void test_slab_slot_lookup_for_other_addresses() {
+    _register_page_item("test_slab_lookup", sizeof(u64));
+
+    vm_page_item_t *page_item = _lookup_page_item("test_slab_lookup");
+    assert(page_item != NULL);
+
+    meta_block_t *meta_block = _allocate_free_data_block(page_item, page_item->struct_size);
+    assert(meta_block != NULL);
+
+    u64 value = 0;
+
+    assert(!_is_slab_slot(meta_block + 1));
+    assert(!_is_slab_slot(&value));
+    assert(!_is_slab_slot(NULL));
+
+    _free_data_blocks(meta_block);
+
+    PRINT_SUCCESS(__func__);
+}
+
+test_func slab_tests[] = {
+    {"slab_slot_count", test_slab_slot_count},
+    {"out_of_band_layout_setting", test_out_of_band_layout_setting},
+    {"slab_slots_are_contiguous", test_slab_slots_are_contiguous},
+    {"slab_slots_keep_type_alignment", test_slab_slots_keep_type_alignment},
+    {"full_slab_pages_rotate_behind", test_full_slab_pages_rotate_behind},
+    {"slab_slot_lookup_for_other_addresses", test_slab_slot_lookup_for_other_addresses},
+    {NULL, NULL},
+};